@@ -15,6 +15,15 @@ namespace DBManager {
 MYSQL* mysql = NULL;
 MYSQL_RES* queryResult = NULL;
 std::string errMsg = "";
+std::recursive_mutex dbMutex;  //保护以上连接与查询结果
+
+Lock::Lock() {
+    dbMutex.lock();
+}
+
+Lock::~Lock() {
+    dbMutex.unlock();
+}
 
 bool connectDatabase(DBAccount account) {
     mysql = mysql_init(NULL); //初始化连接
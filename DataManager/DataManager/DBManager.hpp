@@ -9,6 +9,7 @@
 #define DBManager_hpp
 #pragma GCC visibility push(default)
 
+#include <mutex>
 #include <string>
 
 #include "mysql.h"
@@ -42,6 +43,17 @@ typedef enum DBActionType {
     DEL
 } DBActionType;
 
+/// 数据库访问锁
+/// 连接与查询结果为全局共享，多线程使用时须从查询起到读取完结果为止持有，可重入
+/// DataManager的每个函数在执行期间均持有此锁
+class Lock {
+public:
+    Lock();
+    ~Lock();
+    Lock(const Lock&) = delete;
+    Lock& operator=(const Lock&) = delete;
+};
+
 /// 连接数据库
 /// @param account 数据库帐号
 bool connectDatabase(DBAccount account);
@@ -10,6 +10,7 @@
 namespace DataManager {
 
 bool connectDatabase() {
+    DBManager::Lock lock;
     int conStat = DBManager::checkConnection();
     if (conStat) {
 #ifdef DEBUG
@@ -28,12 +29,14 @@ bool connectDatabase() {
 }
 
 void disconnectDatabase() {
+    DBManager::Lock lock;
     DBManager::closeConnection();
 }
 
 //MARK: - User类实现
 
 DMErrorType User::login(std::string email, std::string password) {
+    DBManager::Lock lock;
     email = DBManager::sqlInjectionCheck(email);
     if (connectDatabase()) {
         if (!DBManager::select("users", "id,password,name", "username='" + email + "'")) {
@@ -62,6 +65,7 @@ DMErrorType User::login(std::string email, std::string password) {
 }
 
 DMErrorType User::reg(std::string email, std::string password) {
+    DBManager::Lock lock;
     email = DBManager::sqlInjectionCheck(email);
     if (connectDatabase()) {
         if (!DBManager::select("users", "id", "username='" + email + "'")) {
@@ -87,6 +91,7 @@ DMErrorType User::reg(std::string email, std::string password) {
 }
 
 DMErrorType User::setName(std::string name) {
+    DBManager::Lock lock;
     name = DBManager::sqlInjectionCheck(name);
     if (id == -1)
         return OBJECT_NOT_INITED;
@@ -105,6 +110,7 @@ DMErrorType User::setName(std::string name) {
 //MARK: - Student类实现
 
 Student::Student(int id) noexcept(false) {
+    DBManager::Lock lock;
     if (connectDatabase()) {
         if (!DBManager::select("students", "*", "id=" + std::to_string(id))) {
             if (DBManager::numRows() > 0) {
@@ -128,6 +134,7 @@ Student::Student(int id) noexcept(false) {
 }
 
 Student::Student(std::string qq) noexcept(false) {
+    DBManager::Lock lock;
     if (connectDatabase()) {
         if (!DBManager::select("students", "*", "qq='" + qq + "'")) {
             if (DBManager::numRows() > 0) {
@@ -150,6 +157,7 @@ Student::Student(std::string qq) noexcept(false) {
 }
 
 DMErrorType Student::setSchoolNum(std::string newNum) {
+    DBManager::Lock lock;
     if (id == -1)
         return OBJECT_NOT_INITED;
     if (connectDatabase()) {
@@ -165,6 +173,7 @@ DMErrorType Student::setSchoolNum(std::string newNum) {
 }
 
 DMErrorType Student::setClassId(long newClassId) {
+    DBManager::Lock lock;
     if (id == -1)
         return OBJECT_NOT_INITED;
     if (connectDatabase()) {
@@ -180,6 +189,7 @@ DMErrorType Student::setClassId(long newClassId) {
 }
 
 DMErrorType Student::setName(std::string newName) {
+    DBManager::Lock lock;
     newName = DBManager::sqlInjectionCheck(newName);
     if (id == -1)
         return OBJECT_NOT_INITED;
@@ -197,6 +207,7 @@ DMErrorType Student::setName(std::string newName) {
 }
 
 Student::Student(std::string schoolNum, std::string qq, std::string name) noexcept(false) {
+    DBManager::Lock lock;
     name = DBManager::sqlInjectionCheck(name);
     if (connectDatabase()) {
         int code = DBManager::select("students", "id", "school_num=" + schoolNum);
@@ -227,6 +238,7 @@ Student::Student(std::string schoolNum, std::string qq, std::string name) noexce
 }
 
 std::vector<Student> getStudentList(long classId) noexcept(false) {
+    DBManager::Lock lock;
     std::vector<Student> result;
     if (connectDatabase()) {
         if (!DBManager::select("students", "*", "class_id=" + std::to_string(classId) + "")) {
@@ -247,7 +259,11 @@ std::vector<Student> getStudentList(long classId) noexcept(false) {
 
 //MARK: - Class类实现
 
+/// 班级结课后执行
+static void (* classEndedHandler)(long) = NULL;
+
 Class::Class(long id) noexcept(false) {
+    DBManager::Lock lock;
     if (id <= 0)
         throw DMError(INVALID_ARGUMENT);
     if (connectDatabase()) {
@@ -273,6 +289,7 @@ Class::Class(long id) noexcept(false) {
 }
 
 Class::Class(std::string inviteCode) noexcept(false) {
+    DBManager::Lock lock;
     if (inviteCode.length() != 4)
         throw DMError(INVALID_ARGUMENT);
     if (connectDatabase()) {
@@ -298,6 +315,7 @@ Class::Class(std::string inviteCode) noexcept(false) {
 }
 
 DMErrorType Class::setName(std::string newName) {
+    DBManager::Lock lock;
     newName = DBManager::sqlInjectionCheck(newName);
     if (id == -1)
         return OBJECT_NOT_INITED;
@@ -315,6 +333,7 @@ DMErrorType Class::setName(std::string newName) {
 }
 
 DMErrorType Class::setLocation(std::string newLocation) {
+    DBManager::Lock lock;
     newLocation = DBManager::sqlInjectionCheck(newLocation);
     if (id == -1)
         return OBJECT_NOT_INITED;
@@ -330,6 +349,7 @@ DMErrorType Class::setLocation(std::string newLocation) {
     }
 }
 DMErrorType Class::setTime(std::string newTime) {
+    DBManager::Lock lock;
     newTime = DBManager::sqlInjectionCheck(newTime);
     if (id == -1)
         return OBJECT_NOT_INITED;
@@ -346,6 +366,7 @@ DMErrorType Class::setTime(std::string newTime) {
 }
 
 DMErrorType Class::setInviteCode(std::string newCode) {
+    DBManager::Lock lock;
     if (id == -1)
         return OBJECT_NOT_INITED;
     if (newCode.length() != 4)
@@ -371,12 +392,15 @@ DMErrorType Class::setInviteCode(std::string newCode) {
 }
 
 DMErrorType Class::endClass() {
+    DBManager::Lock lock;
     if (id == -1)
         return OBJECT_NOT_INITED;
     if (connectDatabase()) {
         int code = DBManager::update("classes", "status=1,code=''", "id=" + std::to_string(id));
         if (!code && DBManager::affectedRowCount() > 0) {
             status = CLASS_ENDED;
+            if (classEndedHandler != NULL)
+                classEndedHandler(id);
             return SUCCESS;
         } else
             return DATABASE_OPERATION_ERROR;
@@ -386,6 +410,7 @@ DMErrorType Class::endClass() {
 }
 
 Class::Class(int teacherId, std::string name, std::string location, std::string time) noexcept(false) {
+    DBManager::Lock lock;
     name = DBManager::sqlInjectionCheck(name);
     location = DBManager::sqlInjectionCheck(location);
     time = DBManager::sqlInjectionCheck(time);
@@ -420,6 +445,7 @@ Class::Class(int teacherId, std::string name, std::string location, std::string
 }
 
 std::vector<Class> getClassList(int teacherId) noexcept(false) {
+    DBManager::Lock lock;
     if (teacherId <= 0)
         throw DMError(INVALID_ARGUMENT);
     std::vector<Class> result;
@@ -440,7 +466,30 @@ std::vector<Class> getClassList(int teacherId) noexcept(false) {
         throw DMError(CONNECTION_ERROR);
 }
 
+std::vector<Class> getEndedClassList() noexcept(false) {
+    DBManager::Lock lock;
+    std::vector<Class> result;
+    if (connectDatabase()) {
+        if (!DBManager::select("classes", "*", "status=1")) {
+            MYSQL_ROW row;
+            while ((row = DBManager::fetchRow())) {
+                std::string idStr = row[0], teacherIdStr = row[1];
+                result.push_back(Class(atol(idStr.c_str()), atoi(teacherIdStr.c_str()), row[2], (row[3]==NULL?"":row[3]), (row[4]==NULL?"":row[4]), row[5], CLASS_ENDED));
+            }
+            return result;
+        } else {
+            throw DMError(DATABASE_OPERATION_ERROR);
+        }
+    } else
+        throw DMError(CONNECTION_ERROR);
+}
+
+void setClassEndedHandler(void (* handler)(long)) {
+    classEndedHandler = handler;
+}
+
 int Class::getSize() noexcept(false) {
+    DBManager::Lock lock;
     if (id <= 0)
         return 0;
     if (connectDatabase()) {
@@ -460,6 +509,7 @@ int Class::getSize() noexcept(false) {
 }
 
 long getTotalClassSize(int teacherId) noexcept(false) {
+    DBManager::Lock lock;
     if (teacherId <= 0)
         throw DMError(INVALID_ARGUMENT);
     long result = 0;
@@ -479,6 +529,7 @@ long getTotalClassSize(int teacherId) noexcept(false) {
 }
 
 DMErrorType deleteClass(long id) {
+    DBManager::Lock lock;
     if (id <= 0)
         return INVALID_ARGUMENT;
     if (connectDatabase()) {
@@ -501,6 +552,7 @@ DMErrorType deleteClass(long id) {
 }
 
 std::vector<ScoreListItem> getScoreList(long classId) noexcept(false) {
+    DBManager::Lock lock;
     if (classId <= 0)
         throw DMError(INVALID_ARGUMENT);
     std::vector<ScoreListItem> result;
@@ -532,6 +584,7 @@ std::vector<ScoreListItem> getScoreList(long classId) noexcept(false) {
 //MARK: - Homework类实现
 
 Homework::Homework(long id) noexcept(false) {
+    DBManager::Lock lock;
     if (id <= 0)
         throw DMError(INVALID_ARGUMENT);
     if (connectDatabase()) {
@@ -557,6 +610,7 @@ Homework::Homework(long id) noexcept(false) {
 }
 
 Homework::Homework(int studentId, long assignmentId) noexcept(false) {
+    DBManager::Lock lock;
     if (connectDatabase()) {
         int code = DBManager::select("homework", "id", "student_id=" + std::to_string(studentId) + " AND assignment_id=" + std::to_string(assignmentId));
         if (!code) {
@@ -583,6 +637,7 @@ Homework::Homework(int studentId, long assignmentId) noexcept(false) {
 }
 
 DMErrorType Homework::setContentURL(std::string newURL) {
+    DBManager::Lock lock;
     if (id == -1)
         return OBJECT_NOT_INITED;
     if (connectDatabase()) {
@@ -598,6 +653,7 @@ DMErrorType Homework::setContentURL(std::string newURL) {
 }
 
 DMErrorType Homework::setAttachmentURL(std::string newURL) {
+    DBManager::Lock lock;
     if (id == -1)
         return OBJECT_NOT_INITED;
     if (connectDatabase()) {
@@ -613,6 +669,7 @@ DMErrorType Homework::setAttachmentURL(std::string newURL) {
 }
 
 DMErrorType Homework::setScore(unsigned short newScore) {
+    DBManager::Lock lock;
     if (id == -1)
         return OBJECT_NOT_INITED;
     if (connectDatabase()) {
@@ -628,6 +685,7 @@ DMErrorType Homework::setScore(unsigned short newScore) {
 }
 
 DMErrorType Homework::setComments(std::string newComments) {
+    DBManager::Lock lock;
     newComments = DBManager::sqlInjectionCheck(newComments);
     if (id == -1)
         return OBJECT_NOT_INITED;
@@ -644,6 +702,7 @@ DMErrorType Homework::setComments(std::string newComments) {
 }
 
 DMErrorType Homework::submit(std::string contentURL, std::string attachmentURL) {
+    DBManager::Lock lock;
     if (id == -1)
         return OBJECT_NOT_INITED;
     if (connectDatabase()) {
@@ -662,6 +721,7 @@ DMErrorType Homework::submit(std::string contentURL, std::string attachmentURL)
 }
 
 DMErrorType Homework::review(unsigned short score, std::string comments) {
+    DBManager::Lock lock;
     comments = DBManager::sqlInjectionCheck(comments);
     if (id == -1)
         return OBJECT_NOT_INITED;
@@ -686,6 +746,7 @@ DMErrorType Homework::review(unsigned short score, std::string comments) {
 }
 
 std::vector<Homework> getHomeworkListByAsmId(long assignmentId) noexcept(false) {
+    DBManager::Lock lock;
     if (assignmentId <= 0)
         throw DMError(INVALID_ARGUMENT);
     std::vector<Homework> result;
@@ -707,6 +768,7 @@ std::vector<Homework> getHomeworkListByAsmId(long assignmentId) noexcept(false)
 }
 
 DMErrorType deleteHomework(long id) {
+    DBManager::Lock lock;
     if (id <= 0)
         return INVALID_ARGUMENT;
     DMErrorType error = SUCCESS;
@@ -726,7 +788,11 @@ DMErrorType deleteHomework(long id) {
 
 //MARK: - Assignment类实现
 
+/// 布置的作业新建、修改截止时间或删除后执行
+static void (* assignmentHandler)(unsigned long) = NULL;
+
 Assignment::Assignment(unsigned int teacherId, std::string title, std::string description, std::string deadline, unsigned long classId) noexcept(false) {
+    DBManager::Lock lock;
     title = DBManager::sqlInjectionCheck(title);
     description = DBManager::sqlInjectionCheck(description);
     if (connectDatabase()) {
@@ -736,6 +802,8 @@ Assignment::Assignment(unsigned int teacherId, std::string title, std::string de
                 MYSQL_ROW row = DBManager::fetchRow();
                 std::string idStr = row[0];
                 id = atol(idStr.c_str());
+                if (assignmentHandler != NULL)
+                    assignmentHandler(id);
             } else
                 throw DMError(DATABASE_OPERATION_ERROR);
         } else
@@ -746,6 +814,7 @@ Assignment::Assignment(unsigned int teacherId, std::string title, std::string de
 }
 
 Assignment::Assignment(unsigned long id) noexcept(false) {
+    DBManager::Lock lock;
     if (id <= 0)
         throw DMError(INVALID_ARGUMENT);
     if (connectDatabase()) {
@@ -771,6 +840,7 @@ Assignment::Assignment(unsigned long id) noexcept(false) {
 }
 
 DMErrorType Assignment::setTitle(std::string title) {
+    DBManager::Lock lock;
     title = DBManager::sqlInjectionCheck(title);
     if (id == 0)
         return OBJECT_NOT_INITED;
@@ -780,6 +850,8 @@ DMErrorType Assignment::setTitle(std::string title) {
         int code = DBManager::update("assignments", "title='" + title + "'", "id=" + std::to_string(id));
         if (!code && DBManager::affectedRowCount() > 0) {
             this->title = title;
+            if (assignmentHandler != NULL)
+                assignmentHandler(id);
             return SUCCESS;
         } else
             return DATABASE_OPERATION_ERROR;
@@ -788,6 +860,7 @@ DMErrorType Assignment::setTitle(std::string title) {
     }
 }
 DMErrorType Assignment::setDescription(std::string description) {
+    DBManager::Lock lock;
     description = DBManager::sqlInjectionCheck(description);
     if (id == 0)
         return OBJECT_NOT_INITED;
@@ -795,6 +868,8 @@ DMErrorType Assignment::setDescription(std::string description) {
         int code = DBManager::update("assignments", "description='" + description + "'", "id=" + std::to_string(id));
         if (!code && DBManager::affectedRowCount() > 0) {
             this->description = description;
+            if (assignmentHandler != NULL)
+                assignmentHandler(id);
             return SUCCESS;
         } else
             return DATABASE_OPERATION_ERROR;
@@ -804,12 +879,15 @@ DMErrorType Assignment::setDescription(std::string description) {
 }
 
 DMErrorType Assignment::setDeadline(long time) {
+    DBManager::Lock lock;
     if (id == 0)
         return OBJECT_NOT_INITED;
     if (connectDatabase()) {
-        int code = DBManager::update("assignments", "deadline=" + std::to_string(time), "id=" + std::to_string(id));
+        int code = DBManager::update("assignments", "deadline=FROM_UNIXTIME(" + std::to_string(time) + ")", "id=" + std::to_string(id));
         if (!code && DBManager::affectedRowCount() > 0) {
             this->deadline = time;
+            if (assignmentHandler != NULL)
+                assignmentHandler(id);
             return SUCCESS;
         } else
             return DATABASE_OPERATION_ERROR;
@@ -819,6 +897,7 @@ DMErrorType Assignment::setDeadline(long time) {
 }
 
 std::vector<Assignment> getAssignmentList(unsigned int teacherId) noexcept(false) {
+    DBManager::Lock lock;
     std::vector<Assignment> result;
     if (teacherId > 0 && connectDatabase()) {
         if (!DBManager::select("assignments", "id,teacher_id,title,description,unix_timestamp(start_date),unix_timestamp(deadline),class_id", "teacher_id=" + std::to_string(teacherId))) {
@@ -839,6 +918,7 @@ std::vector<Assignment> getAssignmentList(unsigned int teacherId) noexcept(false
 }
 
 DMErrorType deleteAssignment(unsigned long id, bool (* handler)(std::vector<Homework>)) {
+    DBManager::Lock lock;
     if (connectDatabase()) {
         int code = DBManager::remove("assignments", "id=" + std::to_string(id));
         if (code || DBManager::affectedRowCount() == 0)
@@ -855,6 +935,8 @@ DMErrorType deleteAssignment(unsigned long id, bool (* handler)(std::vector<Home
                     handler(result);
                 }
             }
+            if (assignmentHandler != NULL)
+                assignmentHandler(id);
             if (DBManager::remove("homework", "assignment_id=" + std::to_string(id)))
                 return DATABASE_OPERATION_ERROR;
             return SUCCESS;
@@ -864,7 +946,71 @@ DMErrorType deleteAssignment(unsigned long id, bool (* handler)(std::vector<Home
     }
 }
 
+std::vector<Assignment> getOpenAssignmentList() noexcept(false) {
+    DBManager::Lock lock;
+    std::vector<Assignment> result;
+    if (connectDatabase()) {
+        if (!DBManager::select("assignments", "id,teacher_id,title,description,unix_timestamp(start_date),unix_timestamp(deadline),class_id", "deadline>NOW()")) {
+            MYSQL_ROW row;
+            while ((row = DBManager::fetchRow())) {
+                std::string idStr = row[0], teacherIdStr = row[1], startTimeStr = row[4], ddlStr = row[5], classIdStr = row[6];
+                result.push_back(Assignment(atol(idStr.c_str()), atoi(teacherIdStr.c_str()), row[2], row[3], atol(startTimeStr.c_str()), atol(ddlStr.c_str()), atol(classIdStr.c_str())));
+            }
+        } else {
+            throw DMError(DATABASE_OPERATION_ERROR);
+        }
+    } else {
+        throw DMError(CONNECTION_ERROR);
+    }
+    return result;
+}
+
+std::vector<Student> getUnsubmittedStudentList(unsigned long assignmentId) noexcept(false) {
+    DBManager::Lock lock;
+    if (assignmentId == 0)
+        throw DMError(INVALID_ARGUMENT);
+    std::vector<Student> result;
+    if (connectDatabase()) {
+        // 反连接：班级内没有该作业提交记录的学生
+        std::string queryStr = "SELECT students.id,students.school_num,students.qq,students.class_id,students.name,unix_timestamp(students.register_time) FROM students JOIN assignments ON students.class_id=assignments.class_id LEFT JOIN homework ON homework.student_id=students.id AND homework.assignment_id=assignments.id WHERE assignments.id=" + std::to_string(assignmentId) + " AND homework.id IS NULL";
+        if (!DBManager::query(queryStr)) {
+            MYSQL_ROW row;
+            while ((row = DBManager::fetchRow())) {
+                std::string idStr = row[0], classIdStr = row[3], timeStr = row[5];
+                result.push_back(Student(atoi(idStr.c_str()), row[1], row[2], atol(classIdStr.c_str()), row[4], atol(timeStr.c_str())));
+            }
+        } else {
+            throw DMError(DATABASE_OPERATION_ERROR);
+        }
+    } else {
+        throw DMError(CONNECTION_ERROR);
+    }
+    return result;
+}
+
+void setAssignmentHandler(void (* handler)(unsigned long)) {
+    assignmentHandler = handler;
+}
+
+/// 解析作业列表查询的一行
+/// @param row 作业与提交记录左连接的结果行
+/// @param studentId 学生ID
+static CompleteHomeworkList parseCompleteHomework(MYSQL_ROW row, int studentId) {
+    CompleteHomeworkList item;
+    std::string idStr = row[0], teacherIdStr = row[1], startTimeStr = row[4], ddlStr = row[5], classIdStr = row[6];
+    item.assignment = Assignment(atol(idStr.c_str()), atoi(teacherIdStr.c_str()), row[2], row[3], atol(startTimeStr.c_str()), atol(ddlStr.c_str()), atol(classIdStr.c_str()));
+    if (row[7] != NULL) {
+        std::string idStr = row[7], assignmentIdStr = row[9], scoreStr = row[12];
+        item.homework = Homework(atol(idStr.c_str()), studentId, atol(assignmentIdStr.c_str()), row[10], (row[11]==NULL?"":row[11]), static_cast<unsigned short>(atoi(scoreStr.c_str())), row[13]);
+    } else {
+        std::string assIdStr = row[0];
+        item.homework = Homework(-1, studentId, atol(assIdStr.c_str()), "", "", 0, "");
+    }
+    return item;
+}
+
 std::vector<CompleteHomeworkList> getHomeworkListByStuId(int studentId, long classId) noexcept(false) {
+    DBManager::Lock lock;
     if (studentId <= 0 || classId <= 0)
         throw DMError(INVALID_ARGUMENT);
     std::vector<CompleteHomeworkList> result;
@@ -874,17 +1020,7 @@ std::vector<CompleteHomeworkList> getHomeworkListByStuId(int studentId, long cla
             if (DBManager::numRows() > 0) {
                 MYSQL_ROW row;
                 while ((row = DBManager::fetchRow())) {
-                    CompleteHomeworkList item;
-                    std::string idStr = row[0], teacherIdStr = row[1], startTimeStr = row[4], ddlStr = row[5], classIdStr = row[6];
-                    item.assignment = Assignment(atol(idStr.c_str()), atoi(teacherIdStr.c_str()), row[2], row[3], atol(startTimeStr.c_str()), atol(ddlStr.c_str()), atol(classIdStr.c_str()));
-                    if (row[7] != NULL) {
-                        std::string idStr = row[7], assignmentIdStr = row[9], scoreStr = row[12];
-                        item.homework = Homework(atol(idStr.c_str()), studentId, atol(assignmentIdStr.c_str()), row[10], (row[11]==NULL?"":row[11]), static_cast<unsigned short>(atoi(scoreStr.c_str())), row[13]);
-                    } else {
-                        std::string assIdStr = row[0];
-                        item.homework = Homework(-1, studentId, atol(assIdStr.c_str()), "", "", 0, "");
-                    }
-                    result.push_back(item);
+                    result.push_back(parseCompleteHomework(row, studentId));
                 }
                 return result;
             } else {
@@ -896,5 +1032,28 @@ std::vector<CompleteHomeworkList> getHomeworkListByStuId(int studentId, long cla
     } else
         throw DMError(CONNECTION_ERROR);
 }
+
+std::vector<CompleteHomeworkList> getHomeworkListByStuId(int studentId, long classId, unsigned long beforeId, unsigned long limit) noexcept(false) {
+    DBManager::Lock lock;
+    if (studentId <= 0 || classId <= 0 || limit == 0)
+        throw DMError(INVALID_ARGUMENT);
+    std::vector<CompleteHomeworkList> result;
+    if (connectDatabase()) {
+        std::string queryStr = "SELECT * FROM (SELECT id,teacher_id,title,description,unix_timestamp(start_date),unix_timestamp(deadline),class_id FROM assignments WHERE class_id=" + std::to_string(classId) + (beforeId > 0 ? " AND id<" + std::to_string(beforeId) : "") + " ORDER BY id DESC LIMIT " + std::to_string(limit) + ") AS ass_list LEFT JOIN homework ON homework.student_id=" + std::to_string(studentId) + " AND homework.assignment_id=ass_list.id ORDER BY ass_list.id DESC";
+        if (!DBManager::query(queryStr)) {
+            // 一页不超过limit行，缓存整页后读取
+            result.reserve(DBManager::numRows());
+            MYSQL_ROW row;
+            while ((row = DBManager::fetchRow())) {
+                result.push_back(parseCompleteHomework(row, studentId));
+            }
+        } else {
+            throw DMError(DATABASE_OPERATION_ERROR);
+        }
+    } else {
+        throw DMError(CONNECTION_ERROR);
+    }
+    return result;
+}
     
 }
@@ -196,6 +196,13 @@ public:
 /// @param teacherId 教师ID
 std::vector<Class> getClassList(int teacherId) noexcept(false);
 
+/// 获取已结课的班级列表
+std::vector<Class> getEndedClassList() noexcept(false);
+
+/// 设置班级结课后执行的函数（仅对本进程内的修改生效）
+/// @param handler 接受班级ID的函数，传入NULL取消
+void setClassEndedHandler(void (* handler)(long));
+
 /// 获取总学生人数
 /// @param teacherId 教师ID
 long getTotalClassSize(int teacherId) noexcept(false);
@@ -396,11 +403,30 @@ typedef struct {
 /// @param classId 学生所在班级的ID（增加这一项是为了减少一次数据库的查询）
 std::vector<CompleteHomeworkList> getHomeworkListByStuId(int studentId, long classId) noexcept(false);
 
+/// 分页获取某个学生的作业列表，按作业ID从新到旧排列，一页的结果整体读取
+/// @param studentId 学生ID
+/// @param classId 学生所在班级的ID
+/// @param beforeId 只返回ID小于该值的作业，即上一页最后一项的ID，0为从最新的作业开始；翻页期间新增的作业不会使后续页重复
+/// @param limit 本页最多返回的作业数
+/// @returns 本页作业，没有更早的作业时为空
+std::vector<CompleteHomeworkList> getHomeworkListByStuId(int studentId, long classId, unsigned long beforeId, unsigned long limit) noexcept(false);
+
 /// 删除布置的作业，同时从数据库移除提交到该任务的所有作业记录
 /// @param id 布置的作业ID
 /// @param handler 接受提交的作业列表的函数
 DMErrorType deleteAssignment(unsigned long id, bool (* handler)(std::vector<Homework>) = NULL);
 
+/// 获取截止时间未到的布置的作业列表
+std::vector<Assignment> getOpenAssignmentList() noexcept(false);
+
+/// 获取尚无提交记录的学生列表
+/// @param assignmentId 布置的作业ID
+std::vector<Student> getUnsubmittedStudentList(unsigned long assignmentId) noexcept(false);
+
+/// 设置布置的作业新建、修改标题、内容、截止时间或删除后执行的函数（仅对本进程内的修改生效）
+/// @param handler 接受布置的作业ID的函数，传入NULL取消
+void setAssignmentHandler(void (* handler)(unsigned long));
+
 }
 
 #pragma GCC visibility pop
@@ -1,10 +1,11 @@
 ﻿#include <iostream>
 #include <string>
+#include <vector>
 
 #include "QQMessage.h"
 std::string rootPath = R"(tmp)";
 
-int main()
+int main(int argc, char* argv[])
 {
     //system("CHCP 65001");
     
@@ -12,8 +13,27 @@ int main()
     //Sleep(8000);
     try
     {
-        //QQMessage::_InitClient("127.0.0.1:6700");
-        QQMessage::_InitClient("42.193.50.174:6700");
+        //命令行参数为go-cqhttp地址 ip:port，可传入多个账号；压测时指向QQMessageSimulator
+        //--compress 正文与代码压缩存储，默认按原样存储；--student-quota、--class-quota 存储配额（MB），0为不限
+        std::vector<std::string> urls;
+        bool compressText = false;
+        unsigned long long studentQuota = 1024, classQuota = 0;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string option = argv[i];
+            if (option == "--compress") compressText = true;
+            else if (option == "--student-quota" && i + 1 < argc) studentQuota = std::strtoull(argv[++i], nullptr, 10);
+            else if (option == "--class-quota" && i + 1 < argc) classQuota = std::strtoull(argv[++i], nullptr, 10);
+            else urls.push_back(option);
+        }
+        QQMessage::_InitStorage(compressText, studentQuota, classQuota);
+        if (!urls.empty())
+            QQMessage::_InitClient(urls);
+        else
+            //QQMessage::_InitClient("127.0.0.1:6700");
+            QQMessage::_InitClient("42.193.50.174:6700");
+        //先载入未完成的通知与提醒，再接受App请求
+        QQMessage::_InitScheduler();
         QQMessage::_InitServer(6701);
     }
     catch (std::exception& e)
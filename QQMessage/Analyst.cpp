@@ -1,34 +1,60 @@
 ﻿#define _CRT_SECURE_NO_WARNINGS
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <string>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <sstream>
 #include <stdlib.h>
 #include "Tools.h"
+#include "StringTools.h"
 #include "PrivateMessageSender.h"
+#include "JsonWriter.h"
 #include "Analyst.h"
 #include <DataManager.hpp>
 #include "File.h"
+#include "NotificationJob.h"
+#include "ReplyCache.h"
+#include "SessionMap.h"
 #include <ctime>
 #include <regex>
+#include <string_view>
 
 extern std::string connectUrl;
-extern std::map<long long, PeerStatus> status;
-extern std::map<long long, RegInfo> regStatus;
-extern std::map<long long, StuInfo> getStuInfo;
-extern std::map<long long, HomeworkInfo> getHomeworkInfo;
+extern SessionMap<PeerStatus> status;
+extern SessionMap<RegInfo> regStatus;
+extern SessionMap<StuInfo> getStuInfo;
+extern SessionMap<HomeworkInfo> getHomeworkInfo;
+extern SessionMap<FloodInfo> floodStatus;
+extern SessionMap<ListPage> listPage;
 
-extern WebsocketClient wsClient;
+extern NotificationJobManager notificationJobs;
+extern ReplyCache replyCache;
 
-std::string helper = u8"【注册】\n新用户通过注册提交所属班级、真实姓名与学号，信息一旦提交后学生无法自行修改。\n注册中可通过取消命令退出注册。\n\n命令\n注册\n[Rr]eg\n[Rr]egister\n--------\n【个人信息】\n注册成功后可查询人信息，包括姓名、学号、班级和老师。\n\n命令\n查询个人信息\n获取个人信息\n[Gg]etinfo\n--------\n【作业列表】\n用户可查询个人所有作业，包括作业ID、作业状态、截止时间、分数\n\n命令\n查询作业\n获取作业\n[Gg]et\n[Gg]ethomework\n--------\n【作业详情】\n用户通过指定作业ID查询当前作业情。\n\n包括\n作业ID、作业状态、作业内容、截止时间\n分数、评语\n作业正文列表、作业附件列表\n\n命令\n查询作业 {作业ID}\n获取作业 {作业ID}\n[Gg]et {作业ID}\n[Gg]ethomework {作业ID}\n--------\n【提交作业】\n用户通过指定作业ID进入提交模式，已提交作业自动修改。\n详细操作可输入“帮助 提交模式”查看。\n\n命令\n提交作业 {作业ID}\n[Ss]ubmit {作业ID}\n--------\n【修改作业】\n用户通过指定作业ID进入提交模式，未提交作业自动新建。\n详细操作可输入“帮助 提交模式”查看。\n\n命令\n修改作业 {作业ID}\n[Mm]odify {作业ID}\n--------\n【帮助】\n显示本文档\n更多帮助信息可输入“帮助 提交”查看\n\n命令\n帮助\n[Hh]elp";
-std::string regHelper = u8"您正处于注册模式中\n注册需要填写班级邀请码、学生姓名、学号\n--------\n【取消注册】\n删除所有已填写信息，重置为未注册状态\n\n命令\n取消\n[Cc]ancel\n";
-std::string subHelper = u8"【提交内容】\n文本和图片可直接在对话框内输入发送，在本地分别保存为txt文件与图片文件\n--------\n【文件列表】\n查询该作业下存在的文件，输出文件名(含扩展名)\n\n命令\n获取文列表\n查询文件列表\n[Gg]etlist\n--------\n【查询文件】\n用户通过指定文件名(含扩展名)，返回文件内容\n目前可返回文本文件、代码文件\n\n命令\n获取 {文件名}\n获取文件 {文件名}\n查询 {文件名}\n查询文件 {文件名}\n[Gg]et {文件名}\n--------\n【删除文件】\n用户通过指定文件名(含扩展名)，删除文件\n可使用|分隔符分隔多个文件名，批量删除\n\n命令\n删除文件 {文件名1|文件名2|...}\n删除 {文件名1|文件名2|...}\n[Dd]elete {文件名1|文件名2|...}\n--------\n【删除所有文件】\n清空该作业下所有文件\n！注意：该操作无法恢复\n\n命令\n全部删除\n删除全部\n清空文件\n[Dd]eleteall\n--------\n【取消提交】\n退出提交模式，所文件保存为草稿\n任何修改都不会返回给教师\n\n命令\n取消\n取消提交\n[Cc]ancel\n--------\n【保存提交】\n保存作业并向教师提交\n\n命令\n提交\n提交作业\n确认提交\n[Ss]ubmit";
-std::string homHelper1 = u8"您正处于提交模式中\n正在提交 作业 ";
-std::string homHelper2 = u8"\n--------\n【提交内容】\n文本和图片可直接在对话框内输入发送，在本地分别保存为txt文件与图片文件\n--------\n【文件列表】\n查询该作业下存在的文件，输出文件名(含扩展名)\n\n命令\n获取文列表\n查询文件列表\n[Gg]etlist\n--------\n【查询文件】\n用户通过指定文件名(含扩展名)，返回文件内容\n目前可返回文本文件、代码文件\n\n命令\n获取 {文件名}\n获取文件 {文件名}\n查询 {文件名}\n查询文件 {文件名}\n[Gg]et {文件名}\n--------\n【删除文件】\n用户通过指定文件名(含扩展名)，删除文件\n可使用|分隔符分隔多个文件名，批量删除\n\n命令\n删除文件 {文件名1|文件名2|...}\n删除 {文件名1|文件名2|...}\n[Dd]elete {文件名1|文件名2|...}\n--------\n【删除所有文件】\n清空该作业下所有文件\n！注意：该操作无法恢复\n\n命令\n全部删除\n删除全部\n清空文件\n[Dd]eleteall\n--------\n【取消提交】\n退出提交模式，所文件保存为草稿\n任何修改都不会返回给教师\n\n命令\n取消\n取消提交\n[Cc]ancel\n--------\n【保存提交】\n保存作业并向教师提交\n\n命令\n提交\n提交作业\n确认提交\n[Ss]ubmit";
+const JsonFragment helper(u8"【注册】\n新用户通过注册提交所属班级、真实姓名与学号，信息一旦提交后学生无法自行修改。\n注册中可通过取消命令退出注册。\n\n命令\n注册\n[Rr]eg\n[Rr]egister\n--------\n【个人信息】\n注册成功后可查询人信息，包括姓名、学号、班级和老师。\n\n命令\n查询个人信息\n获取个人信息\n[Gg]etinfo\n--------\n【作业列表】\n用户可查询个人所有作业，包括作业ID、作业状态、截止时间、分数\n\n命令\n查询作业\n获取作业\n[Gg]et\n[Gg]ethomework\n--------\n【下一页】\n作业较多时分页发送，每页20项，从新到旧排列，查看更早的作业\n\n命令\n下一页\n[Nn]ext\n--------\n【作业详情】\n用户通过指定作业ID查询当前作业情。\n\n包括\n作业ID、作业状态、作业内容、截止时间\n分数、评语\n作业正文列表、作业附件列表\n\n命令\n查询作业 {作业ID}\n获取作业 {作业ID}\n[Gg]et {作业ID}\n[Gg]ethomework {作业ID}\n--------\n【提交作业】\n用户通过指定作业ID进入提交模式，已提交作业自动修改。\n详细操作可输入“帮助 提交模式”查看。\n\n命令\n提交作业 {作业ID}\n[Ss]ubmit {作业ID}\n--------\n【修改作业】\n用户通过指定作业ID进入提交模式，未提交作业自动新建。\n详细操作可输入“帮助 提交模式”查看。\n\n命令\n修改作业 {作业ID}\n[Mm]odify {作业ID}\n--------\n【帮助】\n显示本文档\n更多帮助信息可输入“帮助 提交”查看\n\n命令\n帮助\n[Hh]elp");
+const JsonFragment regHelper(u8"您正处于注册模式中\n注册需要填写班级邀请码、学生姓名、学号\n--------\n【取消注册】\n删除所有已填写信息，重置为未注册状态\n\n命令\n取消\n[Cc]ancel\n");
+const JsonFragment subHelper(u8"【提交内容】\n文本和图片可直接在对话框内输入发送，在本地分别保存为txt文件与图片文件\n--------\n【文件列表】\n查询该作业下存在的文件，输出文件名(含扩展名)\n\n命令\n获取文列表\n查询文件列表\n[Gg]etlist\n--------\n【查询文件】\n用户通过指定文件名(含扩展名)，返回文件内容\n目前可返回文本文件、代码文件\n\n命令\n获取 {文件名}\n获取文件 {文件名}\n查询 {文件名}\n查询文件 {文件名}\n[Gg]et {文件名}\n--------\n【删除文件】\n用户通过指定文件名(含扩展名)，删除文件\n可使用|分隔符分隔多个文件名，批量删除\n\n命令\n删除文件 {文件名1|文件名2|...}\n删除 {文件名1|文件名2|...}\n[Dd]elete {文件名1|文件名2|...}\n--------\n【删除所有文件】\n清空该作业下所有文件\n！注意：该操作无法恢复\n\n命令\n全部删除\n删除全部\n清空文件\n[Dd]eleteall\n--------\n【取消提交】\n退出提交模式，所文件保存为草稿\n任何修改都不会返回给教师\n\n命令\n取消\n取消提交\n[Cc]ancel\n--------\n【保存提交】\n保存作业并向教师提交\n\n命令\n提交\n提交作业\n确认提交\n[Ss]ubmit");
+const JsonFragment homHelper1(u8"您正处于提交模式中\n正在提交 作业 ");
+const JsonFragment homHelper2(u8"\n--------\n【提交内容】\n文本和图片可直接在对话框内输入发送，在本地分别保存为txt文件与图片文件\n--------\n【文件列表】\n查询该作业下存在的文件，输出文件名(含扩展名)\n\n命令\n获取文列表\n查询文件列表\n[Gg]etlist\n--------\n【查询文件】\n用户通过指定文件名(含扩展名)，返回文件内容\n目前可返回文本文件、代码文件\n\n命令\n获取 {文件名}\n获取文件 {文件名}\n查询 {文件名}\n查询文件 {文件名}\n[Gg]et {文件名}\n--------\n【删除文件】\n用户通过指定文件名(含扩展名)，删除文件\n可使用|分隔符分隔多个文件名，批量删除\n\n命令\n删除文件 {文件名1|文件名2|...}\n删除 {文件名1|文件名2|...}\n[Dd]elete {文件名1|文件名2|...}\n--------\n【删除所有文件】\n清空该作业下所有文件\n！注意：该操作无法恢复\n\n命令\n全部删除\n删除全部\n清空文件\n[Dd]eleteall\n--------\n【取消提交】\n退出提交模式，所文件保存为草稿\n任何修改都不会返回给教师\n\n命令\n取消\n取消提交\n[Cc]ancel\n--------\n【保存提交】\n保存作业并向教师提交\n\n命令\n提交\n提交作业\n确认提交\n[Ss]ubmit");
 
+/// <summary>
+/// 提交模式命令别名
+/// </summary>
+namespace HomAlias
+{
+	const std::initializer_list<std::string_view> cancel = { u8"取消", u8"取消提交", u8"Cancel", u8"cancel" };
+	const std::initializer_list<std::string_view> help = { u8"帮助", u8"Help", u8"help" };
+	const std::initializer_list<std::string_view> deleteAll = { u8"全部删除", u8"删除全部", u8"清空文件", u8"Deleteall", u8"deleteall" };
+	const std::initializer_list<std::string_view> deleteFile = { u8"删除文件", u8"删除", u8"Delete", u8"delete" };
+	const std::initializer_list<std::string_view> getList = { u8"获取文件列表", u8"查询文件列表", u8"Getlist", u8"getlist" };
+	const std::initializer_list<std::string_view> getFile = { u8"获取文件", u8"查询文件", u8"获取", u8"查询", u8"Get", u8"get" };
+	const std::initializer_list<std::string_view> submit = { u8"提交作业", u8"确认提交", u8"提交", u8"Submit", u8"submit" };
+}
 
-void RegCommand(std::u16string data, long long qq_id);
-void HomCommand(std::u16string data, long long qq_id);
+void RegCommand(std::string_view data, long long qq_id);
+void HomCommand(std::string_view data, long long qq_id);
 /// <summary>
 /// 转换作业状态
 /// </summary>
@@ -41,94 +67,6 @@ std::string getHomeworkStatus(int id)
 	if (id == 2) return u8"已批改";
 	return u8"未知状态";
 }
-/// <summary>
-/// 字符串分隔
-/// </summary>
-/// <param name="s">原始字符串</param>
-/// <param name="seperator">分隔符 可多个</param>
-/// <returns>分隔后字符串列表</returns>
-std::vector<std::string> split(const std::string& s, const std::string& seperator) {
-	std::vector<std::string> result;
-	typedef std::string::size_type string_size;
-	string_size i = 0;
-
-	while (i != s.size()) {
-		//找到字符串中首个不等于分隔符的字母；
-		int flag = 0;
-		while (i != s.size() && flag == 0) {
-			flag = 1;
-			for (string_size x = 0; x < seperator.size(); ++x)
-				if (s[i] == seperator[x]) {
-					++i;
-					flag = 0;
-					break;
-				}
-		}
-
-		//找到又一个分隔符，将两个分隔符之间的字符串取出；
-		flag = 0;
-		string_size j = i;
-		while (j != s.size() && flag == 0) {
-			for (string_size x = 0; x < seperator.size(); ++x)
-				if (s[j] == seperator[x]) {
-					flag = 1;
-					break;
-				}
-			if (flag == 0)
-				++j;
-		}
-		if (i != j) {
-			result.push_back(s.substr(i, j - i));
-			i = j;
-		}
-	}
-	return result;
-}
-
-/// <summary>
-/// 字符串分隔
-/// </summary>
-/// <param name="s">原始字符串</param>
-/// <param name="seperator">分隔符 可多个</param>
-/// <returns>分隔后字符串列表</returns>
-std::vector<std::u16string> split(const std::u16string& s, const std::u16string& seperator) {
-	std::vector<std::u16string> result;
-	typedef std::u16string::size_type string_size;
-	string_size i = 0;
-
-	while (i != s.size()) {
-		//找到字符串中首个不等于分隔符的字母；
-		int flag = 0;
-		while (i != s.size() && flag == 0) {
-			flag = 1;
-			for (string_size x = 0; x < seperator.size(); ++x)
-				if (s[i] == seperator[x]) {
-					++i;
-					flag = 0;
-					break;
-				}
-		}
-
-		//找到又一个分隔符，将两个分隔符之间的字符串取出；
-		flag = 0;
-		string_size j = i;
-		while (j != s.size() && flag == 0) {
-			for (string_size x = 0; x < seperator.size(); ++x)
-				if (s[j] == seperator[x]) {
-					flag = 1;
-					break;
-				}
-			if (flag == 0)
-				++j;
-		}
-		if (i != j) {
-			result.push_back(s.substr(i, j - i));
-			i = j;
-		}
-	}
-	return result;
-}
-
 /// <summary>
 /// 获取文件名列表
 /// </summary>
@@ -136,12 +74,12 @@ std::vector<std::u16string> split(const std::u16string& s, const std::u16string&
 /// <returns>返回文件名 空格分隔</returns>
 std::string getHomeworkFilename(std::string raw)
 {
-	std::vector<std::u16string> rawList = split(Tools::to_utf16(raw), u"|");
 	std::string result;
-	for (auto& iter : rawList)
+	for (std::string_view iter : StringTools::split(raw, "|"))
 	{
-		std::filesystem::path file = iter;
-		result += (file.filename().string()+"  ");
+		size_t pos = iter.find_last_of("/\\");
+		result += (pos == std::string_view::npos ? iter : iter.substr(pos + 1));
+		result += "  ";
 	}
 	return result;
 }
@@ -191,15 +129,292 @@ DataManager::CompleteHomeworkList getCH(long long qq_id,long long assignmentId)
 	throw DataManager::DMException::TARGET_NOT_FOUND();
 }
 
-void AnaText(std::u16string data, long long qq_id)
+/// <summary>
+/// 作业列表每页的作业数
+/// </summary>
+const unsigned long HOMEWORK_PAGE_SIZE = 20;
+
+/// <summary>
+/// 发送一页作业列表
+/// <para>逐行生成，超过单条消息长度时分条发送，还有更早的作业时记录本页最后一项作为下一页位置</para>
+/// </summary>
+/// <param name="qq_id">对象qq</param>
+/// <param name="position">翻页位置，默认为第一页</param>
+void sendHomeworkList(long long qq_id, ListPage position = ListPage())
+{
+	listPage.erase(qq_id);
+	std::vector<DataManager::CompleteHomeworkList> homeworklist;
+	try
+	{
+		//多取一项判断是否还有下一页
+		homeworklist = DataManager::getHomeworkListByStuId((int)getStuInfo[qq_id].studentId, (long)getStuInfo[qq_id].classId, position.lastId, HOMEWORK_PAGE_SIZE + 1);
+	}
+	catch (...)
+	{
+	}
+	if (homeworklist.empty())
+	{
+		PrivateMessageSender sender(qq_id, position.page == 1 ? u8"作业列表如下\r\n暂无作业" : u8"没有更早的作业");
+		sender.send();
+		return;
+	}
+	bool hasMore = homeworklist.size() > HOMEWORK_PAGE_SIZE;
+	if (hasMore) homeworklist.pop_back();
+
+	//每行由缓存的作业片段拼接，只有状态与分数逐人生成
+	JsonFragment message(position.page == 1 ? u8"作业列表如下\r\n" : u8"作业列表 第" + std::to_string(position.page) + u8"页\r\n");
+	for (auto& iter : homeworklist)
+	{
+		auto fragments = replyCache.get(iter.assignment);
+		int status = iter.homework.getStatus();
+		JsonFragment line = fragments->listTitle;
+		line.append(getHomeworkStatus(status) + u8"  ");
+		if (status == 0)//未提交
+		{
+			if (std::time(0) > iter.assignment.getDeadline())
+			{
+				line.append(u8"已截止提交");
+			}
+			else
+			{
+				line.append(u8"截止时间：");
+				line.append(fragments->deadline);
+			}
+		}
+		if (status == 2)//已批改
+		{
+			line.append(u8"分数：" + std::to_string(iter.homework.getScore()));
+		}
+		line.append("\r\n");
+		if (!message.empty() && message.str().size() + line.str().size() > PrivateMessageSender::MAX_MESSAGE_SIZE)
+		{
+			PrivateMessageSender sender(qq_id, std::move(message));
+			sender.send();
+			message = JsonFragment();
+		}
+		message.append(line);
+	}
+	if (hasMore)
+	{
+		//按ID翻页，翻页期间新布置的作业不会使下一页重复
+		listPage[qq_id] = ListPage{ homeworklist.back().assignment.getId(), position.page + 1 };
+		message.append(u8"输入“下一页”查看更早的作业");
+	}
+	PrivateMessageSender sender(qq_id, std::move(message));
+	sender.send();
+}
+
+/// <summary>
+/// 发送作业详情
+/// </summary>
+/// <param name="qq_id">对象qq</param>
+/// <param name="assignmentId">作业id</param>
+void sendHomeworkDetail(long long qq_id, long long assignmentId)
+{
+	try
+	{
+		DataManager::CompleteHomeworkList ch = getCH(qq_id, assignmentId);
+		auto fragments = replyCache.get(ch.assignment);
+
+		//标题、内容与截止时间取自缓存片段
+		JsonFragment message;
+		int homeworkStatus = ch.homework.getStatus();
+		if (homeworkStatus == 0)//未提交
+		{
+			message.append(u8"【作业 " + std::to_string(ch.assignment.getId()) + u8"】  " + getHomeworkStatus(homeworkStatus) + u8"\r\n");
+			message.append(fragments->detail);
+			message.append(u8"【截止时间】  ");
+			message.append(fragments->deadline);
+			message.append(u8"\r\n");
+			PrivateMessageSender sender(qq_id, std::move(message));
+			sender.send();
+			return;
+		}
+		if (homeworkStatus == 1)//已提交
+		{
+			message.append(u8"【作业 " + std::to_string(ch.assignment.getId()) + u8"】  " + getHomeworkStatus(homeworkStatus) + u8"\n\n");
+			message.append(fragments->detail);
+			message.append(u8"【截止时间】  ");
+			message.append(fragments->deadline);
+			message.append(u8"\n\n");
+			message.append(u8"【作业正文列表】\r\n" + getHomeworkFilename(ch.homework.getContentURL()) + u8"\r\n");
+			message.append(u8"【作业附件列表】\r\n" + getHomeworkFilename(ch.homework.getAttachmentURL()) + u8"\r\n");
+			PrivateMessageSender sender(qq_id, std::move(message));
+			sender.send();
+			return;
+		}
+		if (homeworkStatus == 2)//已批改
+		{
+			message.append(u8"【作业 " + std::to_string(ch.assignment.getId()) + u8"】  " + getHomeworkStatus(homeworkStatus) + u8"\n\n");
+			message.append(fragments->detail);
+			message.append(u8"【截止时间】  ");
+			message.append(fragments->deadline);
+			message.append(u8"\n\n");
+			message.append(u8"【分数】 " + std::to_string(ch.homework.getScore()) + u8"\r\n");
+			message.append(u8"【评语】\r\n" + ch.homework.getComments() + u8"\n\n");
+			message.append(u8"【作业正文列表】\r\n" + getHomeworkFilename(ch.homework.getContentURL()) + u8"\r\n");
+			message.append(u8"【作业附件列表】\r\n" + getHomeworkFilename(ch.homework.getAttachmentURL()) + u8"\r\n");
+			PrivateMessageSender sender(qq_id, std::move(message));
+			sender.send();
+			return;
+		}
+	}
+	catch (DataManager::DMException::TARGET_NOT_FOUND)//无作业
+	{
+		PrivateMessageSender sender(qq_id, u8"暂无该作业，请重试");
+		sender.send();
+		return;
+	}
+	catch (std::exception)
+	{
+		PrivateMessageSender sender(qq_id, u8"未知错误，请重试");
+		sender.send();
+		return;
+	}
+}
+
+/// <summary>
+/// 检测是否为提交模式命令
+/// </summary>
+/// <param name="data">utf8聊天消息</param>
+/// <returns></returns>
+bool isHomCommand(std::string_view data)
+{
+	return Tools::equalsAny(data, HomAlias::cancel) || Tools::equalsAny(data, HomAlias::help) || Tools::equalsAny(data, HomAlias::deleteAll)
+		|| Tools::matchPrefix(data, HomAlias::deleteFile) || Tools::equalsAny(data, HomAlias::getList) || Tools::matchPrefix(data, HomAlias::getFile)
+		|| Tools::equalsAny(data, HomAlias::submit);
+}
+
+/// <summary>
+/// 每个学生同时进行的图片下载数，超出的排队
+/// </summary>
+const size_t PICTURE_DOWNLOADS_PER_USER = 6;
+std::mutex pictureMutex;
+/// <summary>
+/// 进行中的图片下载数【qq，下载数】
+/// </summary>
+std::map<long long, size_t> pictureActive;
+/// <summary>
+/// 排队的图片下载【qq，开始下载的函数】
+/// </summary>
+std::map<long long, std::deque<std::function<void()>>> pictureWaiting;
+
+/// <summary>
+/// 在该学生的并发上限内开始下载，否则排队
+/// </summary>
+void startPictureDownload(long long qq_id, std::function<void()> start)
+{
+	{
+		std::lock_guard<std::mutex> lock(pictureMutex);
+		size_t& active = pictureActive[qq_id];
+		if (active >= PICTURE_DOWNLOADS_PER_USER)
+		{
+			pictureWaiting[qq_id].push_back(std::move(start));
+			return;
+		}
+		active++;
+	}
+	start();
+}
+
+/// <summary>
+/// 一个下载结束，开始该学生排队的下一个
+/// </summary>
+void endPictureDownload(long long qq_id)
+{
+	std::function<void()> next;
+	{
+		std::lock_guard<std::mutex> lock(pictureMutex);
+		auto waiting = pictureWaiting.find(qq_id);
+		if (waiting != pictureWaiting.end())
+		{
+			next = std::move(waiting->second.front());
+			waiting->second.pop_front();
+			if (waiting->second.empty()) pictureWaiting.erase(waiting);
+		}
+		else if (--pictureActive[qq_id] == 0)
+		{
+			pictureActive.erase(qq_id);
+		}
+	}
+	if (next) next();
+}
+
+/// <summary>
+/// 一条消息中全部图片下载结束后执行，参数为按消息顺序的文件名与是否保存成功
+/// </summary>
+typedef std::function<void(const std::vector<std::string>& fileNames, const std::vector<bool>& saved)> PicturesCallback;
+
+/// <summary>
+/// 为消息中的图片预留文件名，并将CQ码替换为文件名
+/// </summary>
+/// <param name="msg">utf8消息</param>
+/// <param name="qq_id">对象qq</param>
+/// <returns>按消息顺序的【文件名，下载地址】</returns>
+std::vector<std::pair<std::string, std::string>> reservePictures(std::string& msg, long long qq_id)
+{
+	std::regex findURL("url=(.*?)\\]");
+	std::regex findCQ("\\[(.*?)\\]");
+	std::sregex_token_iterator endURL;
+	std::string tmp = msg;
+	std::vector<std::pair<std::string, std::string>> pictures;
+	File fl(getHomeworkInfo[qq_id]);
+	for (std::sregex_token_iterator posURL(tmp.cbegin(), tmp.cend(), findURL, 1), posCQ(tmp.cbegin(), tmp.cend(), findCQ, 1); posURL != endURL; ++posURL, ++posCQ)
+	{
+		std::string fileName = fl.reservePic();
+		msg.replace(msg.find(posCQ->str()), posCQ->str().length(), fileName);
+		pictures.emplace_back(fileName, posURL->str());
+	}
+	return pictures;
+}
+
+/// <summary>
+/// 并行下载已预留的图片，全部结束后执行一次回调
+/// </summary>
+/// <param name="qq_id">对象qq</param>
+/// <param name="pictures">reservePictures的结果</param>
+/// <param name="callback">在下载线程中执行，可为空</param>
+void storePictures(long long qq_id, const std::vector<std::pair<std::string, std::string>>& pictures, PicturesCallback callback)
+{
+	if (pictures.empty()) return;
+	struct Batch
+	{
+		std::vector<std::string> fileNames;
+		//各下载写入不同下标，vector<bool>按位存储不能并发写
+		std::vector<char> saved;
+		std::atomic<size_t> remaining;
+		PicturesCallback callback;
+	};
+	auto batch = std::make_shared<Batch>();
+	for (auto& picture : pictures) batch->fileNames.push_back(picture.first);
+	batch->saved.assign(pictures.size(), false);
+	batch->remaining = pictures.size();
+	batch->callback = std::move(callback);
+	File fl(getHomeworkInfo[qq_id]);
+	for (size_t i = 0; i < pictures.size(); i++)
+	{
+		startPictureDownload(qq_id, [fl, url = pictures[i].second, i, batch, qq_id]() mutable
+			{
+				fl.downReserved(url, batch->fileNames[i], [i, batch, qq_id](bool ok)
+					{
+						batch->saved[i] = ok;
+						endPictureDownload(qq_id);
+						//最后一个结束时remaining的递减保证其余结果可见
+						if (--batch->remaining != 0 || !batch->callback) return;
+						batch->callback(batch->fileNames, std::vector<bool>(batch->saved.begin(), batch->saved.end()));
+					});
+			});
+	}
+}
+
+void AnaText(std::string_view data, long long qq_id)
 {
 	typedef std::pair<long long, PeerStatus> pair;
-	std::u16string subCom, retInfo;
 
 	//添加当前状态
 	if (!status.count(qq_id)) status.insert(pair(qq_id, PeerStatus::IDLE));
 	//本地化学生数据
-	if ((status[qq_id] != PeerStatus::REGISTER)&&!getStuInfo.count(qq_id) && (status[qq_id] != PeerStatus::UNREG)) 
+	if ((status[qq_id] != PeerStatus::REGISTER)&&!getStuInfo.count(qq_id) && (status[qq_id] != PeerStatus::UNREG))
 	{
 		try
 		{
@@ -219,23 +434,19 @@ void AnaText(std::u16string data, long long qq_id)
 	//注册中
 	if (status[qq_id] == PeerStatus::REGISTER)
 	{
-		subCom = data;
-		Tools::delSpaceAhead(subCom);
-		RegCommand(subCom, qq_id);
+		RegCommand(StringTools::trimLeft(data), qq_id);
 		return;
 	}
 
 	//提交作业中
 	if (status[qq_id] == PeerStatus::HOMEWORK)
 	{
-		subCom = data;
-		Tools::delSpaceAhead(subCom);
-		HomCommand(subCom, qq_id);
+		HomCommand(StringTools::trimLeft(data), qq_id);
 		return;
 	}
 
 	//开始注册
-	if (data == u"注册"|| data == u"reg" || data == u"register"|| data == u"Register"|| data == u"Reg")
+	if (Tools::equalsAny(data, { u8"注册", u8"reg", u8"register", u8"Register", u8"Reg" }))
 	{
 		if (status[qq_id] == PeerStatus::UNREG)
 			status[qq_id] = PeerStatus::REGISTER;
@@ -245,20 +456,19 @@ void AnaText(std::u16string data, long long qq_id)
 			sender.send();
 			return;
 		}
-		subCom = Tools::delFirstCom(data, 2);
 		status[qq_id] = PeerStatus::REGISTER;
-		RegCommand(subCom, qq_id);
+		RegCommand(std::string_view(), qq_id);
 		return;
 	}
 
-	if (data == u"帮助" || data == u"Help" || data == u"help")
+	if (Tools::equalsAny(data, { u8"帮助", u8"Help", u8"help" }))
 	{
 		PrivateMessageSender sender(qq_id, helper);
 		sender.send();
 		return;
 	}
 
-	if (data == u"帮助 提交模式" || data == u"Help 提交模式" || data == u"help 提交模式" || data == u"help submit" || data == u"Help Submit")
+	if (Tools::equalsAny(data, { u8"帮助 提交模式", u8"Help 提交模式", u8"help 提交模式", u8"help submit", u8"Help Submit" }))
 	{
 		PrivateMessageSender sender(qq_id, subHelper);
 		sender.send();
@@ -277,7 +487,7 @@ void AnaText(std::u16string data, long long qq_id)
 	if (status[qq_id] == PeerStatus::IDLE)
 	{
 		//查询个人信息
-		if (data==u"查询个人信息"|| data == u"获取个人信息" || data == u"getinfo" || data == u"Getinfo")
+		if (Tools::equalsAny(data, { u8"查询个人信息", u8"获取个人信息", u8"getinfo", u8"Getinfo" }))
 		{
 			try {
 				DataManager::Student st((int)getStuInfo[qq_id].studentId);
@@ -305,387 +515,43 @@ void AnaText(std::u16string data, long long qq_id)
 			}
 		}
 
-		//查询作业（列表）
-		if (data.substr(0, 4) == u"查询作业"|| data.substr(0, 4) == u"获取作业")
+		//作业列表下一页
+		if (Tools::equalsAny(data, { u8"下一页", u8"next", u8"Next" }))
 		{
-			std::string assignmentId_str = Tools::to_utf8(Tools::delFirstCom(data, 4));
-			if (!Tools::isNum(assignmentId_str))//未检测到数字
+			if (!listPage.count(qq_id))
 			{
-				std::string message;
-				try
-				{
-					std::vector<DataManager::CompleteHomeworkList> homeworklist = DataManager::getHomeworkListByStuId((long)getStuInfo[qq_id].studentId, (long)getStuInfo[qq_id].classId);
-					if (homeworklist.size() != 0)
-					{
-						for (auto& iter : homeworklist)
-						{
-							int status = iter.homework.getStatus();
-							message += (u8"【作业" + std::to_string(iter.assignment.getId()) + u8"】 " + iter.assignment.getTitle() + u8"  " + getHomeworkStatus(status) + u8"  ");
-							if (status == 0)//未提交
-							{
-								if (std::time(0) > iter.assignment.getDeadline())
-								{
-									message += (u8"已截止提交");
-								}
-								else
-								{
-									message += (u8"截止时间：" + TimeConvert(iter.assignment.getDeadline()));
-								}
-							}
-							if (status == 2)//已批改
-							{
-								message += u8"分数：" + std::to_string(iter.homework.getScore());
-							}
-							message += "\r\n";
-						}
-					}
-					else
-						message = u8"暂无作业";
-				}
-				catch (...)
-				{
-					message = u8"暂无作业";
-				}
-				PrivateMessageSender sender(qq_id, u8"作业列表如下\r\n" + message);
-				sender.send();
-				return;
-			}
-			//进入详情查询
-			int assignmentId = atoi(assignmentId_str.c_str());
-			std::string message;
-			try
-			{
-				
-				DataManager::CompleteHomeworkList ch = getCH(qq_id, assignmentId);
-				
-				int homeworkStatus = ch.homework.getStatus();
-				if (homeworkStatus == 0)//未提交
-				{
-					message += (u8"【作业 " + std::to_string(ch.assignment.getId()) + u8"】  " + getHomeworkStatus(homeworkStatus))+ u8"\r\n";
-					message += (u8"【作业标题】 " + ch.assignment.getTitle() + "\r\n");
-					message += (u8"【作业内容】\r\n" + ch.assignment.getDescription() + u8"\r\n");
-					message += (u8"【截止时间】  " + TimeConvert(ch.assignment.getDeadline()) + u8"\r\n");
-					PrivateMessageSender sender(qq_id, message);
-					sender.send();
-					return;
-				}
-				if (homeworkStatus == 1)//已提交
-				{
-					message += (u8"【作业 " + std::to_string(ch.assignment.getId()) + u8"】  " + getHomeworkStatus(homeworkStatus)) + u8"\n\n";
-					message += (u8"【作业标题】 " + ch.assignment.getTitle() + "\r\n");
-					message += (u8"【作业内容】\r\n" + ch.assignment.getDescription() + u8"\r\n");
-					message += (u8"【截止时间】  " + TimeConvert(ch.assignment.getDeadline()) + u8"\n\n");
-					message += (u8"【作业正文列表】\r\n" + getHomeworkFilename(ch.homework.getContentURL())+u8"\r\n");
-					message += (u8"【作业附件列表】\r\n" + getHomeworkFilename(ch.homework.getAttachmentURL()) + u8"\r\n");
-					PrivateMessageSender sender(qq_id, message);
-					sender.send();
-					return;
-				}
-				if (homeworkStatus == 2)//已批改
-				{
-					message += (u8"【作业 " + std::to_string(ch.assignment.getId()) + u8"】  " + getHomeworkStatus(homeworkStatus)) + u8"\n\n";
-					message += (u8"【作业标题】 " + ch.assignment.getTitle() + "\r\n");
-					message += (u8"【作业内容】\r\n" + ch.assignment.getDescription() + u8"\r\n");
-					message += (u8"【截止时间】  " + TimeConvert(ch.assignment.getDeadline()) + u8"\n\n");
-					message += (u8"【分数】 " + std::to_string(ch.homework.getScore()) + u8"\r\n");
-					message += (u8"【评语】\r\n" + ch.homework.getComments() + u8"\n\n");
-					message += (u8"【作业正文列表】\r\n" + getHomeworkFilename(ch.homework.getContentURL()) + u8"\r\n");
-					message += (u8"【作业附件列表】\r\n" + getHomeworkFilename(ch.homework.getAttachmentURL()) + u8"\r\n");
-					PrivateMessageSender sender(qq_id, message);
-					sender.send();
-					return;
-				}
-			}
-			catch(DataManager::DMException::TARGET_NOT_FOUND)//无作业
-			{
-				PrivateMessageSender sender(qq_id, u8"暂无该作业，请重试");
-				sender.send();
-				return;
-			}
-			catch (std::exception)
-			{
-				PrivateMessageSender sender(qq_id, u8"未知错误，请重试");
+				PrivateMessageSender sender(qq_id, u8"没有下一页，输入“查询作业”查看作业列表");
 				sender.send();
 				return;
 			}
+			sendHomeworkList(qq_id, listPage[qq_id]);
 			return;
 		}
-		if (data.substr(0, 11) == u"gethomework" || data.substr(0, 11) == u"Gethomework")
-		{
-			std::string assignmentId_str = Tools::to_utf8(Tools::delFirstCom(data, 11));
-			if (!Tools::isNum(assignmentId_str))//未检测到数字
-			{
-				std::string message;
-				try
-				{
-					std::vector<DataManager::CompleteHomeworkList> homeworklist = DataManager::getHomeworkListByStuId((long)getStuInfo[qq_id].studentId, (long)getStuInfo[qq_id].classId);
-					if (homeworklist.size() != 0)
-					{
-						for (auto& iter : homeworklist)
-						{
-							int status = iter.homework.getStatus();
-							message += (u8"【作业" + std::to_string(iter.assignment.getId()) + u8"】 " + iter.assignment.getTitle() + u8"  " + getHomeworkStatus(status) + u8"  ");
-							if (status == 0)//未提交
-							{
-								if (std::time(0) > iter.assignment.getDeadline())
-								{
-									message += (u8"已截止提交");
-								}
-								else
-								{
-									message += (u8"截止时间：" + TimeConvert(iter.assignment.getDeadline()));
-								}
-							}
-							if (status == 2)//已批改
-							{
-								message += u8"分数：" + std::to_string(iter.homework.getScore());
-							}
-							message += "\r\n";
-						}
-					}
-					else
-						message = u8"暂无作业";
-				}
-				catch (...)
-				{
-					message = u8"暂无作业";
-				}
-				PrivateMessageSender sender(qq_id, u8"作业列表如下\r\n" + message);
-				sender.send();
-				return;
-			}
-			//进入详情查询
-			int assignmentId = atoi(assignmentId_str.c_str());
-			std::string message;
-			try
-			{
 
-				DataManager::CompleteHomeworkList ch = getCH(qq_id, assignmentId);
-
-				int homeworkStatus = ch.homework.getStatus();
-				if (homeworkStatus == 0)//未提交
-				{
-					message += (u8"【作业 " + std::to_string(ch.assignment.getId()) + u8"】  " + getHomeworkStatus(homeworkStatus)) + u8"\r\n";
-					message += (u8"【作业标题】 " + ch.assignment.getTitle() + "\r\n");
-					message += (u8"【作业内容】\r\n" + ch.assignment.getDescription() + u8"\r\n");
-					message += (u8"【截止时间】  " + TimeConvert(ch.assignment.getDeadline()) + u8"\r\n");
-					PrivateMessageSender sender(qq_id, message);
-					sender.send();
-					return;
-				}
-				if (homeworkStatus == 1)//已提交
-				{
-					message += (u8"【作业 " + std::to_string(ch.assignment.getId()) + u8"】  " + getHomeworkStatus(homeworkStatus)) + u8"\n\n";
-					message += (u8"【作业标题】 " + ch.assignment.getTitle() + "\r\n");
-					message += (u8"【作业内容】\r\n" + ch.assignment.getDescription() + u8"\r\n");
-					message += (u8"【截止时间】  " + TimeConvert(ch.assignment.getDeadline()) + u8"\n\n");
-					message += (u8"【作业正文列表】\r\n" + getHomeworkFilename(ch.homework.getContentURL()) + u8"\r\n");
-					message += (u8"【作业附件列表】\r\n" + getHomeworkFilename(ch.homework.getAttachmentURL()) + u8"\r\n");
-					PrivateMessageSender sender(qq_id, message);
-					sender.send();
-					return;
-				}
-				if (homeworkStatus == 2)//已批改
-				{
-					message += (u8"【作业 " + std::to_string(ch.assignment.getId()) + u8"】  " + getHomeworkStatus(homeworkStatus)) + u8"\n\n";
-					message += (u8"【作业标题】 " + ch.assignment.getTitle() + "\r\n");
-					message += (u8"【作业内容】\r\n" + ch.assignment.getDescription() + u8"\r\n");
-					message += (u8"【截止时间】  " + TimeConvert(ch.assignment.getDeadline()) + u8"\n\n");
-					message += (u8"【分数】 " + std::to_string(ch.homework.getScore()) + u8"\r\n");
-					message += (u8"【评语】\r\n" + ch.homework.getComments() + u8"\n\n");
-					message += (u8"【作业正文列表】\r\n" + getHomeworkFilename(ch.homework.getContentURL()) + u8"\r\n");
-					message += (u8"【作业附件列表】\r\n" + getHomeworkFilename(ch.homework.getAttachmentURL()) + u8"\r\n");
-					PrivateMessageSender sender(qq_id, message);
-					sender.send();
-					return;
-				}
-			}
-			catch (DataManager::DMException::TARGET_NOT_FOUND)//无作业
-			{
-				PrivateMessageSender sender(qq_id, u8"暂无该作业，请重试");
-				sender.send();
-				return;
-			}
-			catch (std::exception)
-			{
-				PrivateMessageSender sender(qq_id, u8"未知错误，请重试");
-				sender.send();
-				return;
-			}
-			return;
-		}
-		if (data.substr(0, 3) == u"get" || data.substr(0, 3) == u"Get")
+		//查询作业（列表或详情）
+		if (size_t len = Tools::matchPrefix(data, { u8"查询作业", u8"获取作业", u8"gethomework", u8"Gethomework", u8"get", u8"Get" }))
 		{
-			std::string assignmentId_str = Tools::to_utf8(Tools::delFirstCom(data, 3));
-			if (!Tools::isNum(assignmentId_str))//未检测到数字
+			long long assignmentId;
+			if (!StringTools::parseInt(StringTools::stripPrefix(data, len), assignmentId))//未检测到数字
 			{
-				std::string message;
-				try
-				{
-					std::vector<DataManager::CompleteHomeworkList> homeworklist = DataManager::getHomeworkListByStuId((long)getStuInfo[qq_id].studentId, (long)getStuInfo[qq_id].classId);
-					if (homeworklist.size() != 0)
-					{
-						for (auto& iter : homeworklist)
-						{
-							int status = iter.homework.getStatus();
-							message += (u8"【作业" + std::to_string(iter.assignment.getId()) + u8"】 " + iter.assignment.getTitle() + u8"  " + getHomeworkStatus(status) + u8"  ");
-							if (status == 0)//未提交
-							{
-								if (std::time(0) > iter.assignment.getDeadline())
-								{
-									message += (u8"已截止提交");
-								}
-								else
-								{
-									message += (u8"截止时间：" + TimeConvert(iter.assignment.getDeadline()));
-								}
-							}
-							if (status == 2)//已批改
-							{
-								message += u8"分数：" + std::to_string(iter.homework.getScore());
-							}
-							message += "\r\n";
-						}
-					}
-					else
-						message = u8"暂无作业";
-				}
-				catch (...)
-				{
-					message = u8"暂无作业";
-				}
-				PrivateMessageSender sender(qq_id, u8"作业列表如下\r\n" + message);
-				sender.send();
+				sendHomeworkList(qq_id);
 				return;
 			}
 			//进入详情查询
-			int assignmentId = atoi(assignmentId_str.c_str());
-			std::string message;
-			try
-			{
-
-				DataManager::CompleteHomeworkList ch = getCH(qq_id, assignmentId);
-
-				int homeworkStatus = ch.homework.getStatus();
-				if (homeworkStatus == 0)//未提交
-				{
-					message += (u8"【作业 " + std::to_string(ch.assignment.getId()) + u8"】  " + getHomeworkStatus(homeworkStatus)) + u8"\r\n";
-					message += (u8"【作业标题】 " + ch.assignment.getTitle() + "\r\n");
-					message += (u8"【作业内容】\r\n" + ch.assignment.getDescription() + u8"\r\n");
-					message += (u8"【截止时间】  " + TimeConvert(ch.assignment.getDeadline()) + u8"\r\n");
-					PrivateMessageSender sender(qq_id, message);
-					sender.send();
-					return;
-				}
-				if (homeworkStatus == 1)//已提交
-				{
-					message += (u8"【作业 " + std::to_string(ch.assignment.getId()) + u8"】  " + getHomeworkStatus(homeworkStatus)) + u8"\n\n";
-					message += (u8"【作业标题】 " + ch.assignment.getTitle() + "\r\n");
-					message += (u8"【作业内容】\r\n" + ch.assignment.getDescription() + u8"\r\n");
-					message += (u8"【截止时间】  " + TimeConvert(ch.assignment.getDeadline()) + u8"\n\n");
-					message += (u8"【作业正文列表】\r\n" + getHomeworkFilename(ch.homework.getContentURL()) + u8"\r\n");
-					message += (u8"【作业附件列表】\r\n" + getHomeworkFilename(ch.homework.getAttachmentURL()) + u8"\r\n");
-					PrivateMessageSender sender(qq_id, message);
-					sender.send();
-					return;
-				}
-				if (homeworkStatus == 2)//已批改
-				{
-					message += (u8"【作业 " + std::to_string(ch.assignment.getId()) + u8"】  " + getHomeworkStatus(homeworkStatus)) + u8"\n\n";
-					message += (u8"【作业标题】 " + ch.assignment.getTitle() + "\r\n");
-					message += (u8"【作业内容】\r\n" + ch.assignment.getDescription() + u8"\r\n");
-					message += (u8"【截止时间】  " + TimeConvert(ch.assignment.getDeadline()) + u8"\n\n");
-					message += (u8"【分数】 " + std::to_string(ch.homework.getScore()) + u8"\r\n");
-					message += (u8"【评语】\r\n" + ch.homework.getComments() + u8"\n\n");
-					message += (u8"【作业正文列表】\r\n" + getHomeworkFilename(ch.homework.getContentURL()) + u8"\r\n");
-					message += (u8"【作业附件列表】\r\n" + getHomeworkFilename(ch.homework.getAttachmentURL()) + u8"\r\n");
-					PrivateMessageSender sender(qq_id, message);
-					sender.send();
-					return;
-				}
-			}
-			catch (DataManager::DMException::TARGET_NOT_FOUND)//无作业
-			{
-				PrivateMessageSender sender(qq_id, u8"暂无该作业，请重试");
-				sender.send();
-				return;
-			}
-			catch (std::exception)
-			{
-				PrivateMessageSender sender(qq_id, u8"未知错误，请重试");
-				sender.send();
-				return;
-			}
+			sendHomeworkDetail(qq_id, assignmentId);
 			return;
 		}
 
 		//提交&修改作业
-		if (data.substr(0, 4) == u"提交作业"|| data.substr(0, 4) == u"修改作业")
-		{
-			std::string assignmentId_str = Tools::to_utf8(Tools::delFirstCom(data, 4));
-			if (!Tools::isNum(assignmentId_str)|| assignmentId_str=="")
-			{
-				PrivateMessageSender sender(qq_id, u8"未知命令，请重试");
-				sender.send();
-				return;
-			}
-			int assignmentId = atoi(assignmentId_str.c_str());
-			try
-			{
-
-				DataManager::CompleteHomeworkList ch = getCH(qq_id, assignmentId);
-
-				status[qq_id] = PeerStatus::HOMEWORK;
-				DataManager::Student st((long)getStuInfo[qq_id].studentId);
-				if (std::time(0) > ch.assignment.getDeadline())
-				{
-					PrivateMessageSender sender(qq_id, u8"作业提交已截止");
-					sender.send();
-					status[qq_id] = PeerStatus::IDLE;
-					return;
-				}
-				PrivateMessageSender sender(qq_id, u8"已新建作业");
-				sender.send();
-
-				HomeworkInfo info;
-				info.classId = st.getClassId();
-				info.homeworkId = assignmentId;
-				info.studentId = getStuInfo[qq_id].studentId;
-				info.studentNum = atoll(st.getSchoolNum().c_str());
-				if (getHomeworkInfo.count(qq_id))
-					getHomeworkInfo.erase(qq_id);
-				getHomeworkInfo.insert(std::pair<long long, HomeworkInfo>(qq_id, info));
-				PrivateMessageSender sender2(qq_id, u8"开始提交作业" + std::to_string(info.homeworkId) + u8"\r\n结束后，输入“确认提交”以提交，输入“取消提交”以取消");
-				sender2.send();
-
-				File file(info);
-				std::string filelist = file.getFileList();
-				if (filelist != u8"暂无文件")
-				{
-					PrivateMessageSender sender(qq_id, u8"已检测到草稿\n" + filelist);
-					sender.send();
-				}
-
-				return;
-			}
-			catch (DataManager::DMException::TARGET_NOT_FOUND)
-			{
-				status[qq_id] = PeerStatus::IDLE;
-				PrivateMessageSender sender(qq_id, u8"暂无该作业，请重试");
-				sender.send();
-				return;
-			}
-		}
-		if (data.substr(0, 6) == u"Submit" || data.substr(0, 6) == u"submit" || data.substr(0, 6) == u"Modify" || data.substr(0, 6) == u"modify")
+		if (size_t len = Tools::matchPrefix(data, { u8"提交作业", u8"修改作业", u8"Submit", u8"submit", u8"Modify", u8"modify" }))
 		{
-			std::string assignmentId_str = Tools::to_utf8(Tools::delFirstCom(data, 6));
-			if (!Tools::isNum(assignmentId_str) || assignmentId_str == "")
+			long long assignmentId;
+			if (!StringTools::parseInt(StringTools::stripPrefix(data, len), assignmentId))
 			{
 				PrivateMessageSender sender(qq_id, u8"未知命令，请重试");
 				sender.send();
 				return;
 			}
-			int assignmentId = atoi(assignmentId_str.c_str());
 			try
 			{
 
@@ -739,7 +605,7 @@ void AnaText(std::u16string data, long long qq_id)
 	return;
 }
 
-void RegCommand(std::u16string data, long long qq_id)
+void RegCommand(std::string_view data, long long qq_id)
 {
 	typedef std::pair<long long, RegInfo> pair;
 	RegInfo regInfo;
@@ -750,7 +616,7 @@ void RegCommand(std::u16string data, long long qq_id)
 
 	regInfo = regStatus[qq_id];
 
-	if (data == u"取消注册" || data == u"取消" || data == u"Cancel" || data == u"cancel")
+	if (Tools::equalsAny(data, { u8"取消注册", u8"取消", u8"Cancel", u8"cancel" }))
 	{
 		PrivateMessageSender sender(qq_id, u8"已取消注册");
 		sender.send();
@@ -758,7 +624,7 @@ void RegCommand(std::u16string data, long long qq_id)
 		status[qq_id] = PeerStatus::IDLE;
 		return;
 	}
-	if (data == u"帮助" || data == u"Help" || data == u"help")
+	if (Tools::equalsAny(data, { u8"帮助", u8"Help", u8"help" }))
 	{
 		PrivateMessageSender sender(qq_id, regHelper);
 		sender.send();
@@ -775,10 +641,10 @@ void RegCommand(std::u16string data, long long qq_id)
 
 	if (regInfo.status == RegStatus::CLASS)
 	{
-		std::u16string classCode = data.substr(0, data.find_first_of(u" "));
+		std::string_view classCode = data.substr(0, data.find(' '));
 		try
 		{
-			DataManager::Class cl(Tools::to_utf8(classCode)); 
+			DataManager::Class cl{ std::string(classCode) };
 			//DataManager::Class cl(1);
 			std::string classInfo = u8"您即将加入："+cl.getName()+u8"\n\n请输入姓名";
 			PrivateMessageSender sender(qq_id, classInfo);
@@ -788,20 +654,21 @@ void RegCommand(std::u16string data, long long qq_id)
 			regStatus[qq_id] = regInfo;
 			return;
 		}
-		
+
 		catch(DataManager::DMError)
 		{
 			PrivateMessageSender sender(qq_id, u8"未知课程邀请码，请重试");
 			sender.send();
 			return;
 		}
-		
+
 	}
 
 	if (regInfo.status == RegStatus::NAME)
 	{
-		std::u16string name = data.substr(0, data.find_first_of(u" "));
-		if (name.length() < 1 || name.length() > 20)
+		std::string_view name = data.substr(0, data.find(' '));
+		size_t nameLength = Tools::utf8Length(name);
+		if (!Tools::isValidUtf8(name) || nameLength < 1 || nameLength > 20)
 		{
 			PrivateMessageSender sender(qq_id, u8"非法姓名，请重新输入");
 			sender.send();
@@ -810,24 +677,23 @@ void RegCommand(std::u16string data, long long qq_id)
 		PrivateMessageSender sender(qq_id, u8"请输入学号");
 		sender.send();
 		regInfo.status = RegStatus::NUM;
-		regInfo.name = Tools::to_utf8(name);
+		regInfo.name = std::string(name);
 		regStatus[qq_id] = regInfo;
 		return;
 	}
 
 	if (regInfo.status == RegStatus::NUM)
 	{
-		std::string schoolID_str = Tools::to_utf8(data.substr(0, data.find_first_of(u" ")));
+		std::string_view schoolID_str = data.substr(0, data.find(' '));
+		long long schoolID;
 
-		if (!Tools::isNum(schoolID_str)||schoolID_str.length()>18)
+		if (!StringTools::parseInt(schoolID_str, schoolID)||schoolID_str.length()>18)
 		{
 			PrivateMessageSender sender(qq_id, u8"学号格式错误，请重新输入");
 			sender.send();
 			return;
 		}
 
-		long long schoolID = atoll(schoolID_str.c_str());
-
 		regInfo.status = RegStatus::CONFIRM;
 		regInfo.schoolId = schoolID;
 		regStatus[qq_id] = regInfo;
@@ -840,8 +706,8 @@ void RegCommand(std::u16string data, long long qq_id)
 
 	if (regInfo.status == RegStatus::CONFIRM)
 	{
-		std::u16string command = data.substr(0, data.find_first_of(u" "));
-		if (command != u"确认")
+		std::string_view command = data.substr(0, data.find(' '));
+		if (command != u8"确认")
 		{
 			PrivateMessageSender sender(qq_id, u8"已取消注册");
 			sender.send();
@@ -849,7 +715,7 @@ void RegCommand(std::u16string data, long long qq_id)
 			status[qq_id] = PeerStatus::IDLE;
 			return;
 		}
-		
+
 		try
 		{
 			DataManager::Student st(std::to_string(regInfo.schoolId), std::to_string(qq_id), regInfo.name);
@@ -871,9 +737,9 @@ void RegCommand(std::u16string data, long long qq_id)
 	}
 }
 
-void HomCommand(std::u16string data, long long qq_id)
+void HomCommand(std::string_view data, long long qq_id)
 {
-	if (data == u"取消"|| data == u"取消提交"|| data == u"Cancel"||data == u"cancel")
+	if (Tools::equalsAny(data, HomAlias::cancel))
 	{
 		PrivateMessageSender sender(qq_id, u8"您已取消提交作业" + std::to_string(getHomeworkInfo[qq_id].homeworkId)+u8"\n当前草稿已保存");
 		sender.send();
@@ -881,13 +747,16 @@ void HomCommand(std::u16string data, long long qq_id)
 		getHomeworkInfo.erase(qq_id);
 		return;
 	}
-	if (data == u"帮助" || data == u"Help" || data == u"help")
+	if (Tools::equalsAny(data, HomAlias::help))
 	{
-		PrivateMessageSender sender(qq_id, homHelper1+std::to_string(getHomeworkInfo[qq_id].homeworkId)+homHelper2);
+		JsonFragment message = homHelper1;
+		message.append(std::to_string(getHomeworkInfo[qq_id].homeworkId));
+		message.append(homHelper2);
+		PrivateMessageSender sender(qq_id, std::move(message));
 		sender.send();
 		return;
 	}
-	if (data == u"全部删除" || data == u"清空文件" || data == u"Deleteall" || data == u"deleteall")
+	if (Tools::equalsAny(data, HomAlias::deleteAll))
 	{
 		File file(getHomeworkInfo.at(qq_id));
 		file.delAll();
@@ -895,75 +764,33 @@ void HomCommand(std::u16string data, long long qq_id)
 		sender.send();
 		return;
 	}
-	if (data.substr(0, 4) == u"删除文件")
-	{
-		std::u16string tmp = Tools::delFirstCom(data, 2);
-		std::vector<std::u16string> delList = split(tmp, u"|");
-		for (auto& iter : delList)
-		{
-			File file(getHomeworkInfo.at(qq_id));
-			PrivateMessageSender sender(qq_id, file.delFile(iter));
-			sender.send();
-		}
-		return;
-	}
-	if (data.substr(0, 2) == u"删除")
-	{
-		std::u16string tmp = Tools::delFirstCom(data, 2);
-		std::vector<std::u16string> delList = split(tmp, u"|");
-		for (auto& iter : delList)
-		{
-			File file(getHomeworkInfo.at(qq_id));
-			PrivateMessageSender sender(qq_id, file.delFile(iter));
-			sender.send();
-		}
-		return;
-	}
-	if (data.substr(0, 6) == u"Delete" || data.substr(0, 6) == u"delete")
+	if (size_t len = Tools::matchPrefix(data, HomAlias::deleteFile))
 	{
-		std::u16string tmp = Tools::delFirstCom(data, 6);
-		std::vector<std::u16string> delList = split(tmp, u"|");
-		for (auto& iter : delList)
+		for (std::string_view iter : StringTools::split(StringTools::stripPrefix(data, len), "|"))
 		{
 			File file(getHomeworkInfo.at(qq_id));
-			PrivateMessageSender sender(qq_id, file.delFile(iter));
+			PrivateMessageSender sender(qq_id, file.delFile(std::filesystem::u8path(iter.begin(), iter.end())));
 			sender.send();
 		}
 		return;
 	}
-	if (data == u"获取文件列表"|| data == u"查询文件列表" || data == u"Getlist" || data == u"getlist")
+	if (Tools::equalsAny(data, HomAlias::getList))
 	{
 		File file(getHomeworkInfo[qq_id]);
 		PrivateMessageSender sender(qq_id, file.getFileList());
 		sender.send();
 		return;
 	}
-	if (data.substr(0, 3) == u"Get" || data.substr(0, 3) == u"get")
-	{
-		std::u16string tmp = Tools::delFirstCom(data, 3);
-		File file(getHomeworkInfo[qq_id]);
-		PrivateMessageSender sender(qq_id, file.getFile(tmp));
-		sender.send();
-		return;
-	}
-	if (data.substr(0, 2) == u"获取" || data.substr(0, 2) == u"查询")
-	{
-		std::u16string tmp = Tools::delFirstCom(data, 2);
-		File file(getHomeworkInfo[qq_id]);
-		PrivateMessageSender sender(qq_id, file.getFile(tmp));
-		sender.send();
-		return;
-	}
-	if (data.substr(0, 4) == u"获取文件" || data.substr(0, 4) == u"查询文件")
+	if (size_t len = Tools::matchPrefix(data, HomAlias::getFile))
 	{
-		std::u16string tmp = Tools::delFirstCom(data, 4);
+		std::string_view tmp = StringTools::stripPrefix(data, len);
 		File file(getHomeworkInfo[qq_id]);
-		PrivateMessageSender sender(qq_id, file.getFile(tmp));
+		PrivateMessageSender sender(qq_id, file.getFile(std::filesystem::u8path(tmp.begin(), tmp.end())));
 		sender.send();
 		return;
 	}
-	
-	if (data == u"提交作业" || data == u"确认提交" || data == u"提交" || data == u"Submit" || data == u"submit")
+
+	if (Tools::equalsAny(data, HomAlias::submit))
 	{
 		File file(getHomeworkInfo[qq_id]);
 		try
@@ -1011,31 +838,33 @@ void HomCommand(std::u16string data, long long qq_id)
 			sender.send();
 			return;
 		}
-		
+
 	}
 
 	try
 	{
-		std::regex findURL("url=(.*?)\\]");
-		std::regex findCQ("\\[(.*?)\\]");
-		std::sregex_token_iterator endURL;
-		std::sregex_token_iterator endCQ;
-		std::string msg = Tools::to_utf8(data);
-		std::string tmp = msg;
-		for (std::sregex_token_iterator posURL(tmp.cbegin(), tmp.cend(), findURL, 1), posCQ(tmp.cbegin(), tmp.cend(), findCQ, 1); posURL != endURL; ++posURL, ++posCQ)
+		std::string msg(data);
+		//图片文件名先行替换，文本立即保存，图片全部下载结束后合并回复一次
+		auto pictures = reservePictures(msg, qq_id);
+		File file(getHomeworkInfo[qq_id]);
+		std::string textName = file.storeText(msg);
+		storePictures(qq_id, pictures, [qq_id, textName](const std::vector<std::string>& fileNames, const std::vector<bool>& saved)
+			{
+				std::string reply, failed;
+				for (size_t i = 0; i < fileNames.size(); i++)
+				{
+					(saved[i] ? reply : failed) += fileNames[i] + " ";
+				}
+				if (!reply.empty()) reply = u8"图片：" + reply + u8"已保存\n";
+				if (!failed.empty()) reply += u8"图片：" + failed + u8"保存失败，请重新发送\n";
+				PrivateMessageSender sender(qq_id, reply + u8"文本：" + textName + u8" 已保存");
+				sender.send();
+			});
+		if (pictures.empty())
 		{
-			File fl(getHomeworkInfo[qq_id]);
-			std::string fileName = fl.storePic(posURL->str());
-			msg.replace(msg.find(posCQ->str()), posCQ->str().length(), fileName);
-			//msg.replace(msg.find(posCQ->str()), posCQ->str().length(), fileName);
-			PrivateMessageSender sender(qq_id, u8"图片：" + fileName + u8" 已保存");
+			PrivateMessageSender sender(qq_id, u8"文本：" + textName + u8" 已保存");
 			sender.send();
 		}
-
-		File file(getHomeworkInfo[qq_id]);
-		std::string fileName = file.storeText(msg);
-		PrivateMessageSender sender(qq_id, u8"文本：" + fileName + u8" 已保存");
-		sender.send();
 		return;
 	}
 	catch (...)
@@ -1046,24 +875,88 @@ void HomCommand(std::u16string data, long long qq_id)
 	}
 }
 
-void AnaFile(std::string name, std::string url, long long qq_id)
+void AnaThrottled(std::string_view data, long long qq_id)
 {
-	if (status[qq_id] == PeerStatus::HOMEWORK)
+	FloodInfo& flood = floodStatus[qq_id];
+	std::string_view subCom = StringTools::trimLeft(data);
+	//提交模式下的文本合并保存
+	if (status.count(qq_id) && status[qq_id] == PeerStatus::HOMEWORK && !isHomCommand(subCom))
 	{
-		File fl(getHomeworkInfo[qq_id]);
-		std::string filename = fl.downFile(url, name);
-		if (filename != "")
+		try
 		{
-			PrivateMessageSender sender(qq_id, u8"文件：" + filename + u8" 已接收");
-			sender.send();
-			return;
+			std::string msg(subCom);
+			//下载失败的图片每轮超限合并提示一次，不因失败消息绕过限流
+			storePictures(qq_id, reservePictures(msg, qq_id), [qq_id, notified = flood.pictureFailNotified](const std::vector<std::string>& fileNames, const std::vector<bool>& saved)
+				{
+					std::string failed;
+					for (size_t i = 0; i < fileNames.size(); i++)
+					{
+						if (!saved[i]) failed += fileNames[i] + " ";
+					}
+					if (failed.empty() || notified->exchange(true)) return;
+					PrivateMessageSender sender(qq_id, u8"图片：" + failed + u8"保存失败，请重新发送");
+					sender.send();
+				});
+			File file(getHomeworkInfo[qq_id]);
+			if (flood.mergeFile.empty())
+			{
+				flood.mergeFile = file.storeText(msg);
+				PrivateMessageSender sender(qq_id, u8"文本：" + flood.mergeFile + u8" 已保存\n发送过快，后续文本将合并保存至该文件");
+				sender.send();
+			}
+			else
+			{
+				file.appendText(flood.mergeFile, msg);
+			}
 		}
-		else
+		catch (...)
 		{
-			PrivateMessageSender sender(qq_id, u8"文件接收失败，请重试");
+			if (!flood.notified)
+			{
+				flood.notified = true;
+				PrivateMessageSender sender(qq_id, u8"保存失败，请稍后重试");
+				sender.send();
+			}
+		}
+		return;
+	}
+	//其余命令只提示一次
+	if (!flood.notified)
+	{
+		flood.notified = true;
+		PrivateMessageSender sender(qq_id, u8"操作过于频繁，请稍后再试");
+		sender.send();
+	}
+}
+
+void AnaFile(std::string name, std::string url, long long size, long long qq_id)
+{
+	if (status[qq_id] == PeerStatus::HOMEWORK)
+	{
+		File fl(getHomeworkInfo[qq_id]);
+		//超出配额的文件不下载
+		unsigned long long remaining = fl.getQuotaRemaining();
+		if (remaining == 0 || (size > 0 && (unsigned long long)size > remaining))
+		{
+			PrivateMessageSender sender(qq_id, u8"文件：" + name + u8" 超出存储空间限制，未接收");
 			sender.send();
 			return;
 		}
+		//下载完成后再回复，不占用消息处理线程
+		fl.downFileAsync(url, name, [qq_id](std::string filename)
+			{
+				if (filename != "")
+				{
+					PrivateMessageSender sender(qq_id, u8"文件：" + filename + u8" 已接收");
+					sender.send();
+				}
+				else
+				{
+					PrivateMessageSender sender(qq_id, u8"文件接收失败，请重试");
+					sender.send();
+				}
+			}, size > 0 ? (unsigned long long)size : 0);
+		return;
 	}
 	else
 	{
@@ -1073,7 +966,7 @@ void AnaFile(std::string name, std::string url, long long qq_id)
 	}
 }
 
-bool sendReview(long homeworkId)
+bool sendReview(long homeworkId, ApiCallback callback)
 {
 	std::string msg = u8"未知消息";
 	try
@@ -1084,8 +977,9 @@ bool sendReview(long homeworkId)
 
 		long long qq_id = atoll(st.getQQ().c_str());
 		std::string msg = u8"您提交的作业" + std::to_string(as.getId()) + u8"【" + as.getTitle() + u8"】" + u8"已批改\n\n【分数】 " + std::to_string(hm.getScore()) + u8"\n【评语】\n" + hm.getComments();
-		PrivateMessageSender sender(qq_id, msg);
-		sender.send();
+		PrivateMessageSender sender(qq_id, msg, SendPriority::BULK);
+		sender.setClassId(st.getClassId());
+		sender.send(callback);
 		return true;
 	}
 	catch (...)
@@ -1094,20 +988,42 @@ bool sendReview(long homeworkId)
 	}
 }
 
-void sendHomeworkNotification(long long assignmentId,int mode)
+std::string sendHomeworkNotification(long long assignmentId, int mode)
 {
+	if (mode != 1) return "";
 	auto assignment = DataManager::Assignment((unsigned long)assignmentId);
 	auto studentList = DataManager::getStudentList(assignment.getClassId());
+	//所有人收到的内容相同，只生成一次
+	std::string message = u8"您收到了新的作业\r\n";
+	message += (u8"【作业 " + std::to_string(assignmentId) + u8"】 " + assignment.getTitle() + u8"\r\n");
+	message += (u8"【作业内容】\r\n" + assignment.getDescription() + u8"\r\n");
+	message += (u8"【截止时间】  " + TimeConvert(assignment.getDeadline()) + u8"\r\n");
+	std::vector<long long> recipients;
+	recipients.reserve(studentList.size());
 	for (auto& iter : studentList)
 	{
-		if (mode == 1)
-		{
-			std::string message = u8"您收到了新的作业\r\n";
-			message += (u8"【作业 " + std::to_string(assignmentId) + u8"】 " + assignment.getTitle() + u8"\r\n");
-			message += (u8"【作业内容】\r\n" + assignment.getDescription() + u8"\r\n");
-			message += (u8"【截止时间】  " + TimeConvert(assignment.getDeadline()) + u8"\r\n");
-			PrivateMessageSender sender(atoll(iter.getQQ().c_str()), message);
-			sender.send();
-		}
+		recipients.push_back(atoll(iter.getQQ().c_str()));
+	}
+	return notificationJobs.submit(assignmentId, assignment.getClassId(), message, recipients);
+}
+
+std::string sendDeadlineReminder(unsigned long assignmentId, long deadline)
+{
+	DataManager::Assignment assignment(assignmentId);
+	if (assignment.getDeadline() != deadline) return "";//截止时间已修改
+	auto studentList = DataManager::getUnsubmittedStudentList(assignmentId);
+	if (studentList.empty()) return "";
+	long remaining = deadline - (long)time(nullptr);
+	std::string message = u8"作业即将截止\r\n";
+	message += (u8"【作业 " + std::to_string(assignmentId) + u8"】 " + assignment.getTitle() + u8"\r\n");
+	message += (u8"【截止时间】  " + TimeConvert(deadline) + u8"\r\n");
+	message += (u8"【剩余时间】  约" + std::to_string((remaining + 1800) / 3600) + u8"小时\r\n");
+	message += u8"您尚未提交该作业，请尽快提交";
+	std::vector<long long> recipients;
+	recipients.reserve(studentList.size());
+	for (auto& iter : studentList)
+	{
+		recipients.push_back(atoll(iter.getQQ().c_str()));
 	}
-}
\ No newline at end of file
+	return notificationJobs.submit(assignmentId, assignment.getClassId(), message, recipients);
+}
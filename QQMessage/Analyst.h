@@ -1,5 +1,8 @@
 ﻿#pragma once
+#include <atomic>
+#include <memory>
 #include <string>
+#include <string_view>
 #include "WebsocketClient.h"
 
 /// <summary>
@@ -128,6 +131,38 @@ struct HomeworkInfo
 	long long submitId;
 };
 /// <summary>
+/// 超出频率限制的消息记录
+/// </summary>
+struct FloodInfo
+{
+	/// <summary>
+	/// 已发送限流提示
+	/// </summary>
+	bool notified = false;
+	/// <summary>
+	/// 超限文本合并保存的文件名
+	/// </summary>
+	std::string mergeFile;
+	/// <summary>
+	/// 已提示图片保存失败，由本轮超限的下载回调共享，超限结束后仍有效
+	/// </summary>
+	std::shared_ptr<std::atomic<bool>> pictureFailNotified = std::make_shared<std::atomic<bool>>(false);
+};
+/// <summary>
+/// 作业列表的翻页位置
+/// </summary>
+struct ListPage
+{
+	/// <summary>
+	/// 已发送的最后一项作业ID，下一页从更早的作业开始
+	/// </summary>
+	unsigned long lastId = 0;
+	/// <summary>
+	/// 下一页的页码
+	/// </summary>
+	unsigned long page = 1;
+};
+/// <summary>
 /// 私聊消息发送
 /// </summary>
 class PrivateMessageSender;
@@ -135,38 +170,62 @@ class PrivateMessageSender;
 /// <summary>
 /// 检测输入文本【一级菜单】
 /// </summary>
-/// <param name="data">聊天消息</param>
+/// <param name="data">utf8聊天消息</param>
+/// <param name="qq_id">对象qq</param>
+void AnaText(std::string_view data, long long qq_id);
+
+/// <summary>
+/// 处理超出频率限制的消息
+/// <para>提交模式下的文本合并保存为一个文件，其余命令只回复一次限流提示</para>
+/// </summary>
+/// <param name="data">utf8聊天消息</param>
 /// <param name="qq_id">对象qq</param>
-void AnaText(std::u16string data, long long qq_id);
+void AnaThrottled(std::string_view data, long long qq_id);
 
 /// <summary>
 /// 注册【二级菜单】
 /// </summary>
 /// <param name="data">聊天消息</param>
 /// <param name="qq_id">对象qq</param>
-void RegCommand(std::u16string data, long long qq_id);
+void RegCommand(std::string_view data, long long qq_id);
 /// <summary>
 /// 作业【二级菜单】
 /// </summary>
 /// <param name="data">聊天消息</param>
 /// <param name="qq_id">对象qq</param>
-void HomCommand(std::u16string data, long long qq_id);
+void HomCommand(std::string_view data, long long qq_id);
 
 /// <summary>
 /// 检测文件
 /// </summary>
 /// <param name="data">聊天消息</param>
+/// <param name="size">离线文件上报的大小，未知时为0</param>
 /// <param name="qq_id">对象qq</param>
-void AnaFile(std::string name,std::string url, long long qq_id);
+void AnaFile(std::string name,std::string url, long long size, long long qq_id);
 /// <summary>
 /// 发送评价
 /// </summary>
 /// <param name="homeworkId">提交ID</param>
-/// <return>通知成功状态</return>
-bool sendReview(long homeworkId);
+/// <param name="callback">收到go-cqhttp回执、超时或发送失败后执行，可为空</param>
+/// <return>是否已加入发送队列</return>
+bool sendReview(long homeworkId, ApiCallback callback = nullptr);
 /// <summary>
 /// 发送作业通知
 /// </summary>
 /// <param name="assignmentId">布置作业ID</param>
 /// <param name="mode">模式，1：新增作业 所有人</param>
-void sendHomeworkNotification(long long assignmentId, int mode);
\ No newline at end of file
+/// <returns>通知任务id，不支持的模式返回空</returns>
+std::string sendHomeworkNotification(long long assignmentId, int mode);
+/// <summary>
+/// 向尚未提交的学生发送截止提醒
+/// </summary>
+/// <param name="assignmentId">布置作业ID</param>
+/// <param name="deadline">安排提醒时的截止时间，与数据库不一致时不发送</param>
+/// <returns>通知任务id，无需发送时返回空</returns>
+std::string sendDeadlineReminder(unsigned long assignmentId, long deadline);
+/// <summary>
+/// 时间戳转为北京时间文本
+/// </summary>
+/// <param name="timeStamp">时间戳（秒）</param>
+/// <returns>yyyy-mm-dd hh:mm:ss</returns>
+std::string TimeConvert(long timeStamp);
\ No newline at end of file
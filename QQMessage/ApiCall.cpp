@@ -0,0 +1,26 @@
+﻿#include "ApiCall.h"
+#include <algorithm>
+
+void LatencyHistogram::record(double ms)
+{
+	int index = 0;
+	for (double bound = 1; index < BUCKETS - 1 && ms >= bound; bound *= 2) index++;
+	buckets[index]++;
+	count++;
+	sumMs += ms;
+	maxMs = std::max(maxMs, ms);
+}
+
+double LatencyHistogram::percentile(double p) const
+{
+	if (count == 0) return 0;
+	unsigned long long target = (unsigned long long)(p * count);
+	if (target >= count) target = count - 1;
+	unsigned long long seen = 0;
+	for (int i = 0; i < BUCKETS - 1; i++)
+	{
+		seen += buckets[i];
+		if (seen > target) return std::min((double)(1ull << i), maxMs);
+	}
+	return maxMs;
+}
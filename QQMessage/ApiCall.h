@@ -0,0 +1,102 @@
+﻿#pragma once
+#include <array>
+#include <functional>
+#include <string>
+
+/// <summary>
+/// go-cqhttp api调用结果状态
+/// </summary>
+enum class ApiStatus
+{
+	/// <summary>
+	/// 回执status为ok或async
+	/// </summary>
+	OK,
+	/// <summary>
+	/// 回执status为failed，或未能发出
+	/// </summary>
+	FAILED,
+	/// <summary>
+	/// 超时未收到回执
+	/// </summary>
+	TIMEOUT,
+	/// <summary>
+	/// 出站队列已满或已停止，未加入队列，可稍后重新加入
+	/// </summary>
+	REJECTED
+};
+
+/// <summary>
+/// api调用结果
+/// </summary>
+struct ApiResult
+{
+	ApiStatus status = ApiStatus::FAILED;
+	/// <summary>
+	/// 回执retcode，未收到回执时为-1
+	/// </summary>
+	int retcode = -1;
+	/// <summary>
+	/// 回执原文
+	/// </summary>
+	std::string response;
+	/// <summary>
+	/// 发出到收到回执的耗时（毫秒）
+	/// </summary>
+	double latencyMs = 0;
+};
+
+/// <summary>
+/// api调用完成后执行，在ws客户端线程中调用
+/// </summary>
+typedef std::function<void(const ApiResult& result)> ApiCallback;
+
+/// <summary>
+/// api调用请求
+/// </summary>
+struct ApiRequest
+{
+	/// <summary>
+	/// 终结点，如send_private_msg
+	/// </summary>
+	std::string action;
+	/// <summary>
+	/// 参数，json对象文本
+	/// </summary>
+	std::string params;
+	/// <summary>
+	/// 完成回调，可为空
+	/// </summary>
+	ApiCallback callback;
+};
+
+/// <summary>
+/// 耗时直方图
+/// <para>第0档为1ms以内，第i档为[2^(i-1), 2^i)ms，最后一档不设上限</para>
+/// </summary>
+struct LatencyHistogram
+{
+	static const int BUCKETS = 16;
+	std::array<unsigned long long, BUCKETS> buckets{};
+	/// <summary>
+	/// 收到回执数
+	/// </summary>
+	unsigned long long count = 0;
+	/// <summary>
+	/// 超时数
+	/// </summary>
+	unsigned long long timeouts = 0;
+	double sumMs = 0;
+	double maxMs = 0;
+	/// <summary>
+	/// 记录一次耗时
+	/// </summary>
+	/// <param name="ms">毫秒</param>
+	void record(double ms);
+	/// <summary>
+	/// 估算分位数
+	/// </summary>
+	/// <param name="p">分位，0~1</param>
+	/// <returns>所在档的上限（毫秒），最后一档返回最大值</returns>
+	double percentile(double p) const;
+};
@@ -0,0 +1,59 @@
+﻿#include "BlobStore.h"
+#include <iostream>
+
+BlobStore::BlobStore(std::filesystem::path root) : root(std::move(root)) {}
+
+std::filesystem::path BlobStore::pathOf(const std::string& hash) const
+{
+	return root / hash.substr(0, 2) / hash;
+}
+
+bool BlobStore::intern(const std::filesystem::path& file, const std::string& hash)
+{
+	//旧版清单中的FNV哈希不入库
+	if (hash.size() != 64) return false;
+	std::filesystem::path blob = pathOf(hash);
+	std::error_code ec;
+	std::lock_guard<std::mutex> lock(mtx);
+	if (!std::filesystem::exists(blob, ec))
+	{
+		std::filesystem::create_directories(blob.parent_path(), ec);
+		std::filesystem::create_hard_link(file, blob, ec);
+		return false;
+	}
+	if (std::filesystem::equivalent(file, blob, ec)) return true;
+	if (std::filesystem::file_size(file, ec) != std::filesystem::file_size(blob, ec)) return false;
+	//先建临时链接再改名覆盖，任何时刻文件都完整存在
+	std::filesystem::path link = file;
+	link += ".link";
+	std::filesystem::create_hard_link(blob, link, ec);
+	if (ec) return false;
+	std::filesystem::rename(link, file, ec);
+	if (ec)
+	{
+		std::filesystem::remove(link, ec);
+		return false;
+	}
+	return true;
+}
+
+void BlobStore::release(const std::string& hash)
+{
+	if (hash.size() != 64) return;
+	std::filesystem::path blob = pathOf(hash);
+	std::error_code ec;
+	std::lock_guard<std::mutex> lock(mtx);
+	if (std::filesystem::hard_link_count(blob, ec) == 1 && !ec) std::filesystem::remove(blob, ec);
+}
+
+void BlobStore::detach(const std::filesystem::path& file)
+{
+	std::error_code ec;
+	std::lock_guard<std::mutex> lock(mtx);
+	if (std::filesystem::hard_link_count(file, ec) <= 1 || ec) return;
+	std::filesystem::path copy = file;
+	copy += ".copy";
+	std::filesystem::copy_file(file, copy, std::filesystem::copy_options::overwrite_existing, ec);
+	if (!ec) std::filesystem::rename(copy, file, ec);
+	if (ec) std::cerr << "Cannot detach " << file.string() << ": " << ec.message() << std::endl;
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+#include <filesystem>
+#include <mutex>
+#include <string>
+
+/// <summary>
+/// 内容寻址存储
+/// <para>内容按SHA-256存放于 根目录/.blobs/哈希前两位/哈希，提交目录中的文件是blob的硬链接，相同内容只占一份磁盘空间</para>
+/// <para>引用计数即硬链接数，只剩存储目录中的一个链接时删除blob；文件系统不支持硬链接时文件保持独立，不影响使用</para>
+/// </summary>
+class BlobStore
+{
+public:
+	/// <param name="root">存储目录</param>
+	explicit BlobStore(std::filesystem::path root);
+	/// <summary>
+	/// 将写入完成的文件加入存储，内容已存在时以硬链接替换该文件
+	/// </summary>
+	/// <param name="file">提交目录中的文件</param>
+	/// <param name="hash">文件的SHA-256</param>
+	/// <returns>内容已存在返回true</returns>
+	bool intern(const std::filesystem::path& file, const std::string& hash);
+	/// <summary>
+	/// 文件删除或内容改变后调用，没有其他引用时删除blob
+	/// </summary>
+	void release(const std::string& hash);
+	/// <summary>
+	/// 修改文件前调用，文件与其他提交共享内容时复制为独立文件
+	/// </summary>
+	void detach(const std::filesystem::path& file);
+	std::filesystem::path pathOf(const std::string& hash) const;
+private:
+	std::filesystem::path root;
+	std::mutex mtx;
+};
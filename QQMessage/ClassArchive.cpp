@@ -0,0 +1,269 @@
+﻿#include "ClassArchive.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+extern std::string rootPath;
+
+namespace
+{
+	const char MAGIC[] = { '\x89', 'H', 'C', 'A' };
+	const char VERSION = 1;
+	constexpr size_t HEADER_SIZE = sizeof(MAGIC) + 1;
+	/// <summary>
+	/// 尾部：目录位置(8) 项数(8) 魔数(4)
+	/// </summary>
+	constexpr size_t FOOTER_SIZE = 8 + 8 + sizeof(MAGIC);
+	/// <summary>
+	/// 复制时每段的字节数，每段之后限速一次
+	/// </summary>
+	constexpr size_t COPY_SIZE = 65536;
+
+	void writeLE(std::string& out, unsigned long long value, int bytes)
+	{
+		for (int i = 0; i < bytes; i++) out.push_back((char)((value >> (8 * i)) & 0xFF));
+	}
+
+	unsigned long long readLE(const char* data, int bytes)
+	{
+		unsigned long long value = 0;
+		for (int i = bytes - 1; i >= 0; i--) value = (value << 8) | (unsigned char)data[i];
+		return value;
+	}
+}
+
+std::filesystem::path ClassArchive::pathOf(long long classId)
+{
+	std::filesystem::path path = rootPath;
+	return path / ".archives" / std::to_string(classId);
+}
+
+std::shared_ptr<const ClassArchive> ClassArchive::open(long long classId)
+{
+	struct Cached
+	{
+		std::filesystem::file_time_type mtime;
+		unsigned long long size = 0;
+		std::shared_ptr<const ClassArchive> archive;
+	};
+	static std::mutex mtx;
+	static std::map<long long, Cached> cache;
+
+	std::filesystem::path path = pathOf(classId);
+	std::error_code ec;
+	std::filesystem::file_time_type mtime = std::filesystem::last_write_time(path, ec);
+	unsigned long long size = ec ? 0 : std::filesystem::file_size(path, ec);
+	std::lock_guard<std::mutex> lock(mtx);
+	if (ec)
+	{
+		cache.erase(classId);
+		return nullptr;
+	}
+	auto iter = cache.find(classId);
+	if (iter != cache.end() && iter->second.mtime == mtime && iter->second.size == size) return iter->second.archive;
+
+	auto archive = std::make_shared<ClassArchive>();
+	archive->path = path;
+	if (!archive->load()) archive = nullptr;
+	cache[classId] = Cached{ mtime, size, archive };
+	return archive;
+}
+
+bool ClassArchive::load()
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in) return false;
+	char header[HEADER_SIZE];
+	if (!in.read(header, HEADER_SIZE) || memcmp(header, MAGIC, sizeof(MAGIC)) != 0 || header[sizeof(MAGIC)] != VERSION) return false;
+	in.seekg(0, std::ios::end);
+	unsigned long long fileSize = (unsigned long long)in.tellg();
+	if (fileSize < HEADER_SIZE + FOOTER_SIZE) return false;
+	char footer[FOOTER_SIZE];
+	in.seekg(fileSize - FOOTER_SIZE);
+	if (!in.read(footer, FOOTER_SIZE) || memcmp(footer + 16, MAGIC, sizeof(MAGIC)) != 0) return false;
+	unsigned long long tocOffset = readLE(footer, 8), count = readLE(footer + 8, 8);
+	if (tocOffset < HEADER_SIZE || tocOffset > fileSize - FOOTER_SIZE) return false;
+
+	//目录：名称长度(4) 名称 位置(8) 长度(8)
+	std::string data((size_t)(fileSize - FOOTER_SIZE - tocOffset), '\0');
+	in.seekg(tocOffset);
+	if (!in.read(&data[0], data.size())) return false;
+	size_t pos = 0;
+	for (unsigned long long i = 0; i < count; i++)
+	{
+		if (data.size() - pos < 4) return false;
+		size_t nameLength = (size_t)readLE(data.data() + pos, 4);
+		pos += 4;
+		if (data.size() - pos < nameLength + 16) return false;
+		std::string name = data.substr(pos, nameLength);
+		pos += nameLength;
+		Entry entry;
+		entry.offset = readLE(data.data() + pos, 8);
+		entry.length = readLE(data.data() + pos + 8, 8);
+		pos += 16;
+		if (entry.offset < HEADER_SIZE || entry.offset > tocOffset || entry.length > tocOffset - entry.offset) return false;
+		toc[name] = entry;
+	}
+	return true;
+}
+
+const std::filesystem::path& ClassArchive::getPath() const
+{
+	return path;
+}
+
+bool ClassArchive::find(const std::string& name, Entry& entry) const
+{
+	auto iter = toc.find(name);
+	if (iter == toc.end()) return false;
+	entry = iter->second;
+	return true;
+}
+
+std::vector<std::pair<std::string, ClassArchive::Entry>> ClassArchive::list(const std::string& prefix) const
+{
+	std::vector<std::pair<std::string, Entry>> result;
+	for (auto iter = toc.lower_bound(prefix); iter != toc.end() && iter->first.compare(0, prefix.size(), prefix) == 0; iter++)
+	{
+		result.push_back(*iter);
+	}
+	return result;
+}
+
+bool ClassArchive::read(const Entry& entry, std::string& out) const
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in) return false;
+	in.seekg(entry.offset);
+	out.resize((size_t)entry.length);
+	return entry.length == 0 || (bool)in.read(&out[0], out.size());
+}
+
+bool ClassArchive::extract(const Entry& entry, const std::filesystem::path& target) const
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in) return false;
+	in.seekg(entry.offset);
+	std::filesystem::path tmpPath = target;
+	tmpPath += ".tmp";
+	std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+	std::string buffer(COPY_SIZE, '\0');
+	unsigned long long left = entry.length;
+	while (left > 0 && in.read(&buffer[0], (std::streamsize)std::min<unsigned long long>(COPY_SIZE, left)))
+	{
+		out.write(buffer.data(), in.gcount());
+		left -= in.gcount();
+	}
+	out.close();
+	std::error_code ec;
+	if (left == 0 && out) std::filesystem::rename(tmpPath, target, ec);
+	if (left > 0 || !out || ec)
+	{
+		std::filesystem::remove(tmpPath, ec);
+		return false;
+	}
+	return true;
+}
+
+ClassArchive::Writer::Writer(const std::filesystem::path& path, std::function<void(size_t)> throttle) :
+	path(path), throttle(throttle), offset(HEADER_SIZE), finished(false)
+{
+	tmpPath = path;
+	tmpPath += ".tmp";
+	std::error_code ec;
+	std::filesystem::create_directories(path.parent_path(), ec);
+	out.open(tmpPath, std::ios::binary | std::ios::trunc);
+	out.write(MAGIC, sizeof(MAGIC));
+	out.put(VERSION);
+}
+
+ClassArchive::Writer::~Writer()
+{
+	if (finished) return;
+	out.close();
+	std::error_code ec;
+	std::filesystem::remove(tmpPath, ec);
+}
+
+bool ClassArchive::Writer::copy(const std::string& name, std::istream& in, unsigned long long length)
+{
+	std::string buffer(COPY_SIZE, '\0');
+	unsigned long long left = length;
+	while (left > 0 && in.read(&buffer[0], (std::streamsize)std::min<unsigned long long>(COPY_SIZE, left)))
+	{
+		out.write(buffer.data(), in.gcount());
+		left -= in.gcount();
+		if (throttle) throttle((size_t)in.gcount());
+	}
+	offset += length - left;
+	if (left > 0 || !out) return false;
+	toc[name] = Entry{ offset - length, length };
+	return true;
+}
+
+bool ClassArchive::Writer::add(const std::string& name, const std::filesystem::path& file, const std::string& hash)
+{
+	//班级内重复提交的相同内容只写入一份
+	auto iter = hashes.find(hash);
+	if (!hash.empty() && iter != hashes.end())
+	{
+		toc[name] = iter->second;
+		return true;
+	}
+	std::ifstream in(file, std::ios::binary);
+	std::error_code ec;
+	unsigned long long length = std::filesystem::file_size(file, ec);
+	if (!in || ec || !copy(name, in, length)) return false;
+	if (!hash.empty()) hashes[hash] = toc[name];
+	return true;
+}
+
+bool ClassArchive::Writer::add(const std::string& name, const ClassArchive& archive, const Entry& entry)
+{
+	auto iter = copied.find(entry.offset);
+	if (iter != copied.end() && iter->second.length == entry.length)
+	{
+		toc[name] = iter->second;
+		return true;
+	}
+	std::ifstream in(archive.getPath(), std::ios::binary);
+	if (!in) return false;
+	in.seekg(entry.offset);
+	if (!copy(name, in, entry.length)) return false;
+	copied[entry.offset] = toc[name];
+	return true;
+}
+
+bool ClassArchive::Writer::addData(const std::string& name, std::string_view data)
+{
+	out.write(data.data(), data.size());
+	if (!out) return false;
+	toc[name] = Entry{ offset, data.size() };
+	offset += data.size();
+	if (throttle) throttle(data.size());
+	return true;
+}
+
+bool ClassArchive::Writer::finish()
+{
+	std::string tail;
+	for (auto& iter : toc)
+	{
+		writeLE(tail, iter.first.size(), 4);
+		tail += iter.first;
+		writeLE(tail, iter.second.offset, 8);
+		writeLE(tail, iter.second.length, 8);
+	}
+	writeLE(tail, offset, 8);
+	writeLE(tail, toc.size(), 8);
+	tail.append(MAGIC, sizeof(MAGIC));
+	out.write(tail.data(), tail.size());
+	out.close();
+	if (!out) return false;
+	std::error_code ec;
+	std::filesystem::rename(tmpPath, path, ec);
+	if (ec) return false;
+	finished = true;
+	return true;
+}
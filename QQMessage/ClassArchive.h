@@ -0,0 +1,114 @@
+﻿#pragma once
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// <summary>
+/// 结课班级的归档
+/// <para>班级全部提交的文件与.info依次写入 rootPath/.archives/班级id，末尾为目录与尾部，按目录随机读取任意一项</para>
+/// <para>项名为 学号/作业id/文件名，数据按原样存放，压缩存储的正文仍为压缩格式</para>
+/// </summary>
+class ClassArchive
+{
+public:
+	/// <summary>
+	/// 一项在归档文件中的位置
+	/// </summary>
+	struct Entry
+	{
+		unsigned long long offset = 0;
+		unsigned long long length = 0;
+	};
+	/// <summary>
+	/// 班级的归档文件
+	/// </summary>
+	static std::filesystem::path pathOf(long long classId);
+	/// <summary>
+	/// 打开班级的归档，目录按归档文件的修改时间与大小缓存，归档重写后重新读取
+	/// </summary>
+	/// <returns>没有归档或归档损坏时为空</returns>
+	static std::shared_ptr<const ClassArchive> open(long long classId);
+	const std::filesystem::path& getPath() const;
+	bool find(const std::string& name, Entry& entry) const;
+	/// <summary>
+	/// 名称以prefix开头的项，按名称排序
+	/// </summary>
+	std::vector<std::pair<std::string, Entry>> list(const std::string& prefix) const;
+	/// <summary>
+	/// 读取一项的原始数据
+	/// </summary>
+	bool read(const Entry& entry, std::string& out) const;
+	/// <summary>
+	/// 将一项复制为文件，先写 文件.tmp 再改名
+	/// </summary>
+	bool extract(const Entry& entry, const std::filesystem::path& target) const;
+
+	/// <summary>
+	/// 写入新的归档，先写 归档.tmp，finish时改名替换
+	/// </summary>
+	class Writer
+	{
+	public:
+		/// <param name="throttle">每写入一段后调用，参数为该段字节数，用于限速</param>
+		Writer(const std::filesystem::path& path, std::function<void(size_t)> throttle);
+		/// <summary>
+		/// 未finish时删除临时文件
+		/// </summary>
+		~Writer();
+		/// <summary>
+		/// 复制文件为一项
+		/// </summary>
+		/// <param name="hash">文件的SHA-256，与已写入的项相同时共用数据，不重复写入</param>
+		bool add(const std::string& name, const std::filesystem::path& file, const std::string& hash = "");
+		/// <summary>
+		/// 从旧归档复制一项，旧归档中共用数据的项仍然共用
+		/// </summary>
+		bool add(const std::string& name, const ClassArchive& archive, const Entry& entry);
+		bool addData(const std::string& name, std::string_view data);
+		/// <summary>
+		/// 写入目录与尾部并改名替换原归档
+		/// </summary>
+		/// <returns>写入或改名失败时返回false，原归档不变</returns>
+		bool finish();
+	private:
+		/// <summary>
+		/// 从流中复制length字节为一项
+		/// </summary>
+		bool copy(const std::string& name, std::istream& in, unsigned long long length);
+
+		std::filesystem::path path;
+		std::filesystem::path tmpPath;
+		std::ofstream out;
+		std::function<void(size_t)> throttle;
+		/// <summary>
+		/// 已写入的项【名称，位置】
+		/// </summary>
+		std::map<std::string, Entry> toc;
+		/// <summary>
+		/// 已写入的数据【SHA-256，位置】
+		/// </summary>
+		std::map<std::string, Entry> hashes;
+		/// <summary>
+		/// 已从旧归档复制的数据【旧位置，新位置】
+		/// </summary>
+		std::map<unsigned long long, Entry> copied;
+		unsigned long long offset;
+		bool finished;
+	};
+private:
+	/// <summary>
+	/// 读取尾部与目录
+	/// </summary>
+	bool load();
+
+	std::filesystem::path path;
+	/// <summary>
+	/// 目录【名称，位置】
+	/// </summary>
+	std::map<std::string, Entry> toc;
+};
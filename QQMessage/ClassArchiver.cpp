@@ -0,0 +1,119 @@
+﻿#include "ClassArchiver.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <DataManager.hpp>
+
+#include "File.h"
+
+extern std::string rootPath;
+
+namespace
+{
+	/// <summary>
+	/// 停止时由限速等待抛出，中止进行中的归档
+	/// </summary>
+	struct Stopped {};
+}
+
+ClassArchiver::ClassArchiver(double bytesPerSecond) :
+	bucket(std::max(bytesPerSecond, 65536.0), bytesPerSecond), stopping(false)
+{}
+
+ClassArchiver::~ClassArchiver()
+{
+	stop();
+}
+
+void ClassArchiver::start()
+{
+	if (worker.joinable()) return;
+	try
+	{
+		//补做上次退出前未完成的归档，以及结课时未在本进程中处理的班级
+		size_t count = 0;
+		for (auto& iter : DataManager::getEndedClassList())
+		{
+			if (!hasLooseSubmission(iter.getId())) continue;
+			add(iter.getId());
+			count++;
+		}
+		std::cerr << "Archiver queued " << count << " ended classes." << std::endl;
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Archiver load failed: " << e.what() << std::endl;
+	}
+	worker = std::thread(&ClassArchiver::run, this);
+}
+
+void ClassArchiver::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		stopping = true;
+	}
+	cv.notify_all();
+	if (worker.joinable()) worker.join();
+}
+
+void ClassArchiver::add(long long classId)
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		if (!queued.insert(classId).second) return;
+		queue.push_back(classId);
+	}
+	cv.notify_all();
+}
+
+bool ClassArchiver::hasLooseSubmission(long long classId)
+{
+	std::filesystem::path classPath = rootPath;
+	classPath /= std::to_string(classId);
+	std::error_code ec;
+	for (auto& student : std::filesystem::directory_iterator(classPath, ec))
+	{
+		if (student.is_directory()) return true;
+	}
+	return false;
+}
+
+void ClassArchiver::throttle(size_t bytes)
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	double wait = bucket.waitTime((double)bytes);
+	if (wait > 0) cv.wait_for(lock, std::chrono::duration<double>(wait), [this] { return stopping; });
+	if (stopping) throw Stopped();
+	bucket.tryConsume((double)bytes);
+}
+
+void ClassArchiver::run()
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true)
+	{
+		cv.wait(lock, [this] { return stopping || !queue.empty(); });
+		if (stopping) return;
+		long long classId = queue.front();
+		//处理期间再次加入时重新排队，归档期间新产生的工作目录在下一轮处理
+		queue.pop_front();
+		queued.erase(classId);
+		lock.unlock();
+		try
+		{
+			File::archiveClass(classId, [this](size_t bytes) { throttle(bytes); });
+			std::cerr << "Class " << classId << " archived." << std::endl;
+		}
+		catch (Stopped&)
+		{
+			return;
+		}
+		catch (std::exception& e)
+		{
+			std::cerr << "Archive of class " << classId << " failed: " << e.what() << std::endl;
+		}
+		lock.lock();
+	}
+}
@@ -0,0 +1,62 @@
+﻿#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "RateLimiter.h"
+
+/// <summary>
+/// 结课班级的后台归档
+/// <para>班级结课后将其全部提交打包为一个归档文件并删除工作目录，读取时按归档目录定位，无需解出</para>
+/// <para>单线程逐个班级处理，读写按字节数限速，避免与在线提交争抢磁盘</para>
+/// </summary>
+class ClassArchiver
+{
+public:
+	/// <param name="bytesPerSecond">归档每秒读写的字节数上限</param>
+	explicit ClassArchiver(double bytesPerSecond);
+	/// <summary>
+	/// 停止归档线程
+	/// </summary>
+	~ClassArchiver();
+	/// <summary>
+	/// 将已结课但仍有未归档提交的班级加入队列，并启动归档线程
+	/// </summary>
+	void start();
+	/// <summary>
+	/// 停止归档线程，进行中的班级放弃本次归档，工作目录保持不变
+	/// </summary>
+	void stop();
+	/// <summary>
+	/// 加入归档队列，已在队列中时忽略
+	/// </summary>
+	/// <param name="classId">班级ID</param>
+	void add(long long classId);
+private:
+	/// <summary>
+	/// 按限速等待，停止时中止归档
+	/// </summary>
+	/// <param name="bytes">刚写入的字节数</param>
+	void throttle(size_t bytes);
+	/// <summary>
+	/// 班级目录下是否还有未归档的提交
+	/// </summary>
+	static bool hasLooseSubmission(long long classId);
+	/// <summary>
+	/// 归档线程，逐个处理队列中的班级
+	/// </summary>
+	void run();
+
+	TokenBucket bucket;
+	/// <summary>
+	/// 等待归档的班级ID
+	/// </summary>
+	std::deque<long long> queue;
+	std::set<long long> queued;
+	std::mutex mtx;
+	std::condition_variable cv;
+	bool stopping;
+	std::thread worker;
+};
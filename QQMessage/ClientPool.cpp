@@ -0,0 +1,149 @@
+﻿#include "ClientPool.h"
+#include <limits>
+
+namespace
+{
+	/// <summary>
+	/// 当前线程所属账号，每个WebsocketClient有独立的io线程
+	/// </summary>
+	thread_local size_t inboundAccount = std::numeric_limits<size_t>::max();
+
+	/// <summary>
+	/// FNV-1a 64位哈希
+	/// </summary>
+	unsigned long long fnv1a(const void* data, size_t size)
+	{
+		const unsigned char* p = static_cast<const unsigned char*>(data);
+		unsigned long long hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= p[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	/// <summary>
+	/// 整数键哈希，先混合再取FNV，使相邻的班级id均匀分布
+	/// </summary>
+	unsigned long long hashKey(long long key)
+	{
+		unsigned long long x = (unsigned long long)key + 0x9e3779b97f4a7c15ull;
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+		x ^= x >> 31;
+		return fnv1a(&x, sizeof(x));
+	}
+}
+
+ClientPool::ClientPool(size_t capacity, double burst, double rate) :
+	capacity(capacity), burst(burst), rate(rate)
+{}
+
+ClientPool::~ClientPool()
+{
+	//出站队列调用客户端发送，须先于客户端析构
+	for (auto& iter : accounts) iter.dispatcher.reset();
+	for (auto& iter : accounts) iter.client.reset();
+}
+
+bool ClientPool::init(const std::vector<std::string>& urls, OnOpenFunc onOpen, OnCloseFunc onClose, OnFailFunc onFail, OnMessageFunc onMessage)
+{
+	accounts.reserve(urls.size());
+	for (size_t i = 0; i < urls.size(); i++)
+	{
+		Account account;
+		account.url = urls[i];
+		account.client = std::make_unique<WebsocketClient>();
+		WebsocketClient* client = account.client.get();
+		account.dispatcher = std::make_unique<MessageDispatcher>([client](const ApiRequest& request) { return client->Call(request); }, capacity, burst, rate);
+		client->SetOnOpenFunc(onOpen);
+		client->SetOnCloseFunc(onClose);
+		client->SetOnFailFunc(onFail);
+		client->SetMessageFunc([i, onMessage](const std::string& message)
+			{
+				inboundAccount = i;
+				onMessage(message);
+			});
+		accounts.push_back(std::move(account));
+
+		for (int node = 0; node < VIRTUAL_NODES; node++)
+		{
+			std::string name = urls[i] + "#" + std::to_string(node);
+			ring[fnv1a(name.data(), name.size())] = i;
+		}
+	}
+
+	bool result = true;
+	for (auto& iter : accounts)
+	{
+		if (!iter.client->Connect(iter.url)) result = false;
+	}
+	return result;
+}
+
+bool ClientPool::post(long long targetId, long long classId, ApiRequest request, SendPriority priority)
+{
+	if (accounts.empty())
+	{
+		ApiResult result;
+		result.status = ApiStatus::REJECTED;
+		if (request.callback != nullptr) request.callback(result);
+		return false;
+	}
+	return accounts[route(targetId, classId)].dispatcher->post(std::move(request), priority);
+}
+
+void ClientPool::bindSender(long long qq_id)
+{
+	if (inboundAccount >= accounts.size()) return;
+	std::lock_guard<std::mutex> lock(mtx);
+	lastInbound[qq_id] = inboundAccount;
+}
+
+void ClientPool::close(std::string reason)
+{
+	for (auto& iter : accounts) iter.client->Close(reason);
+}
+
+std::vector<AccountMetrics> ClientPool::getMetrics()
+{
+	std::vector<AccountMetrics> result;
+	for (auto& iter : accounts)
+	{
+		AccountMetrics metrics;
+		metrics.url = iter.url;
+		metrics.connected = iter.client->IsConnected();
+		metrics.outbound = iter.dispatcher->getMetrics();
+		metrics.latency = iter.client->GetLatency();
+		result.push_back(std::move(metrics));
+	}
+	return result;
+}
+
+size_t ClientPool::lookup(unsigned long long key)
+{
+	auto iter = ring.lower_bound(key);
+	if (iter == ring.end()) iter = ring.begin();
+	size_t primary = iter->second;
+	for (size_t visited = 0; visited < ring.size(); visited++)
+	{
+		if (accounts[iter->second].client->IsConnected()) return iter->second;
+		if (++iter == ring.end()) iter = ring.begin();
+	}
+	return primary;//均不在线，缓冲至首选账号重连
+}
+
+size_t ClientPool::route(long long targetId, long long classId)
+{
+	if (accounts.size() == 1) return 0;
+	{
+		//账号只能给好友发消息，学生发过消息的账号必然是其好友，批量推送同样优先使用
+		std::lock_guard<std::mutex> lock(mtx);
+		auto iter = lastInbound.find(targetId);
+		if (iter != lastInbound.end() && accounts[iter->second].client->IsConnected()) return iter->second;
+	}
+	//本次运行中未发过消息或其账号断线时按班级选择，未注册用户尚无班级
+	if (classId > 0) return lookup(hashKey(classId));
+	return lookup(hashKey(targetId));
+}
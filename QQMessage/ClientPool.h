@@ -0,0 +1,116 @@
+﻿#pragma once
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "WebsocketClient.h"
+#include "MessageDispatcher.h"
+
+/// <summary>
+/// 账号统计
+/// </summary>
+struct AccountMetrics
+{
+	std::string url;
+	bool connected = false;
+	DispatcherMetrics outbound;
+	std::map<std::string, LatencyHistogram> latency;
+};
+
+/// <summary>
+/// go-cqhttp连接池
+/// <para>每个机器人账号一个WebsocketClient与独立限速的出站队列，所有账号的上报进入同一处理流程</para>
+/// <para>QQ账号只能给好友发消息，所有发送优先使用学生最近发消息的账号；本次运行中学生未发过消息或该账号断线时，按班级在一致性哈希环上选择账号，账号断线时顺延至环上下一个在线账号</para>
+/// <para>按班级选择时学生须已添加该班级对应的账号为好友，部署时应让学生添加全部账号</para>
+/// </summary>
+class ClientPool
+{
+public:
+	/// <summary>
+	/// 初始化连接池，每个账号的出站队列使用相同参数
+	/// </summary>
+	/// <param name="capacity">队列容量</param>
+	/// <param name="burst">令牌桶大小</param>
+	/// <param name="rate">每秒补充令牌数</param>
+	ClientPool(size_t capacity, double burst, double rate);
+	/// <summary>
+	/// 先停止出站队列，再断开连接
+	/// </summary>
+	~ClientPool();
+	ClientPool(const ClientPool&) = delete;
+	ClientPool& operator=(const ClientPool&) = delete;
+	/// <summary>
+	/// 连接所有账号，只能调用一次
+	/// </summary>
+	/// <param name="urls">go-cqhttp地址 ws://ip:port</param>
+	/// <param name="onOpen">任一账号建立连接后执行</param>
+	/// <param name="onClose">任一账号连接关闭后执行</param>
+	/// <param name="onFail">任一账号连接失败后执行</param>
+	/// <param name="onMessage">任一账号收到消息后执行</param>
+	/// <returns>全部连接发起成功返回true</returns>
+	bool init(const std::vector<std::string>& urls, OnOpenFunc onOpen, OnCloseFunc onClose, OnFailFunc onFail, OnMessageFunc onMessage);
+	/// <summary>
+	/// 选择账号并加入其出站队列
+	/// <para>未能入队时以REJECTED执行请求的回调</para>
+	/// </summary>
+	/// <param name="targetId">接收者qq</param>
+	/// <param name="classId">接收者班级，未知时为0</param>
+	/// <param name="request">api请求</param>
+	/// <param name="priority">优先级</param>
+	/// <returns>入队结果</returns>
+	bool post(long long targetId, long long classId, ApiRequest request, SendPriority priority);
+	/// <summary>
+	/// 记录发送者最近发消息的账号，须在账号的消息回调中调用
+	/// </summary>
+	/// <param name="qq_id">发送者qq</param>
+	void bindSender(long long qq_id);
+	/// <summary>
+	/// 关闭所有连接
+	/// </summary>
+	/// <param name="reason">关闭原因</param>
+	void close(std::string reason);
+	/// <summary>
+	/// 获取各账号统计
+	/// </summary>
+	std::vector<AccountMetrics> getMetrics();
+private:
+	/// <summary>
+	/// 机器人账号
+	/// </summary>
+	struct Account
+	{
+		std::string url;
+		std::unique_ptr<WebsocketClient> client;
+		std::unique_ptr<MessageDispatcher> dispatcher;
+	};
+	/// <summary>
+	/// 每个账号在哈希环上的虚拟节点数
+	/// </summary>
+	static constexpr int VIRTUAL_NODES = 100;
+	/// <summary>
+	/// 在哈希环上顺时针查找第一个在线账号，均不在线时返回首个节点
+	/// </summary>
+	/// <param name="key">哈希值</param>
+	/// <returns>账号下标</returns>
+	size_t lookup(unsigned long long key);
+	/// <summary>
+	/// 选择发送账号，优先为学生最近发消息的在线账号，其次按班级，最后按qq号
+	/// </summary>
+	size_t route(long long targetId, long long classId);
+
+	size_t capacity;
+	double burst;
+	double rate;
+	std::vector<Account> accounts;
+	/// <summary>
+	/// 一致性哈希环【哈希值，账号下标】
+	/// </summary>
+	std::map<unsigned long long, size_t> ring;
+	std::mutex mtx;
+	/// <summary>
+	/// 发送者最近发消息的账号【qq号，账号下标】
+	/// </summary>
+	std::map<long long, size_t> lastInbound;
+};
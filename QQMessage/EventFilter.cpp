@@ -0,0 +1,110 @@
+﻿#include "EventFilter.h"
+
+namespace
+{
+	/// <summary>
+	/// 跳过空白字符
+	/// </summary>
+	size_t skipSpace(std::string_view s, size_t pos)
+	{
+		while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\r' || s[pos] == '\n')) pos++;
+		return pos;
+	}
+
+	/// <summary>
+	/// 跳过字符串，pos指向起始引号
+	/// </summary>
+	/// <returns>结束引号后一位，格式错误返回npos</returns>
+	size_t skipString(std::string_view s, size_t pos)
+	{
+		for (pos++; pos < s.size(); pos++)
+		{
+			if (s[pos] == '\\') pos++;
+			else if (s[pos] == '"') return pos + 1;
+		}
+		return std::string_view::npos;
+	}
+
+	/// <summary>
+	/// 跳过任意json值
+	/// </summary>
+	/// <returns>值后一位，格式错误返回npos</returns>
+	size_t skipValue(std::string_view s, size_t pos)
+	{
+		if (pos >= s.size()) return std::string_view::npos;
+		if (s[pos] == '"') return skipString(s, pos);
+		int depth = 0;
+		while (pos < s.size())
+		{
+			char c = s[pos];
+			if (c == '"')
+			{
+				pos = skipString(s, pos);
+				if (pos == std::string_view::npos) return pos;
+				continue;
+			}
+			if (c == '{' || c == '[') depth++;
+			else if (c == '}' || c == ']')
+			{
+				if (depth == 0) return pos;
+				if (--depth == 0) return pos + 1;
+			}
+			else if (c == ',' && depth == 0) return pos;
+			pos++;
+		}
+		return depth == 0 ? pos : std::string_view::npos;
+	}
+
+	/// <summary>
+	/// 字段已足够判断帧类型
+	/// </summary>
+	bool decided(const EventHeader& header)
+	{
+		if (header.postType == "meta_event") return true;
+		if (header.postType == "message") return !header.messageType.empty();
+		if (header.postType == "notice") return !header.noticeType.empty();
+		return false;
+	}
+}
+
+EventHeader EventFilter::scan(std::string_view frame)
+{
+	EventHeader header;
+	bool hasRetcode = false;
+	size_t pos = skipSpace(frame, 0);
+	if (pos >= frame.size() || frame[pos] != '{') return header;
+	pos++;
+	while (true)
+	{
+		pos = skipSpace(frame, pos);
+		if (pos >= frame.size() || frame[pos] != '"') break;
+		size_t keyEnd = skipString(frame, pos);
+		if (keyEnd == std::string_view::npos) return EventHeader();
+		std::string_view key = frame.substr(pos + 1, keyEnd - pos - 2);
+		pos = skipSpace(frame, keyEnd);
+		if (pos >= frame.size() || frame[pos] != ':') return EventHeader();
+		pos = skipSpace(frame, pos + 1);
+		size_t valueEnd = skipValue(frame, pos);
+		if (valueEnd == std::string_view::npos) return EventHeader();
+		std::string_view value = frame.substr(pos, valueEnd - pos);
+		std::string_view text;
+		if (value.size() >= 2 && value.front() == '"') text = value.substr(1, value.size() - 2);
+
+		if (key == "post_type") header.postType = text;
+		else if (key == "message_type") header.messageType = text;
+		else if (key == "notice_type") header.noticeType = text;
+		else if (key == "echo") header.echo = value;
+		else if (key == "retcode") hasRetcode = true;
+		if (decided(header)) break;
+
+		pos = skipSpace(frame, valueEnd);
+		if (pos < frame.size() && frame[pos] == ',') pos++;
+		else break;
+	}
+
+	if (header.postType == "meta_event") header.kind = EventKind::HEARTBEAT;
+	else if (header.postType == "message" && header.messageType == "private") header.kind = EventKind::PRIVATE_MESSAGE;
+	else if (header.noticeType == "offline_file") header.kind = EventKind::OFFLINE_FILE;
+	else if (header.postType.empty() && (!header.echo.empty() || hasRetcode)) header.kind = EventKind::API_RESPONSE;
+	return header;
+}
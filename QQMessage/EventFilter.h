@@ -0,0 +1,60 @@
+﻿#pragma once
+#include <string_view>
+
+/// <summary>
+/// go-cqhttp上报帧类型
+/// </summary>
+enum class EventKind
+{
+	/// <summary>
+	/// 心跳包等元事件
+	/// </summary>
+	HEARTBEAT,
+	/// <summary>
+	/// 私聊消息
+	/// </summary>
+	PRIVATE_MESSAGE,
+	/// <summary>
+	/// 离线文件
+	/// </summary>
+	OFFLINE_FILE,
+	/// <summary>
+	/// API调用回执
+	/// </summary>
+	API_RESPONSE,
+	/// <summary>
+	/// 其他事件或无法识别
+	/// </summary>
+	OTHER
+};
+
+/// <summary>
+/// 上报帧的顶层字段
+/// <para>字段指向原始帧，不做转义处理，帧销毁后失效</para>
+/// </summary>
+struct EventHeader
+{
+	EventKind kind = EventKind::OTHER;
+	std::string_view postType;
+	std::string_view messageType;
+	std::string_view noticeType;
+	/// <summary>
+	/// echo原始值（含引号）
+	/// </summary>
+	std::string_view echo;
+};
+
+/// <summary>
+/// 静态类
+/// <para>在完整解析json前对上报帧预分类，只扫描顶层key，不构建DOM、不分配内存</para>
+/// </summary>
+class EventFilter
+{
+public:
+	/// <summary>
+	/// 扫描帧的顶层字段
+	/// </summary>
+	/// <param name="frame">原始json帧</param>
+	/// <returns>帧类型及字段</returns>
+	static EventHeader scan(std::string_view frame);
+};
@@ -1,54 +1,157 @@
 ﻿#include "File.h"
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
 #include <string>
 
 #include "FileInfo.h"
 #include "Exception.h"
 #include "Tools.h"
-#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
-	#include <Windows.h>
-    #pragma comment(lib, "urlmon.lib")
-#endif
+#include "HttpFetcher.h"
+#include "BlobStore.h"
+#include "Sha256.h"
+#include "TextCompressor.h"
+#include "StorageQuota.h"
+#include "FileCache.h"
+#include "ClassArchive.h"
 
 
 extern std::string rootPath;
+extern HttpFetcher httpFetcher;
+extern StorageQuota storageQuota;
+extern FileCache fileCache;
 
-File::File(long long classId, long long schoolId, long long homeworkId) :
-	classId(classId), schoolId(schoolId), homeworkId(homeworkId)
+namespace
 {
-	workPath = rootPath;
-	workPath.append(std::to_string(classId)).append(std::to_string(schoolId)).append(std::to_string(homeworkId));
-	relativePath.append(std::to_string(classId)).append(std::to_string(schoolId)).append(std::to_string(homeworkId));
-	infoPath = workPath;
-	infoPath.append(".info");
-	try
+	/// <summary>
+	/// 正文与代码是否压缩存储，默认关闭
+	/// </summary>
+	std::atomic<bool> compressText(false);
+
+	/// <summary>
+	/// 全部提交共用的内容寻址存储，首次使用时按rootPath创建
+	/// </summary>
+	BlobStore& blobs()
 	{
-		create_directories(workPath);
+		static BlobStore store(std::filesystem::path(rootPath) / ".blobs");
+		return store;
+	}
 
-		if (std::filesystem::exists(infoPath))
+	/// <summary>
+	/// 流式计算文件哈希
+	/// </summary>
+	/// <returns>文件不存在时返回空</returns>
+	std::string hashFile(const std::filesystem::path& path, unsigned long long& size)
+	{
+		std::ifstream in(path, std::ios::binary);
+		if (!in) return "";
+		Sha256 sha;
+		char buffer[65536];
+		size = 0;
+		while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0)
 		{
-			std::ifstream in;
-			in.open(infoPath);
-			in >> autoIndex >> submitId;
-			in.close();
-			std::ofstream out;
-			out.open(infoPath, std::ios::trunc);
-			out << autoIndex << std::endl << submitId << std::endl;
-			out.close();
+			sha.update(buffer, (size_t)in.gcount());
+			size += in.gcount();
+		}
+		return sha.hexDigest();
+	}
+
+	/// <summary>
+	/// 是否按压缩格式存储该文件
+	/// </summary>
+	bool compressible(const std::filesystem::path& fileName)
+	{
+		if (!compressText) return false;
+		FileFormats format = FileInfo::formatOf(fileName);
+		return format == FileFormats::TXT || format == FileFormats::CODE;
+	}
+
+	/// <summary>
+	/// 一次下载在存储配额中的预留
+	/// <para>开始时预留声明的大小，收到Content-Length或接收中超出时按实际剩余配额补充，并发的下载合计不超过配额</para>
+	/// </summary>
+	struct QuotaReservation
+	{
+		long long classId;
+		long long studentId;
+		unsigned long long bytes = 0;
+
+		/// <summary>
+		/// 预留至不少于total字节
+		/// </summary>
+		/// <returns>剩余配额不足时返回false</returns>
+		bool grow(unsigned long long total)
+		{
+			if (total <= bytes) return true;
+			bytes += storageQuota.reserve(classId, studentId, total - bytes);
+			return bytes >= total;
 		}
-		else
+		/// <summary>
+		/// 下载结束后释放，成功时须先记录实际用量
+		/// </summary>
+		void release()
 		{
-			std::ofstream out;
-			out.open(infoPath, std::ios::trunc);
-			out << autoIndex << std::endl << -1 << std::endl;
-			out.close();
+			storageQuota.release(classId, studentId, bytes);
+			bytes = 0;
 		}
+	};
+
+	/// <summary>
+	/// Content-Length超出剩余配额时不接收，未知长度时接收中截断
+	/// </summary>
+	FetchOptions quotaOptions(std::shared_ptr<QuotaReservation> reservation)
+	{
+		FetchOptions options;
+		options.admit = [reservation](unsigned long long total) { return reservation->grow(total); };
+		return options;
 	}
-	catch (std::exception& e)
+}
+
+void File::setTextCompression(bool enable)
+{
+	compressText = enable;
+}
+
+/// <summary>
+/// 同一提交目录的File共享的状态，与.info内容一致
+/// </summary>
+struct File::Submission
+{
+	std::mutex mtx;
+	int autoIndex = 1;
+	long long submitId = -1;
+	/// <summary>
+	/// 提交清单，按保存顺序
+	/// </summary>
+	std::vector<ManifestEntry> entries;
+	/// <summary>
+	/// 内存中的状态与.info不一致
+	/// </summary>
+	bool dirty = false;
+	/// <summary>
+	/// 已预留、尚在下载的图片，下载结束前不归档
+	/// </summary>
+	std::set<std::string> reserved;
+
+	std::vector<ManifestEntry>::iterator find(const std::string& fileName)
 	{
-		throw FileError(e.what());
+		return std::find_if(entries.begin(), entries.end(), [&fileName](const ManifestEntry& entry) { return entry.name == fileName; });
 	}
+};
+
+File::File(long long classId, long long schoolId, long long homeworkId) :
+	classId(classId), schoolId(schoolId), homeworkId(homeworkId)
+{
+	workPath = rootPath;
+	workPath.append(std::to_string(classId)).append(std::to_string(schoolId)).append(std::to_string(homeworkId));
+	relativePath.append(std::to_string(classId)).append(std::to_string(schoolId)).append(std::to_string(homeworkId));
+	infoPath = workPath;
+	infoPath.append(".info");
+	open();
 }
 
 File::File(HomeworkInfo info)
@@ -59,67 +162,215 @@ File::File(HomeworkInfo info)
 	workPath.append(std::to_string(classId)).append(std::to_string(schoolId)).append(std::to_string(homeworkId));
 	infoPath = workPath;
 	infoPath.append(".info");
+	open();
+}
+
+void File::open()
+{
 	try
 	{
-		create_directories(workPath);
+		//已归档的提交从归档读取.info，修改时再解出
+		std::string archivedInfo;
+		bool archived = false;
+		if (!std::filesystem::exists(workPath))
+		{
+			auto archive = ClassArchive::open(classId);
+			ClassArchive::Entry entry;
+			archived = archive && archive->find(archiveName(".info"), entry) && archive->read(entry, archivedInfo);
+		}
+		if (!archived) create_directories(workPath);
+		submission = openSubmission(workPath, infoPath, archived ? &archivedInfo : nullptr);
+		std::lock_guard<std::mutex> lock(submission->mtx);
+		submitId = submission->submitId;
+		//仅旧版.info补全清单后需要写入
+		flush();
+	}
+	catch (std::exception& e)
+	{
+		throw FileError(e.what());
+	}
+}
 
-		if (std::filesystem::exists(infoPath))
+std::shared_ptr<File::Submission> File::openSubmission(const std::filesystem::path& workPath, const std::filesystem::path& infoPath, const std::string* archivedInfo)
+{
+	static std::mutex registryMutex;
+	static std::map<std::string, std::shared_ptr<Submission>> registry;
+	std::lock_guard<std::mutex> registryLock(registryMutex);
+	std::shared_ptr<Submission>& cached = registry[workPath.string()];
+	if (cached) return cached;
+
+	//超出上限时丢弃没有File在使用的项，状态变化时已写入.info，丢弃后可重新读取
+	if (registry.size() > SUBMISSION_CACHE_SIZE)
+	{
+		for (auto iter = registry.begin(); iter != registry.end();)
 		{
-			std::ifstream in;
-			in.open(infoPath);
-			in >> autoIndex >> submitId;
-			in.close();
-			std::ofstream out;
-			out.open(infoPath, std::ios::trunc);
-			out << autoIndex << std::endl << submitId << std::endl;
-			out.close();
+			if (iter->second && iter->second.use_count() == 1) iter = registry.erase(iter);
+			else iter++;
 		}
-		else
+	}
+
+	auto submission = std::make_shared<Submission>();
+	bool hasManifest = false;
+	std::ifstream file;
+	std::istringstream archived;
+	if (archivedInfo) archived.str(*archivedInfo);
+	else file.open(infoPath);
+	std::istream& in = archivedInfo ? (std::istream&)archived : file;
+	std::string line;
+	if (in >> submission->autoIndex >> submission->submitId)
+	{
+		std::getline(in, line);
+		if (std::getline(in, line) && line == "__MANIFEST__")
 		{
-			std::ofstream out;
-			out.open(infoPath, std::ios::trunc);
-			out << autoIndex << std::endl << -1 << std::endl;
-			out.close();
+			hasManifest = true;
+			//文件名\t分类\t大小\t哈希
+			while (std::getline(in, line))
+			{
+				std::istringstream fields(line);
+				ManifestEntry entry;
+				std::string format, size;
+				if (!std::getline(fields, entry.name, '\t') || !std::getline(fields, format, '\t') || !std::getline(fields, size, '\t')) continue;
+				std::getline(fields, entry.hash);
+				entry.format = FileInfo::parseFormat(format);
+				entry.size = std::strtoull(size.c_str(), nullptr, 10);
+				submission->entries.push_back(std::move(entry));
+			}
 		}
 	}
-	catch (std::exception& e)
+	file.close();
+	if (!hasManifest)
 	{
-		throw FileError(e.what());
+		//旧版.info没有清单，扫描一次目录
+		for (auto& iter : std::filesystem::directory_iterator(workPath))
+		{
+			std::string name = iter.path().filename().string();
+			if (name == ".info" || iter.path().extension() == ".part" || !iter.is_regular_file()) continue;
+			ManifestEntry entry;
+			entry.name = name;
+			entry.format = FileInfo::formatOf(name);
+			entry.hash = hashFile(iter.path(), entry.size);
+			if (entry.size > 0) blobs().intern(iter.path(), entry.hash);
+			submission->entries.push_back(std::move(entry));
+		}
+		submission->dirty = true;
 	}
+	cached = submission;
+	return submission;
 }
 
-long long File::getSubmitId()
+std::string File::archiveName(const std::string& fileName)
 {
-	if (std::filesystem::exists(infoPath))
+	return std::to_string(schoolId) + "/" + std::to_string(homeworkId) + "/" + fileName;
+}
+
+std::string File::infoText()
+{
+	std::string info = std::to_string(submission->autoIndex) + "\n" + std::to_string(submission->submitId) + "\n__MANIFEST__\n";
+	for (auto& entry : submission->entries)
 	{
-		int tmp;
-		std::ifstream in;
-		in.open(infoPath);
-		in >> tmp >> tmp;
-		in.close();
-		return tmp;
+		info += entry.name + "\t" + FileInfo::formatName(entry.format) + "\t" + std::to_string(entry.size) + "\t" + entry.hash + "\n";
 	}
-	else
+	return info;
+}
+
+void File::flush()
+{
+	if (!submission->dirty) return;
+	std::string info = infoText();
+	//先写临时文件再改名，崩溃时.info保持旧的完整内容
+	std::filesystem::path tmpPath = infoPath;
+	tmpPath += ".tmp";
+	std::ofstream out;
+	out.open(tmpPath, std::ios::binary | std::ios::trunc);
+	out.write(info.data(), info.size());
+	out.close();
+	std::error_code ec;
+	if (out) std::filesystem::rename(tmpPath, infoPath, ec);
+	if (!out || ec)
 	{
-		return -1;
+		std::cerr << "Cannot write " << infoPath.string() << std::endl;
+		return;
 	}
+	submission->dirty = false;
+}
+
+void File::record(const std::string& fileName, unsigned long long size, const std::string& hash)
+{
+	auto iter = submission->find(fileName);
+	if (iter == submission->entries.end())
+	{
+		ManifestEntry entry;
+		entry.name = fileName;
+		entry.format = FileInfo::formatOf(fileName);
+		iter = submission->entries.insert(submission->entries.end(), std::move(entry));
+	}
+	//重新写入的文件即使内容不变也是新的inode，同样需要入库
+	if (size > 0) blobs().intern(workPath / fileName, hash);
+	if (iter->size == size && iter->hash == hash)
+	{
+		flush();
+		return;
+	}
+	std::string previous = iter->hash;
+	long long delta = (long long)size - (long long)iter->size;
+	iter->size = size;
+	iter->hash = hash;
+	submission->dirty = true;
+	flush();
+	storageQuota.add(classId, schoolId, delta);
+	if (!previous.empty()) blobs().release(previous);
+}
+
+void File::recordFile(const std::string& fileName, std::string hash, unsigned long long size)
+{
+	if (hash.empty()) hash = hashFile(workPath / fileName, size);
+	std::lock_guard<std::mutex> lock(submission->mtx);
+	submission->reserved.erase(fileName);
+	if (hash.empty()) forget(fileName);
+	else record(fileName, size, hash);
+}
+
+void File::forget(const std::string& fileName)
+{
+	submission->reserved.erase(fileName);
+	auto iter = submission->find(fileName);
+	if (iter == submission->entries.end()) return;
+	std::string hash = iter->hash;
+	unsigned long long size = iter->size;
+	submission->entries.erase(iter);
+	submission->dirty = true;
+	flush();
+	storageQuota.add(classId, schoolId, -(long long)size);
+	blobs().release(hash);
+}
+
+long long File::getSubmitId()
+{
+	std::lock_guard<std::mutex> lock(submission->mtx);
+	return submission->submitId;
 }
 
 std::string File::storeText(std::string data)
 {
-	std::filesystem::path fileName = std::to_string(autoIndex)+".txt";
+	unpack();
+	std::lock_guard<std::mutex> lock(submission->mtx);
+	std::filesystem::path fileName = std::to_string(submission->autoIndex)+".txt";
 	while (std::filesystem::exists(workPath / fileName))
 	{
-		autoIndex++;
-		fileName = std::to_string(autoIndex) + ".txt";
+		submission->autoIndex++;
+		submission->dirty = true;
+		fileName = std::to_string(submission->autoIndex) + ".txt";
 	}
 	try
 	{
+		std::string stored = compressText ? TextCompressor::compress(data) : data;
 		std::ofstream out;
-		out.open(workPath / fileName, std::ios::trunc);
-		out << data;
+		out.open(workPath / fileName, std::ios::binary | std::ios::trunc);
+		out.write(stored.data(), stored.size());
 		out.close();
-		autoIndex++;
+		submission->autoIndex++;
+		submission->dirty = true;
+		record(fileName.string(), stored.size(), Sha256::hash(stored));
 		return fileName.string();
 	}
 	catch (std::exception& e)
@@ -129,68 +380,166 @@ std::string File::storeText(std::string data)
 	
 }
 
+void File::appendText(std::filesystem::path fileName, std::string data)
+{
+	unpack();
+	std::filesystem::path path = workPath / fileName;
+	if (compressible(fileName))
+	{
+		//解压后追加，重新压缩写入临时文件再改名，不改动共享的blob
+		std::string content, stored;
+		try
+		{
+			if (!TextCompressor::readFile(path, content) && std::filesystem::exists(path)) throw FileError("cannot read file:" + path.string());
+			content += "\n" + data;
+			stored = TextCompressor::compress(content);
+			std::filesystem::path tmpPath = path;
+			tmpPath += ".tmp";
+			std::ofstream out;
+			out.open(tmpPath, std::ios::binary | std::ios::trunc);
+			out.write(stored.data(), stored.size());
+			out.close();
+			if (!out) throw FileError("cannot write file:" + tmpPath.string());
+			std::filesystem::rename(tmpPath, path);
+		}
+		catch (std::exception& e)
+		{
+			throw FileError("cannot store file:" + path.string() + "\n" + e.what());
+		}
+		recordFile(fileName.string(), Sha256::hash(stored), stored.size());
+		return;
+	}
+	try
+	{
+		//内容可能与其他提交共享，先复制为独立文件
+		blobs().detach(workPath / fileName);
+		std::ofstream out;
+		out.open(workPath / fileName, std::ios::app);
+		out << std::endl << data;
+		out.close();
+	}
+	catch (std::exception& e)
+	{
+		throw FileError("cannot store file:" + (workPath / fileName).string() + "\n" + e.what());
+	}
+	recordFile(fileName.string());
+}
+
 std::string File::delFile(std::filesystem::path fileName)
 {
-	if (!std::filesystem::exists(workPath / fileName)) return u8"无法找到文件：" + fileName.string();
+	unpack();
+	if (!std::filesystem::exists(workPath / fileName)) return u8"无法找到文件：" + fileName.u8string();
 	try
 	{
 		std::filesystem::remove(workPath / fileName);
 	}
 	catch (std::exception)
 	{
-		return u8"无法找到文件：" + fileName.string() + " 请重试";
+		return u8"无法找到文件：" + fileName.u8string() + " 请重试";
 	}
-	return u8"成功删除文件：" + fileName.string();
-}
-#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
-LPCWSTR stringToLPCWSTR(std::string orig)
-{
-	size_t origsize = orig.length() + 1;
-	const size_t newsize = 100;
-	size_t convertedChars = 0;
-	wchar_t* wcstring = (wchar_t*)malloc(sizeof(wchar_t) * (orig.length() - 1));
-	mbstowcs_s(&convertedChars, wcstring, origsize, orig.c_str(), _TRUNCATE);
-
-	return wcstring;
+	std::lock_guard<std::mutex> lock(submission->mtx);
+	forget(fileName.string());
+	return u8"成功删除文件：" + fileName.u8string();
 }
-#endif
 
-std::string File::downFile(std::string url, std::filesystem::path fileName)
+std::filesystem::path File::uniqueName(std::filesystem::path fileName)
 {
 	if (std::filesystem::exists(workPath / fileName))
 	{
 		fileName = fileName.stem().string() + std::to_string(Tools::getTimestamp()) + "." + fileName.string().substr(fileName.string().find_last_of(".") + 1);
 	}
+	return fileName;
+}
+
+std::string File::downFile(std::string url, std::filesystem::path fileName, unsigned long long expectedSize)
+{
+	unpack();
+	fileName = uniqueName(fileName);
+	//预留配额，并发的下载不会各自按全部剩余量接收
+	auto reservation = std::make_shared<QuotaReservation>(QuotaReservation{ classId, schoolId });
+	if (!reservation->grow(std::max<unsigned long long>(expectedSize, 1)))
+	{
+		reservation->release();
+		std::cerr << "Download " << url << " rejected: storage quota exceeded" << std::endl;
+		return "";
+	}
+	FetchResult result;
 	try
 	{
-#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
-		URLDownloadToFile(NULL, stringToLPCWSTR(url), stringToLPCWSTR((workPath / fileName).string()), 0, NULL);
-#else
-		std::string file=(workPath / fileName).string();
-		std::string comm="curl \""+url+"\" --create-dirs -o \""+file+"\"";
-		std::cout << comm<<std::endl;
-		system(comm.c_str());
-#endif
-		return fileName.string();
+		result = httpFetcher.fetchAsync(url, workPath / fileName, quotaOptions(reservation)).get();
+		if (result.status == FetchStatus::OK)
+		{
+			//压缩后内容改变，重新计算哈希
+			if (compressible(fileName) && TextCompressor::compressFile(workPath / fileName)) recordFile(fileName.string());
+			else recordFile(fileName.string(), result.sha256, result.bytes);
+		}
 	}
 	catch (...)
 	{
+		reservation->release();
+		throw;
+	}
+	reservation->release();
+	if (result.status != FetchStatus::OK)
+	{
+		std::cerr << "Download " << url << " failed: " << result.error << std::endl;
 		return "";
 	}
+	return fileName.string();
+}
+
+void File::downFileAsync(std::string url, std::filesystem::path fileName, std::function<void(std::string)> callback, unsigned long long expectedSize)
+{
+	unpack();
+	fileName = uniqueName(fileName);
+	auto reservation = std::make_shared<QuotaReservation>(QuotaReservation{ classId, schoolId });
+	if (!reservation->grow(std::max<unsigned long long>(expectedSize, 1)))
+	{
+		reservation->release();
+		std::cerr << "Download " << url << " rejected: storage quota exceeded" << std::endl;
+		if (callback) callback("");
+		return;
+	}
+	std::string name = fileName.string();
+	httpFetcher.fetch(url, workPath / fileName, [self = *this, url, name, callback, reservation](const FetchResult& result) mutable
+		{
+			if (result.status != FetchStatus::OK)
+			{
+				std::cerr << "Download " << url << " failed: " << result.error << std::endl;
+			}
+			else if (compressible(name) && TextCompressor::compressFile(result.path))
+			{
+				self.recordFile(name);
+			}
+			else
+			{
+				self.recordFile(name, result.sha256, result.bytes);
+			}
+			//已记录实际用量，释放预留
+			reservation->release();
+			if (callback) callback(result.status == FetchStatus::OK ? name : "");
+		}, quotaOptions(reservation));
 }
 
 std::string File::storePic(std::string url)
 {
-	std::filesystem::path fileName = std::to_string(autoIndex) + ".png";
-	while (std::filesystem::exists(workPath / fileName))
+	unpack();
+	std::filesystem::path fileName;
 	{
-		autoIndex++;
-		fileName = std::to_string(autoIndex) + ".png";
+		std::lock_guard<std::mutex> lock(submission->mtx);
+		fileName = std::to_string(submission->autoIndex) + ".png";
+		while (std::filesystem::exists(workPath / fileName))
+		{
+			submission->autoIndex++;
+			submission->dirty = true;
+			fileName = std::to_string(submission->autoIndex) + ".png";
+		}
+		submission->autoIndex++;
+		submission->dirty = true;
 	}
 	try
 	{
 		downFile(url, fileName);
-		autoIndex++;
 		return fileName.string();
 	}
 	catch (std::exception& e)
@@ -200,155 +549,134 @@ std::string File::storePic(std::string url)
 
 }
 
-bool File::save(long long submitId)
+std::string File::reservePic()
 {
-	this->submitId = submitId;
-	if (!std::filesystem::exists(infoPath))
+	unpack();
+	std::lock_guard<std::mutex> lock(submission->mtx);
+	std::filesystem::path fileName = std::to_string(submission->autoIndex) + ".png";
+	while (std::filesystem::exists(workPath / fileName))
 	{
-		return false;
+		submission->autoIndex++;
+		submission->dirty = true;
+		fileName = std::to_string(submission->autoIndex) + ".png";
 	}
-	std::ifstream in;
-	in.open(infoPath);
-	in >> autoIndex;
-	in.close();
+	std::ofstream out;
+	out.open(workPath / fileName, std::ios::trunc);
+	if (!out) throw FileError("cannot store file:" + (workPath / fileName).string());
+	out.close();
+	submission->autoIndex++;
+	submission->dirty = true;
+	record(fileName.string(), 0, Sha256::hash(""));
+	submission->reserved.insert(fileName.string());
+	return fileName.string();
+}
 
-	int cnt = 0;
-	std::vector<std::string> txtFile, picFile, codeFile, otherFile;
-	for (auto& iter : std::filesystem::directory_iterator(workPath))
-	{
-		if (iter.path().filename().string() == ".info") continue;
-		cnt++;
-		FileInfo fileInfo(iter.path());
-		switch (fileInfo.getFileFormats())
+void File::downReserved(std::string url, std::filesystem::path fileName, std::function<void(bool)> callback)
+{
+	std::filesystem::path path = workPath / fileName;
+	//图片大小未知，收到Content-Length时再按实际大小预留
+	auto reservation = std::make_shared<QuotaReservation>(QuotaReservation{ classId, schoolId });
+	if (!reservation->grow(1))
+	{
+		reservation->release();
+		std::cerr << "Download " << url << " rejected: storage quota exceeded" << std::endl;
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+		recordFile(fileName.string());
+		if (callback) callback(false);
+		return;
+	}
+	httpFetcher.fetch(url, path, [self = *this, url, path, name = fileName.string(), callback, reservation](const FetchResult& result) mutable
 		{
-		case(FileFormats::TXT):
-			txtFile.push_back(fileInfo.getFileName().string());
-			break;
-		case(FileFormats::PIC):
-			picFile.push_back(fileInfo.getFileName().string());
-			break;
-		case(FileFormats::CODE):
-			codeFile.push_back(fileInfo.getFileName().string());
-			break;
-		case(FileFormats::OTHER):
-			otherFile.push_back(fileInfo.getFileName().string());
-			break;
-		default:
-			break;
-		}
-	}
-	if (cnt == 0)
-	{
-		//std::filesystem::remove_all(workPath);
-		return false;
-	}
-	std::ofstream out;
-	out.open(infoPath, std::ios::trunc);
-	out << autoIndex << std::endl << submitId << std::endl;
-	out << "__TXT__" << std::endl;
-	for (auto& iter : txtFile)
-	{
-		out << iter << " ";
-	}
-	out << std::endl << "__PIC__" << std::endl;
-	for (auto& iter : picFile)
-	{
-		out << iter << " ";
-	}
-	out << std::endl << "__CODE__" << std::endl;
-	for (auto& iter : codeFile)
+			if (result.status != FetchStatus::OK)
+			{
+				std::cerr << "Download " << url << " failed: " << result.error << std::endl;
+				std::error_code ec;
+				std::filesystem::remove(path, ec);
+			}
+			if (result.status == FetchStatus::OK) self.recordFile(name, result.sha256, result.bytes);
+			else self.recordFile(name);
+			reservation->release();
+			if (callback) callback(result.status == FetchStatus::OK);
+		}, quotaOptions(reservation));
+}
+
+bool File::save(long long submitId)
+{
+	unpack();
+	this->submitId = submitId;
+	std::lock_guard<std::mutex> lock(submission->mtx);
+	if (submission->submitId != submitId)
 	{
-		out << iter << " ";
+		submission->submitId = submitId;
+		submission->dirty = true;
 	}
-	out << std::endl << "__OHTER__" << std::endl;
-	for (auto& iter : otherFile)
+	flush();
+	return !submission->entries.empty();
+}
+
+std::string File::joinNames(bool (*match)(FileFormats), const char* separator)
+{
+	std::string result;
+	for (auto& entry : submission->entries)
 	{
-		out << iter << " ";
+		if (!match(entry.format)) continue;
+		if (!result.empty()) result += separator;
+		result += entry.name;
 	}
-	out.close();
-	return true;
+	return result;
 }
 
 std::string File::getFileList()
 {
-	int cnt = 0;
-	std::vector<std::string> txtFile, picFile, codeFile, otherFile;
-	for (auto& iter : std::filesystem::directory_iterator(workPath))
-	{
-		if (iter.path().filename().string() == ".info") continue;
-		cnt++;
-		FileInfo fileInfo(iter.path());
-		switch (fileInfo.getFileFormats())
-		{
-		case(FileFormats::TXT):
-			txtFile.push_back(fileInfo.getFileName().string());
-			break;
-		case(FileFormats::PIC):
-			picFile.push_back(fileInfo.getFileName().string());
-			break;
-		case(FileFormats::CODE):
-			codeFile.push_back(fileInfo.getFileName().string());
-			break;
-		case(FileFormats::OTHER):
-			otherFile.push_back(fileInfo.getFileName().string());
-			break;
-		default:
-			break;
-		}
-	}
-	if (cnt == 0)
-	{
-		std::filesystem::remove_all(workPath);
+	std::unique_lock<std::mutex> lock(submission->mtx);
+	if (submission->entries.empty())
+	{
+		lock.unlock();
+		//已归档的提交保留空目录，否则会重新读到归档中的文件
+		auto archive = ClassArchive::open(classId);
+		ClassArchive::Entry entry;
+		std::error_code ec;
+		if (!archive || !archive->find(archiveName(".info"), entry)) std::filesystem::remove_all(workPath, ec);
 		return u8"暂无文件";
 	}
 	std::string returnString;
+	std::string txtFile = joinNames([](FileFormats format) { return format == FileFormats::TXT; }, " ");
+	std::string picFile = joinNames([](FileFormats format) { return format == FileFormats::PIC; }, " ");
+	std::string codeFile = joinNames([](FileFormats format) { return format == FileFormats::CODE; }, " ");
+	std::string otherFile = joinNames([](FileFormats format) { return format == FileFormats::OTHER; }, " ");
 	if (txtFile.size() != 0)
 	{
-		returnString += u8"正文：\r\n";
-		for (auto& iter : txtFile)
-		{
-			returnString += (iter + " ");
-		}
+		returnString += u8"正文：\r\n" + txtFile + " ";
 	}
 	if (picFile.size() != 0)
 	{
-		returnString += u8"\r\n图片：\r\n";
-		for (auto& iter : picFile)
-		{
-			returnString += (iter + " ");
-		}
+		returnString += u8"\r\n图片：\r\n" + picFile + " ";
 	}
 	if (codeFile.size() != 0)
 	{
-		returnString += u8"\r\n代码：\r\n";
-		for (auto& iter : codeFile)
-		{
-			returnString += (iter + " ");
-		}
+		returnString += u8"\r\n代码：\r\n" + codeFile + " ";
 	}
 	
 	if (otherFile.size() != 0)
 	{
-		returnString += u8"\r\n其他附件：\r\n";
-		for (auto& iter : otherFile)
-		{
-			returnString += (iter + " ");
-		}
+		returnString += u8"\r\n其他附件：\r\n" + otherFile + " ";
 	}
 	return returnString;
 }
 
 std::string File::getFile(std::filesystem::path fileName)
 {
-	FileInfo file(workPath / fileName);
-	if (file.getFileFormats() == FileFormats::OTHER || file.getFileFormats() == FileFormats::PIC)
+	FileFormats format = FileInfo::formatOf(fileName);
+	if (format == FileFormats::OTHER || format == FileFormats::PIC)
 	{
 		return u8"该类型文件暂不支持在线查看";
 	}
-	std::ifstream in(file.getFilePath());
-	std::ostringstream tmp;
-	tmp << in.rdbuf();
-	return tmp.str();
+	//压缩存储的文件解压，旧文件原样读取；最近读取过的文件直接取缓存
+	FileLocation location = locate(fileName);
+	std::shared_ptr<const std::string> content = fileCache.get(location.path, location.offset, location.length);
+	if (!content) return u8"无法找到文件：" + fileName.u8string();
+	return *content;
 }
 
 std::string replace_all_distinct(std::string& str, const std::string& old_value, const std::string& new_value)
@@ -364,54 +692,208 @@ std::string replace_all_distinct(std::string& str, const std::string& old_value,
 	return   str;
 }
 
+unsigned long long File::getSize()
+{
+	std::lock_guard<std::mutex> lock(submission->mtx);
+	unsigned long long size = 0;
+	for (auto& entry : submission->entries) size += entry.size;
+	return size;
+}
+
+unsigned long long File::getQuotaRemaining()
+{
+	return storageQuota.remaining(classId, schoolId);
+}
+
 std::string File::getContentFile()
 {
-	std::string result;
-	for (auto& iter : std::filesystem::directory_iterator(workPath))
+	std::lock_guard<std::mutex> lock(submission->mtx);
+	return joinNames([](FileFormats format) { return format == FileFormats::TXT; }, "|");
+}
+std::string File::getAttachmentFile()
+{
+	std::lock_guard<std::mutex> lock(submission->mtx);
+	return joinNames([](FileFormats format) { return format != FileFormats::TXT; }, "|");
+}
+
+void File::delAll()
+{
+	unpack();
+	std::lock_guard<std::mutex> lock(submission->mtx);
+	for (auto& entry : submission->entries)
 	{
-		FileInfo fileInfo(iter.path());
-		if (fileInfo.getFileFormats() == FileFormats::TXT)
-		{
-			if (result == "")
-			{
-				result += (iter.path().filename()).string();
-			}
-			else
-				result += ('|'+(iter.path().filename()).string());
-		}
+		std::error_code ec;
+		std::filesystem::remove(workPath / entry.name, ec);
 	}
-	return result;
+	if (submission->entries.empty()) return;
+	std::vector<ManifestEntry> removed;
+	removed.swap(submission->entries);
+	submission->dirty = true;
+	flush();
+	unsigned long long size = 0;
+	for (auto& entry : removed)
+	{
+		size += entry.size;
+		blobs().release(entry.hash);
+	}
+	storageQuota.add(classId, schoolId, -(long long)size);
 }
-std::string File::getAttachmentFile()
+
+std::filesystem::path File::getFilePath(std::filesystem::path fileName)
 {
-	std::string result;
-	for (auto& iter : std::filesystem::directory_iterator(workPath))
+	return workPath / fileName;
+}
+
+FileLocation File::locate(std::filesystem::path fileName)
+{
+	FileLocation location;
+	location.path = workPath / fileName;
+	if (std::filesystem::exists(workPath)) return location;
+	auto archive = ClassArchive::open(classId);
+	ClassArchive::Entry entry;
+	if (archive && archive->find(archiveName(fileName.string()), entry))
+	{
+		location.path = archive->getPath();
+		location.offset = entry.offset;
+		location.length = entry.length;
+	}
+	return location;
+}
+
+void File::unpack()
+{
+	if (std::filesystem::exists(workPath)) return;
+	std::lock_guard<std::mutex> lock(submission->mtx);
+	if (std::filesystem::exists(workPath)) return;
+	try
+	{
+		create_directories(workPath);
+	}
+	catch (std::exception& e)
+	{
+		throw FileError(e.what());
+	}
+	auto archive = ClassArchive::open(classId);
+	std::vector<std::string> interned;
+	for (auto& entry : submission->entries)
 	{
-		FileInfo fileInfo(iter.path());
-		if (fileInfo.getFileFormats() != FileFormats::TXT)
+		std::filesystem::path path = workPath / entry.name;
+		ClassArchive::Entry item;
+		if (!archive || !archive->find(archiveName(entry.name), item) || !archive->extract(item, path))
 		{
-			if (iter.path().filename().string() == ".info") continue;
-			if (result == "")
-			{
-				result += (iter.path().filename()).string();
-			}
-			else
-				result += ('|' + (iter.path().filename()).string());
+			//放弃解出，归档中的提交仍然有效，不留下不完整的工作目录
+			std::error_code ec;
+			std::filesystem::remove_all(workPath, ec);
+			std::filesystem::remove(workPath.parent_path(), ec);
+			for (auto& hash : interned) blobs().release(hash);
+			throw FileError("cannot unpack file:" + path.string());
 		}
+		if (entry.size == 0) continue;
+		blobs().intern(path, entry.hash);
+		interned.push_back(entry.hash);
 	}
-	return result;
+	//工作目录存在后不再读取归档中的该提交，重新打包时以工作目录为准
+	submission->dirty = true;
+	flush();
 }
 
-void File::delAll()
+bool File::pack(ClassArchive::Writer& writer, std::string& info)
 {
-	for (auto& iter : std::filesystem::directory_iterator(workPath))
+	std::lock_guard<std::mutex> lock(submission->mtx);
+	flush();
+	if (submission->dirty) return false;
+	//下载中的.part、预留的图片与清单外的文件说明提交仍在变化
+	size_t count = 0;
+	std::error_code ec;
+	for (auto& item : std::filesystem::directory_iterator(workPath, ec))
+	{
+		std::string name = item.path().filename().string();
+		if (name == ".info") continue;
+		auto iter = submission->find(name);
+		if (iter == submission->entries.end() || submission->reserved.count(name) || !item.is_regular_file()) return false;
+		count++;
+	}
+	if (ec || count != submission->entries.size()) return false;
+
+	info = infoText();
+	for (auto& entry : submission->entries)
 	{
-		if (iter.path().filename().string() == ".info") continue;
-		std::filesystem::remove(iter);
+		if (!writer.add(archiveName(entry.name), workPath / entry.name, entry.hash)) throw FileError("cannot archive file:" + (workPath / entry.name).string());
 	}
+	if (!writer.addData(archiveName(".info"), info)) throw FileError("cannot archive file:" + infoPath.string());
+	return true;
 }
 
-std::filesystem::path File::getFilePath(std::filesystem::path fileName)
+void File::dropLoose(const std::string& info)
 {
-	return workPath / fileName;
-}
\ No newline at end of file
+	std::lock_guard<std::mutex> lock(submission->mtx);
+	if (submission->dirty || infoText() != info) return;
+	std::error_code ec;
+	size_t count = 0;
+	for (auto iter = std::filesystem::directory_iterator(workPath, ec); !ec && iter != std::filesystem::directory_iterator(); iter.increment(ec)) count++;
+	if (ec || count != submission->entries.size() + 1) return;
+	//先整体改名，读取时不会看到删除了一半的目录
+	std::filesystem::path dropPath = workPath;
+	dropPath += ".drop";
+	std::filesystem::rename(workPath, dropPath, ec);
+	if (ec) return;
+	for (auto& entry : submission->entries)
+	{
+		std::filesystem::remove(dropPath / entry.name, ec);
+		blobs().release(entry.hash);
+	}
+	std::filesystem::remove_all(dropPath, ec);
+	//学号目录为空时一并删除
+	std::filesystem::remove(workPath.parent_path(), ec);
+}
+
+void File::archiveClass(long long classId, std::function<void(size_t)> throttle)
+{
+	std::filesystem::path classPath = rootPath;
+	classPath /= std::to_string(classId);
+	std::vector<File> files;
+	std::error_code ec;
+	for (auto& student : std::filesystem::directory_iterator(classPath, ec))
+	{
+		if (!student.is_directory()) continue;
+		for (auto& homework : std::filesystem::directory_iterator(student.path(), ec))
+		{
+			if (!homework.is_directory()) continue;
+			//上次删除中断留下的目录，其中的提交已在归档中
+			if (homework.path().extension() == ".drop")
+			{
+				std::filesystem::remove_all(homework.path(), ec);
+				continue;
+			}
+			files.emplace_back(classId, std::atoll(student.path().filename().string().c_str()), std::atoll(homework.path().filename().string().c_str()));
+		}
+	}
+	if (files.empty()) return;
+
+	ClassArchive::Writer writer(ClassArchive::pathOf(classId), throttle);
+	auto archive = ClassArchive::open(classId);
+	if (archive)
+	{
+		//已归档且没有解出的提交原样复制
+		for (auto& item : archive->list(""))
+		{
+			if (std::filesystem::exists(classPath / std::filesystem::path(item.first).parent_path())) continue;
+			if (!writer.add(item.first, *archive, item.second)) throw FileError("cannot archive file:" + item.first);
+		}
+	}
+	std::vector<std::string> infos(files.size());
+	std::vector<bool> packed(files.size(), false);
+	bool changed = false;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		packed[i] = files[i].pack(writer, infos[i]);
+		changed = changed || packed[i];
+	}
+	if (!changed) return;
+	if (!writer.finish()) throw FileError("cannot write archive:" + ClassArchive::pathOf(classId).string());
+	//归档已完整写入，再删除工作目录
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (packed[i]) files[i].dropLoose(infos[i]);
+	}
+}
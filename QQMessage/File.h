@@ -1,9 +1,42 @@
 ﻿#pragma once
+#include <climits>
 #include <filesystem>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 #include "FileInfo.h"
 #include "Analyst.h"
+#include "ClassArchive.h"
+
+/// <summary>
+/// 提交清单中的一项
+/// </summary>
+struct ManifestEntry
+{
+	std::string name;
+	FileFormats format = FileFormats::OTHER;
+	unsigned long long size = 0;
+	/// <summary>
+	/// 内容SHA-256，即内容寻址存储中blob的文件名
+	/// </summary>
+	std::string hash;
+};
+
+/// <summary>
+/// 提交文件的存储位置，已归档的提交为班级归档中的一段
+/// </summary>
+struct FileLocation
+{
+	std::filesystem::path path;
+	unsigned long long offset = 0;
+	/// <summary>
+	/// 数据长度，未归档时到文件结尾
+	/// </summary>
+	unsigned long long length = ULLONG_MAX;
+};
 
 /// <summary>
 /// 文件管理类
@@ -27,15 +60,80 @@ private:
 	/// 班级id 学号 作业id 本次提交id
 	/// </summary>
 	long long classId, schoolId, homeworkId,submitId;
+	struct Submission;
+	/// <summary>
+	/// 缓存的提交目录数上限
+	/// </summary>
+	static constexpr size_t SUBMISSION_CACHE_SIZE = 1024;
+	/// <summary>
+	/// 自动编号、提交id与提交清单，按目录缓存，同一目录的File共享，首次打开时从.info读取
+	/// </summary>
+	std::shared_ptr<Submission> submission;
+	/// <param name="archivedInfo">提交已归档时为归档中的.info内容，不读取infoPath</param>
+	static std::shared_ptr<Submission> openSubmission(const std::filesystem::path& workPath, const std::filesystem::path& infoPath, const std::string* archivedInfo);
+	/// <summary>
+	/// 创建目录并打开共享状态，已归档的提交不创建目录
+	/// </summary>
+	void open();
+	/// <summary>
+	/// 提交在班级归档中的项名 学号/作业id/文件名
+	/// </summary>
+	std::string archiveName(const std::string& fileName);
+	/// <summary>
+	/// 提交已归档时将文件解出至工作目录，修改提交前调用，调用时不可持有submission的锁
+	/// <para>任一文件解出失败时删除工作目录并抛出FileError，提交仍以归档为准</para>
+	/// </summary>
+	void unpack();
+	/// <summary>
+	/// 将工作目录中的提交写入归档，有下载中或清单外的文件时跳过
+	/// </summary>
+	/// <param name="info">写入时的.info内容，删除工作目录前用于确认提交没有变化</param>
+	/// <returns>已写入归档返回true</returns>
+	bool pack(ClassArchive::Writer& writer, std::string& info);
+	/// <summary>
+	/// 归档完成后删除工作目录，提交在写入归档后有变化时保留
+	/// </summary>
+	void dropLoose(const std::string& info);
+	/// <summary>
+	/// 自动编号、提交id与清单的.info内容，调用时须持有submission的锁
+	/// </summary>
+	std::string infoText();
+	/// <summary>
+	/// 状态有变化时将自动编号、提交id与清单一次写入.info，调用时须持有submission的锁
+	/// </summary>
+	void flush();
+	/// <summary>
+	/// 新增或更新清单项，有变化时写入.info，调用时须持有submission的锁
+	/// </summary>
+	void record(const std::string& fileName, unsigned long long size, const std::string& hash);
+	/// <summary>
+	/// 按文件内容更新清单项并加入内容寻址存储，文件不存在时移除
+	/// </summary>
+	/// <param name="hash">已知的SHA-256，为空时读取文件计算</param>
+	/// <param name="size">已知的文件大小</param>
+	void recordFile(const std::string& fileName, std::string hash = "", unsigned long long size = 0);
+	/// <summary>
+	/// 移除清单项，有变化时写入.info，调用时须持有submission的锁
+	/// </summary>
+	void forget(const std::string& fileName);
 	/// <summary>
-	/// 工作目录所有文件
+	/// 按分类拼接清单中的文件名，调用时须持有submission的锁
 	/// </summary>
-	std::vector<FileInfo> fileList;
+	std::string joinNames(bool (*match)(FileFormats), const char* separator);
 	/// <summary>
-	/// 自动编号
+	/// 工作目录已有同名文件时加时间戳
 	/// </summary>
-	int autoIndex = 1;
+	std::filesystem::path uniqueName(std::filesystem::path fileName);
 public:
+	/// <summary>
+	/// 设置正文与代码文件是否压缩存储，默认关闭，已存储的文件不受影响，两种格式均可读取
+	/// </summary>
+	static void setTextCompression(bool enable);
+	/// <summary>
+	/// 将班级工作目录中的提交与已有归档合并为新的归档，然后删除已归档的工作目录
+	/// </summary>
+	/// <param name="throttle">每写入一段后调用，参数为该段字节数，用于限速</param>
+	static void archiveClass(long long classId, std::function<void(size_t)> throttle);
 	/// <summary>
 	/// 文件管理
 	/// </summary>
@@ -52,6 +150,12 @@ public:
 	/// <returns>文件名</returns>
 	std::string storeText(std::string data);
 	/// <summary>
+	/// 追加文字到已有文件，另起一行
+	/// </summary>
+	/// <param name="fileName">文件名</param>
+	/// <param name="data">utf8文字信息</param>
+	void appendText(std::filesystem::path fileName, std::string data);
+	/// <summary>
 	/// 删除文件
 	/// </summary>
 	/// <param name="fileName">文件名</param>
@@ -61,8 +165,17 @@ public:
 	/// </summary>
 	/// <param name="url">下载地址</param>
 	/// <param name="fileName">保存文件名</param>
+	/// <param name="expectedSize">上报的文件大小，开始下载前按其预留配额，未知时为0</param>
 	/// <returns>文件名</returns>
-	std::string downFile(std::string url, std::filesystem::path fileName);
+	std::string downFile(std::string url, std::filesystem::path fileName, unsigned long long expectedSize = 0);
+	/// <summary>
+	/// 异步下载文件，不阻塞当前线程
+	/// </summary>
+	/// <param name="url">下载地址</param>
+	/// <param name="fileName">保存文件名</param>
+	/// <param name="callback">完成后在下载线程中执行，参数为文件名，失败时为空</param>
+	/// <param name="expectedSize">上报的文件大小，开始下载前按其预留配额，未知时为0</param>
+	void downFileAsync(std::string url, std::filesystem::path fileName, std::function<void(std::string)> callback, unsigned long long expectedSize = 0);
 	/// <summary>
 	/// 存储图片，使用自动编号
 	/// </summary>
@@ -70,6 +183,18 @@ public:
 	/// <returns>文件名</returns>
 	std::string storePic(std::string url);
 	/// <summary>
+	/// 预留图片文件名，创建空文件占位，避免并发下载时重名
+	/// </summary>
+	/// <returns>文件名</returns>
+	std::string reservePic();
+	/// <summary>
+	/// 异步下载至已预留的文件，失败时删除占位文件
+	/// </summary>
+	/// <param name="url">下载地址</param>
+	/// <param name="fileName">reservePic返回的文件名</param>
+	/// <param name="callback">完成后在下载线程中执行，参数为是否成功</param>
+	void downReserved(std::string url, std::filesystem::path fileName, std::function<void(bool)> callback);
+	/// <summary>
 	/// 本地保存文件
 	/// </summary>
 	/// <returns>保存结果</returns>
@@ -91,6 +216,16 @@ public:
 	/// <returns></returns>
 	long long getSubmitId();
 	/// <summary>
+	/// 本次提交占用的存储空间，即清单中文件大小之和
+	/// </summary>
+	/// <returns>字节数</returns>
+	unsigned long long getSize();
+	/// <summary>
+	/// 学生与班级存储配额中较小的剩余量
+	/// </summary>
+	/// <returns>字节数，不限时为ULLONG_MAX</returns>
+	unsigned long long getQuotaRemaining();
+	/// <summary>
 	/// 获取正文文件名 | 分隔
 	/// </summary>
 	/// <returns></returns>
@@ -105,5 +240,9 @@ public:
 	/// </summary>
 	void delAll();
 	std::filesystem::path getFilePath(std::filesystem::path fileName);
+	/// <summary>
+	/// 读取文件的位置，工作目录不存在时从班级归档中查找
+	/// </summary>
+	FileLocation locate(std::filesystem::path fileName);
 };
 
@@ -0,0 +1,76 @@
+﻿#include "FileCache.h"
+#include "TextCompressor.h"
+
+FileCache::FileCache(size_t maxBytes, size_t maxEntries, size_t maxFileSize) :
+	maxBytes(maxBytes), maxEntries(maxEntries), maxFileSize(maxFileSize), bytes(0), hits(0), misses(0)
+{}
+
+std::shared_ptr<const std::string> FileCache::get(const std::filesystem::path& path, unsigned long long offset, unsigned long long length)
+{
+	std::string key = path.string();
+	if (length != ULLONG_MAX) key += "#" + std::to_string(offset);
+	std::error_code ec;
+	//归档中的项以归档的修改时间与项的长度作为版本，归档重写后失效
+	std::filesystem::file_time_type mtime = std::filesystem::last_write_time(path, ec);
+	unsigned long long diskSize = ec ? 0 : std::filesystem::file_size(path, ec);
+	if (length != ULLONG_MAX) diskSize = length;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		auto iter = entries.find(key);
+		if (iter != entries.end())
+		{
+			if (!ec && iter->second.mtime == mtime && iter->second.diskSize == diskSize)
+			{
+				hits++;
+				recent.splice(recent.begin(), recent, iter->second.lru);
+				return iter->second.content;
+			}
+			//文件已改写或删除
+			erase(iter);
+		}
+		misses++;
+	}
+	if (ec) return nullptr;
+
+	//在锁外读取，不阻塞其他文件的命中
+	auto content = std::make_shared<std::string>();
+	if (!TextCompressor::readFile(path, *content, offset, length)) return nullptr;
+	if (content->size() > maxFileSize) return content;
+
+	std::lock_guard<std::mutex> lock(mtx);
+	auto iter = entries.find(key);
+	if (iter != entries.end()) erase(iter);
+	recent.push_front(key);
+	entries[key] = Entry{ mtime, diskSize, content, recent.begin() };
+	bytes += content->size();
+	while (!recent.empty() && (bytes > maxBytes || entries.size() > maxEntries))
+	{
+		erase(entries.find(recent.back()));
+	}
+	return content;
+}
+
+void FileCache::erase(std::unordered_map<std::string, Entry>::iterator iter)
+{
+	bytes -= iter->second.content->size();
+	recent.erase(iter->second.lru);
+	entries.erase(iter);
+}
+
+size_t FileCache::getMaxFileSize() const
+{
+	return maxFileSize;
+}
+
+FileCacheMetrics FileCache::getMetrics()
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	FileCacheMetrics metrics;
+	metrics.hits = hits;
+	metrics.misses = misses;
+	metrics.entries = entries.size();
+	metrics.bytes = bytes;
+	metrics.maxEntries = maxEntries;
+	metrics.maxBytes = maxBytes;
+	return metrics;
+}
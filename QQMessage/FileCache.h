@@ -0,0 +1,84 @@
+﻿#pragma once
+#include <climits>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/// <summary>
+/// 文件缓存统计
+/// </summary>
+struct FileCacheMetrics
+{
+	unsigned long long hits = 0;
+	unsigned long long misses = 0;
+	/// <summary>
+	/// 缓存的文件数
+	/// </summary>
+	size_t entries = 0;
+	/// <summary>
+	/// 缓存内容占用的字节数
+	/// </summary>
+	size_t bytes = 0;
+	size_t maxEntries = 0;
+	size_t maxBytes = 0;
+};
+
+/// <summary>
+/// 提交文件读取缓存
+/// <para>教师批改时同一提交的正文会被反复获取，按路径缓存解压后的内容，以修改时间与磁盘大小作为版本，文件改写后自动失效</para>
+/// <para>按最近使用淘汰，同时限制文件数与总字节数；超过单文件上限的文件不缓存</para>
+/// </summary>
+class FileCache
+{
+public:
+	/// <param name="maxBytes">缓存内容总字节数上限</param>
+	/// <param name="maxEntries">缓存文件数上限</param>
+	/// <param name="maxFileSize">可缓存的单个文件（解压后）字节数上限</param>
+	FileCache(size_t maxBytes, size_t maxEntries, size_t maxFileSize);
+	/// <summary>
+	/// 读取文件，压缩存储的文件返回解压后的内容
+	/// </summary>
+	/// <param name="offset">数据在文件中的起始位置，读取归档中的一项时使用</param>
+	/// <param name="length">数据长度，默认到文件结尾</param>
+	/// <returns>文件内容，在缓存淘汰后仍然有效；文件不存在或数据损坏时为空</returns>
+	std::shared_ptr<const std::string> get(const std::filesystem::path& path, unsigned long long offset = 0, unsigned long long length = ULLONG_MAX);
+	/// <summary>
+	/// 可缓存的单个文件字节数上限，更大的文件应分块读取
+	/// </summary>
+	size_t getMaxFileSize() const;
+	FileCacheMetrics getMetrics();
+private:
+	struct Entry
+	{
+		std::filesystem::file_time_type mtime;
+		unsigned long long diskSize;
+		std::shared_ptr<const std::string> content;
+		/// <summary>
+		/// 在最近使用列表中的位置
+		/// </summary>
+		std::list<std::string>::iterator lru;
+	};
+	/// <summary>
+	/// 移除一项，调用时须持有锁
+	/// </summary>
+	void erase(std::unordered_map<std::string, Entry>::iterator iter);
+
+	const size_t maxBytes;
+	const size_t maxEntries;
+	const size_t maxFileSize;
+	std::mutex mtx;
+	/// <summary>
+	/// 缓存的文件【路径（归档中的项附加位置），内容】
+	/// </summary>
+	std::unordered_map<std::string, Entry> entries;
+	/// <summary>
+	/// 路径，最近使用的在前
+	/// </summary>
+	std::list<std::string> recent;
+	size_t bytes;
+	unsigned long long hits;
+	unsigned long long misses;
+};
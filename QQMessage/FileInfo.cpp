@@ -2,21 +2,47 @@
 #include <string>
 #include <iostream>
 #include <algorithm>
+#include <unordered_map>
 
 FileInfo::FileInfo(std::filesystem::path filePath)
 {
 	this->filePath = filePath;
 	fileName = filePath.filename();
-	std::string fileExt = fileName.string().substr(fileName.string().find_last_of(".") + 1);
-	std::transform(fileExt.begin(), fileExt.end(), fileExt.begin(), tolower);
-	if (fileExt == "txt")
-		fileFormats = FileFormats::TXT;
-	else if (fileExt == "bmp" || fileExt == "jpg" || fileExt == "jpeg" || fileExt == "png" || fileExt == "gif" || fileExt == "webp")
-		fileFormats = FileFormats::PIC;
-	else if (fileExt == "h" || fileExt == "hpp" || fileExt == "hxx" || fileExt == "c" || fileExt == "cpp" || fileExt == "c++" || fileExt == "c" || fileExt == "cxx")
-		fileFormats = FileFormats::CODE;
-	else
-		fileFormats = FileFormats::OTHER;
+	fileFormats = formatOf(fileName);
+}
+
+FileFormats FileInfo::formatOf(const std::filesystem::path& fileName)
+{
+	static const std::unordered_map<std::string, FileFormats> formats = {
+		{ "txt", FileFormats::TXT },
+		{ "bmp", FileFormats::PIC }, { "jpg", FileFormats::PIC }, { "jpeg", FileFormats::PIC }, { "png", FileFormats::PIC }, { "gif", FileFormats::PIC }, { "webp", FileFormats::PIC },
+		{ "h", FileFormats::CODE }, { "hpp", FileFormats::CODE }, { "hxx", FileFormats::CODE }, { "c", FileFormats::CODE }, { "cpp", FileFormats::CODE }, { "c++", FileFormats::CODE }, { "cxx", FileFormats::CODE }
+	};
+	std::string name = fileName.string();
+	std::string fileExt = name.substr(name.find_last_of(".") + 1);
+	std::transform(fileExt.begin(), fileExt.end(), fileExt.begin(), [](unsigned char c) { return (char)tolower(c); });
+	auto iter = formats.find(fileExt);
+	return iter == formats.end() ? FileFormats::OTHER : iter->second;
+}
+
+const char* FileInfo::formatName(FileFormats format)
+{
+	switch (format)
+	{
+	case FileFormats::TXT: return "TXT";
+	case FileFormats::PIC: return "PIC";
+	case FileFormats::CODE: return "CODE";
+	default: return "OTHER";
+	}
+}
+
+FileFormats FileInfo::parseFormat(const std::string& name)
+{
+	for (FileFormats format : { FileFormats::TXT, FileFormats::PIC, FileFormats::CODE })
+	{
+		if (name == formatName(format)) return format;
+	}
+	return FileFormats::OTHER;
 }
 
 FileFormats FileInfo::getFileFormats()
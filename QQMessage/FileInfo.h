@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include <filesystem>
+#include <string>
 
 enum class FileFormats
 {
@@ -21,5 +22,14 @@ public:
 	std::filesystem::path getFilePath();
 	std::filesystem::path getFileName();
 	FileFormats getFileFormats();
+	/// <summary>
+	/// 按扩展名分类，不区分大小写
+	/// </summary>
+	static FileFormats formatOf(const std::filesystem::path& fileName);
+	/// <summary>
+	/// 分类在.info中的名称
+	/// </summary>
+	static const char* formatName(FileFormats format);
+	static FileFormats parseFormat(const std::string& name);
 };
 
@@ -0,0 +1,732 @@
+﻿#include "HttpFetcher.h"
+#include "Sha256.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+
+namespace
+{
+	/// <summary>
+	/// 响应头的最大长度
+	/// </summary>
+	const size_t MAX_HEADER_SIZE = 64 * 1024;
+
+	std::string toLower(std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		return text;
+	}
+
+	std::string trim(const std::string& text)
+	{
+		size_t begin = text.find_first_not_of(" \t");
+		if (begin == std::string::npos) return "";
+		size_t end = text.find_last_not_of(" \t\r");
+		return text.substr(begin, end - begin + 1);
+	}
+}
+
+struct HttpFetcher::Connection
+{
+	explicit Connection(asio::io_context& io) : socket(io) {}
+	std::string key;
+	asio::ip::tcp::socket socket;
+#ifdef HTTPFETCHER_SSL
+	std::unique_ptr<asio::ssl::stream<asio::ip::tcp::socket&>> tls;
+#endif
+	std::chrono::steady_clock::time_point idleSince;
+
+	template<typename Buffer, typename Handler>
+	void read(const Buffer& buffer, Handler&& handler)
+	{
+#ifdef HTTPFETCHER_SSL
+		if (tls)
+		{
+			tls->async_read_some(buffer, std::forward<Handler>(handler));
+			return;
+		}
+#endif
+		socket.async_read_some(buffer, std::forward<Handler>(handler));
+	}
+
+	template<typename Buffer, typename Handler>
+	void write(const Buffer& buffer, Handler&& handler)
+	{
+#ifdef HTTPFETCHER_SSL
+		if (tls)
+		{
+			asio::async_write(*tls, buffer, std::forward<Handler>(handler));
+			return;
+		}
+#endif
+		asio::async_write(socket, buffer, std::forward<Handler>(handler));
+	}
+
+	void close()
+	{
+		asio::error_code ignored;
+		socket.shutdown(asio::ip::tcp::socket::shutdown_both, ignored);
+		socket.close(ignored);
+	}
+};
+
+struct HttpFetcher::Transfer
+{
+	explicit Transfer(asio::io_context& io) : strand(asio::make_strand(io)), timer(io), resolver(io) {}
+	std::string url;
+	Url target;
+	std::filesystem::path path;
+	std::filesystem::path partPath;
+	FetchCallback callback;
+	FetchOptions options;
+
+	asio::strand<asio::io_context::executor_type> strand;
+	asio::steady_timer timer;
+	asio::ip::tcp::resolver resolver;
+	std::shared_ptr<Connection> connection;
+	std::ofstream out;
+	Sha256 sha;
+	std::array<char, 16384> buffer;
+
+	bool started = false;
+	bool done = false;
+	bool timedOut = false;
+	/// <summary>
+	/// 当前连接取自空闲连接
+	/// </summary>
+	bool reused = false;
+	bool retried = false;
+	int redirects = 0;
+
+	//当前响应
+	std::string request;
+	std::string header;
+	bool responded = false;
+	int httpStatus = 0;
+	bool keepAlive = true;
+	bool chunked = false;
+	long long contentLength = -1;
+	unsigned long long received = 0;
+	/// <summary>
+	/// consume中出现的错误，OK表示无错误
+	/// </summary>
+	FetchStatus abort = FetchStatus::OK;
+	std::string abortError;
+
+	//chunked解析状态
+	enum class Chunk { SIZE, DATA, DATA_END, TRAILER } chunk = Chunk::SIZE;
+	unsigned long long chunkLeft = 0;
+	std::string line;
+};
+
+std::string HttpFetcher::Url::key() const
+{
+	return (https ? "https://" : "http://") + host + ":" + port;
+}
+
+HttpFetcher::HttpFetcher(int threads, size_t maxConcurrent) :
+	maxConcurrent(std::max<size_t>(maxConcurrent, 1)), active(0), stopping(false)
+{
+#ifdef HTTPFETCHER_SSL
+	tls = std::make_unique<asio::ssl::context>(asio::ssl::context::tls_client);
+	tls->set_default_verify_paths();
+	tls->set_verify_mode(asio::ssl::verify_peer);
+#endif
+	work = std::make_unique<asio::executor_work_guard<asio::io_context::executor_type>>(io.get_executor());
+	for (int i = 0; i < std::max(threads, 1); i++)
+	{
+		workers.emplace_back([this] { io.run(); });
+	}
+}
+
+HttpFetcher::~HttpFetcher()
+{
+	std::deque<std::shared_ptr<Transfer>> queued;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		stopping = true;
+		queued.swap(pending);
+	}
+	for (auto& transfer : queued)
+	{
+		if (!transfer->callback) continue;
+		FetchResult result;
+		result.path = transfer->path;
+		result.error = "fetcher stopped";
+		try
+		{
+			transfer->callback(result);
+		}
+		catch (...) {}
+	}
+	work.reset();
+	io.stop();
+	for (auto& worker : workers)
+	{
+		if (worker.joinable()) worker.join();
+	}
+	std::lock_guard<std::mutex> lock(mtx);
+	for (auto& iter : idle)
+	{
+		for (auto& connection : iter.second) connection->close();
+	}
+	idle.clear();
+}
+
+void HttpFetcher::fetch(std::string url, std::filesystem::path path, FetchCallback callback, FetchOptions options)
+{
+	auto transfer = std::make_shared<Transfer>(io);
+	transfer->url = std::move(url);
+	transfer->path = std::move(path);
+	transfer->partPath = transfer->path;
+	transfer->partPath += ".part";
+	transfer->callback = std::move(callback);
+	transfer->options = options;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		pending.push_back(transfer);
+	}
+	pump();
+}
+
+std::future<FetchResult> HttpFetcher::fetchAsync(std::string url, std::filesystem::path path, FetchOptions options)
+{
+	auto promise = std::make_shared<std::promise<FetchResult>>();
+	std::future<FetchResult> future = promise->get_future();
+	fetch(std::move(url), std::move(path), [promise](const FetchResult& result) { promise->set_value(result); }, options);
+	return future;
+}
+
+size_t HttpFetcher::idleConnections()
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	size_t count = 0;
+	for (auto& iter : idle) count += iter.second.size();
+	return count;
+}
+
+bool HttpFetcher::parseUrl(const std::string& url, Url& result)
+{
+	size_t hostBegin;
+	if (url.compare(0, 7, "http://") == 0)
+	{
+		result.https = false;
+		hostBegin = 7;
+	}
+	else if (url.compare(0, 8, "https://") == 0)
+	{
+		result.https = true;
+		hostBegin = 8;
+	}
+	else return false;
+
+	size_t pathBegin = url.find_first_of("/?#", hostBegin);
+	std::string authority = url.substr(hostBegin, pathBegin == std::string::npos ? std::string::npos : pathBegin - hostBegin);
+	//去掉用户信息
+	size_t at = authority.rfind('@');
+	if (at != std::string::npos) authority = authority.substr(at + 1);
+	size_t colon = authority.rfind(':');
+	if (colon != std::string::npos && authority.find(']', colon) == std::string::npos)
+	{
+		result.host = authority.substr(0, colon);
+		result.port = authority.substr(colon + 1);
+	}
+	else
+	{
+		result.host = authority;
+		result.port = result.https ? "443" : "80";
+	}
+	if (result.host.size() > 2 && result.host.front() == '[' && result.host.back() == ']') result.host = result.host.substr(1, result.host.size() - 2);
+	if (result.host.empty() || result.port.empty() || result.port.find_first_not_of("0123456789") != std::string::npos) return false;
+
+	result.target = pathBegin == std::string::npos ? "/" : url.substr(pathBegin);
+	size_t fragment = result.target.find('#');
+	if (fragment != std::string::npos) result.target.resize(fragment);
+	if (result.target.empty() || result.target[0] != '/') result.target = "/" + result.target;
+	return true;
+}
+
+void HttpFetcher::pump()
+{
+	std::vector<std::shared_ptr<Transfer>> ready;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		if (stopping) return;
+		while (active < maxConcurrent && !pending.empty())
+		{
+			ready.push_back(pending.front());
+			pending.pop_front();
+			active++;
+		}
+	}
+	for (auto& transfer : ready)
+	{
+		asio::post(transfer->strand, [this, transfer] { begin(transfer); });
+	}
+}
+
+void HttpFetcher::begin(std::shared_ptr<Transfer> transfer)
+{
+	if (!transfer->started)
+	{
+		transfer->started = true;
+		transfer->timer.expires_after(std::chrono::milliseconds(transfer->options.timeoutMs));
+		transfer->timer.async_wait(asio::bind_executor(transfer->strand, [transfer](const asio::error_code& ec)
+			{
+				if (ec || transfer->done) return;
+				//关闭连接使进行中的读写以错误返回
+				transfer->timedOut = true;
+				transfer->resolver.cancel();
+				if (transfer->connection) transfer->connection->close();
+			}));
+		if (!parseUrl(transfer->url, transfer->target))
+		{
+			finish(transfer, FetchStatus::FAILED, "invalid url: " + transfer->url);
+			return;
+		}
+	}
+#ifndef HTTPFETCHER_SSL
+	if (transfer->target.https)
+	{
+		finish(transfer, FetchStatus::FAILED, "https is not supported in this build");
+		return;
+	}
+#endif
+	std::error_code fsError;
+	if (transfer->path.has_parent_path()) std::filesystem::create_directories(transfer->path.parent_path(), fsError);
+	if (transfer->out.is_open()) transfer->out.close();
+	transfer->out.open(transfer->partPath, std::ios::binary | std::ios::trunc);
+	transfer->sha = Sha256();
+	if (!transfer->out)
+	{
+		finish(transfer, FetchStatus::FAILED, "cannot open " + transfer->partPath.string());
+		return;
+	}
+
+	transfer->connection = acquire(transfer->target.key());
+	transfer->reused = transfer->connection != nullptr;
+	if (transfer->reused) sendRequest(transfer);
+	else connect(transfer);
+}
+
+void HttpFetcher::connect(std::shared_ptr<Transfer> transfer)
+{
+	transfer->resolver.async_resolve(transfer->target.host, transfer->target.port, asio::bind_executor(transfer->strand,
+		[this, transfer](const asio::error_code& ec, asio::ip::tcp::resolver::results_type results)
+		{
+			if (ec)
+			{
+				fail(transfer, ec, "resolve");
+				return;
+			}
+			transfer->connection = std::make_shared<Connection>(io);
+			transfer->connection->key = transfer->target.key();
+			asio::async_connect(transfer->connection->socket, results, asio::bind_executor(transfer->strand,
+				[this, transfer](const asio::error_code& ec, const asio::ip::tcp::endpoint&)
+				{
+					if (ec)
+					{
+						fail(transfer, ec, "connect");
+						return;
+					}
+					if (transfer->target.https) handshake(transfer);
+					else sendRequest(transfer);
+				}));
+		}));
+}
+
+void HttpFetcher::handshake(std::shared_ptr<Transfer> transfer)
+{
+#ifdef HTTPFETCHER_SSL
+	auto& connection = *transfer->connection;
+	connection.tls = std::make_unique<asio::ssl::stream<asio::ip::tcp::socket&>>(connection.socket, *tls);
+	SSL_set_tlsext_host_name(connection.tls->native_handle(), transfer->target.host.c_str());
+	connection.tls->set_verify_callback(asio::ssl::host_name_verification(transfer->target.host));
+	connection.tls->async_handshake(asio::ssl::stream_base::client, asio::bind_executor(transfer->strand,
+		[this, transfer](const asio::error_code& ec)
+		{
+			if (ec)
+			{
+				fail(transfer, ec, "handshake");
+				return;
+			}
+			sendRequest(transfer);
+		}));
+#else
+	finish(transfer, FetchStatus::FAILED, "https is not supported in this build");
+#endif
+}
+
+void HttpFetcher::sendRequest(std::shared_ptr<Transfer> transfer)
+{
+	const Url& target = transfer->target;
+	transfer->header.clear();
+	transfer->responded = false;
+	transfer->httpStatus = 0;
+	transfer->keepAlive = true;
+	transfer->chunked = false;
+	transfer->contentLength = -1;
+	transfer->received = 0;
+	transfer->chunk = Transfer::Chunk::SIZE;
+	transfer->chunkLeft = 0;
+	transfer->line.clear();
+
+	std::string host = target.host.find(':') != std::string::npos ? "[" + target.host + "]" : target.host;
+	if (target.port != (target.https ? "443" : "80")) host += ":" + target.port;
+	transfer->request = "GET " + target.target + " HTTP/1.1\r\nHost: " + host +
+		"\r\nUser-Agent: HomeworkChecker\r\nAccept: */*\r\nAccept-Encoding: identity\r\nConnection: keep-alive\r\n\r\n";
+	transfer->connection->write(asio::buffer(transfer->request), asio::bind_executor(transfer->strand,
+		[this, transfer](const asio::error_code& ec, size_t)
+		{
+			if (ec)
+			{
+				fail(transfer, ec, "write");
+				return;
+			}
+			readHeader(transfer);
+		}));
+}
+
+void HttpFetcher::readHeader(std::shared_ptr<Transfer> transfer)
+{
+	transfer->connection->read(asio::buffer(transfer->buffer), asio::bind_executor(transfer->strand,
+		[this, transfer](const asio::error_code& ec, size_t size)
+		{
+			if (ec)
+			{
+				fail(transfer, ec, "read header");
+				return;
+			}
+			transfer->responded = true;
+			size_t searchFrom = transfer->header.size() < 3 ? 0 : transfer->header.size() - 3;
+			transfer->header.append(transfer->buffer.data(), size);
+			size_t end = transfer->header.find("\r\n\r\n", searchFrom);
+			if (end == std::string::npos)
+			{
+				if (transfer->header.size() > MAX_HEADER_SIZE) finish(transfer, FetchStatus::FAILED, "response header too large");
+				else readHeader(transfer);
+				return;
+			}
+			std::string leftover = transfer->header.substr(end + 4);
+			transfer->header.resize(end + 2);
+			onHeader(transfer, std::move(leftover));
+		}));
+}
+
+void HttpFetcher::onHeader(std::shared_ptr<Transfer> transfer, std::string leftover)
+{
+	const std::string& header = transfer->header;
+	//状态行 HTTP/1.1 200 OK
+	size_t lineEnd = header.find("\r\n");
+	std::string statusLine = header.substr(0, lineEnd);
+	size_t space = statusLine.find(' ');
+	if (statusLine.compare(0, 5, "HTTP/") != 0 || space == std::string::npos)
+	{
+		finish(transfer, FetchStatus::FAILED, "malformed response");
+		return;
+	}
+	transfer->httpStatus = std::atoi(statusLine.c_str() + space + 1);
+	transfer->keepAlive = statusLine.compare(0, 8, "HTTP/1.0") != 0;
+
+	std::string location;
+	for (size_t pos = lineEnd + 2; pos < header.size();)
+	{
+		size_t next = header.find("\r\n", pos);
+		if (next == std::string::npos) next = header.size();
+		std::string field = header.substr(pos, next - pos);
+		pos = next + 2;
+		size_t colon = field.find(':');
+		if (colon == std::string::npos) continue;
+		std::string name = toLower(trim(field.substr(0, colon)));
+		std::string value = trim(field.substr(colon + 1));
+		if (name == "content-length") transfer->contentLength = std::atoll(value.c_str());
+		else if (name == "transfer-encoding") transfer->chunked = toLower(value).find("chunked") != std::string::npos;
+		else if (name == "connection")
+		{
+			std::string lower = toLower(value);
+			if (lower.find("close") != std::string::npos) transfer->keepAlive = false;
+			else if (lower.find("keep-alive") != std::string::npos) transfer->keepAlive = true;
+		}
+		else if (name == "location") location = value;
+	}
+	if (transfer->chunked) transfer->contentLength = -1;
+
+	int status = transfer->httpStatus;
+	if ((status == 301 || status == 302 || status == 303 || status == 307 || status == 308) && !location.empty())
+	{
+		if (transfer->redirects >= transfer->options.maxRedirects)
+		{
+			finish(transfer, FetchStatus::FAILED, "too many redirects");
+			return;
+		}
+		transfer->redirects++;
+		//相对地址按当前主机补全
+		if (location.compare(0, 2, "//") == 0) location = (transfer->target.https ? "https:" : "http:") + location;
+		else if (location[0] == '/') location = (transfer->target.https ? "https://" : "http://") + transfer->target.host + ":" + transfer->target.port + location;
+		if (!parseUrl(location, transfer->target))
+		{
+			finish(transfer, FetchStatus::FAILED, "invalid redirect: " + location);
+			return;
+		}
+		transfer->connection->close();
+		transfer->connection.reset();
+		transfer->retried = false;
+		begin(transfer);
+		return;
+	}
+	if (status != 200)
+	{
+		transfer->keepAlive = false;
+		finish(transfer, FetchStatus::FAILED, "http " + std::to_string(status));
+		return;
+	}
+	if (transfer->contentLength >= 0 && (unsigned long long)transfer->contentLength > transfer->options.maxBytes)
+	{
+		transfer->keepAlive = false;
+		finish(transfer, FetchStatus::TOO_LARGE, "content length " + std::to_string(transfer->contentLength));
+		return;
+	}
+	if (transfer->contentLength >= 0 && transfer->options.admit && !transfer->options.admit((unsigned long long)transfer->contentLength))
+	{
+		transfer->keepAlive = false;
+		finish(transfer, FetchStatus::TOO_LARGE, "content length " + std::to_string(transfer->contentLength) + " not admitted");
+		return;
+	}
+	//既无长度也非chunked时读到连接关闭为止
+	if (!transfer->chunked && transfer->contentLength < 0) transfer->keepAlive = false;
+
+	bool complete = transfer->contentLength == 0 || consume(transfer, leftover.data(), leftover.size());
+	if (transfer->abort != FetchStatus::OK) finish(transfer, transfer->abort, transfer->abortError);
+	else if (complete) finish(transfer, FetchStatus::OK, "");
+	else readBody(transfer);
+}
+
+void HttpFetcher::readBody(std::shared_ptr<Transfer> transfer)
+{
+	transfer->connection->read(asio::buffer(transfer->buffer), asio::bind_executor(transfer->strand,
+		[this, transfer](const asio::error_code& ec, size_t size)
+		{
+			if (ec)
+			{
+				if (ec == asio::error::eof && !transfer->chunked && transfer->contentLength < 0 && !transfer->timedOut)
+				{
+					finish(transfer, FetchStatus::OK, "");
+					return;
+				}
+				fail(transfer, ec, "read body");
+				return;
+			}
+			bool complete = consume(transfer, transfer->buffer.data(), size);
+			if (transfer->abort != FetchStatus::OK) finish(transfer, transfer->abort, transfer->abortError);
+			else if (complete) finish(transfer, FetchStatus::OK, "");
+			else readBody(transfer);
+		}));
+}
+
+bool HttpFetcher::consume(std::shared_ptr<Transfer> transfer, const char* data, size_t size)
+{
+	auto write = [&transfer](const char* data, size_t size)
+	{
+		if (transfer->received + size > transfer->options.maxBytes)
+		{
+			transfer->abort = FetchStatus::TOO_LARGE;
+			transfer->abortError = "body exceeds " + std::to_string(transfer->options.maxBytes) + " bytes";
+			return false;
+		}
+		if (transfer->contentLength < 0 && transfer->options.admit && !transfer->options.admit(transfer->received + size))
+		{
+			transfer->abort = FetchStatus::TOO_LARGE;
+			transfer->abortError = "body of " + std::to_string(transfer->received + size) + " bytes not admitted";
+			return false;
+		}
+		transfer->out.write(data, size);
+		transfer->sha.update(data, size);
+		if (!transfer->out)
+		{
+			transfer->abort = FetchStatus::FAILED;
+			transfer->abortError = "cannot write " + transfer->partPath.string();
+			return false;
+		}
+		transfer->received += size;
+		return true;
+	};
+
+	if (!transfer->chunked)
+	{
+		if (transfer->contentLength >= 0)
+		{
+			unsigned long long left = (unsigned long long)transfer->contentLength - transfer->received;
+			//多出的数据不属于本响应，连接不再复用
+			if (size > left)
+			{
+				size = (size_t)left;
+				transfer->keepAlive = false;
+			}
+		}
+		if (size > 0 && !write(data, size)) return false;
+		return transfer->contentLength >= 0 && transfer->received == (unsigned long long)transfer->contentLength;
+	}
+
+	const char* end = data + size;
+	while (data < end)
+	{
+		switch (transfer->chunk)
+		{
+		case Transfer::Chunk::DATA:
+		{
+			size_t take = (size_t)std::min<unsigned long long>(transfer->chunkLeft, end - data);
+			if (!write(data, take)) return false;
+			data += take;
+			transfer->chunkLeft -= take;
+			if (transfer->chunkLeft == 0) transfer->chunk = Transfer::Chunk::DATA_END;
+			break;
+		}
+		default:
+		{
+			//逐行读取块大小、块结尾与trailer
+			const char* newline = std::find(data, end, '\n');
+			transfer->line.append(data, newline);
+			if (newline == end)
+			{
+				data = end;
+				if (transfer->line.size() > MAX_HEADER_SIZE)
+				{
+					transfer->abort = FetchStatus::FAILED;
+					transfer->abortError = "malformed chunked body";
+				}
+				return false;
+			}
+			data = newline + 1;
+			std::string line = trim(transfer->line);
+			transfer->line.clear();
+			if (transfer->chunk == Transfer::Chunk::SIZE)
+			{
+				if (line.empty() || !std::isxdigit((unsigned char)line[0]))
+				{
+					transfer->abort = FetchStatus::FAILED;
+					transfer->abortError = "malformed chunked body";
+					return false;
+				}
+				transfer->chunkLeft = std::strtoull(line.c_str(), nullptr, 16);
+				transfer->chunk = transfer->chunkLeft == 0 ? Transfer::Chunk::TRAILER : Transfer::Chunk::DATA;
+			}
+			else if (transfer->chunk == Transfer::Chunk::DATA_END)
+			{
+				transfer->chunk = Transfer::Chunk::SIZE;
+			}
+			else if (line.empty())
+			{
+				//trailer后的空行，多出的数据不属于本响应
+				if (data != end) transfer->keepAlive = false;
+				return true;
+			}
+			break;
+		}
+		}
+	}
+	return false;
+}
+
+void HttpFetcher::finish(std::shared_ptr<Transfer> transfer, FetchStatus status, std::string error)
+{
+	if (transfer->done) return;
+	transfer->done = true;
+	transfer->timer.cancel();
+	if (transfer->out.is_open()) transfer->out.close();
+
+	std::error_code fsError;
+	if (status == FetchStatus::OK)
+	{
+		std::filesystem::rename(transfer->partPath, transfer->path, fsError);
+		if (fsError)
+		{
+			status = FetchStatus::FAILED;
+			error = "cannot rename to " + transfer->path.string() + ": " + fsError.message();
+		}
+	}
+	if (status != FetchStatus::OK) std::filesystem::remove(transfer->partPath, fsError);
+
+	if (transfer->connection)
+	{
+		if (status == FetchStatus::OK && transfer->keepAlive) release(transfer->connection);
+		else transfer->connection->close();
+		transfer->connection.reset();
+	}
+
+	if (transfer->callback)
+	{
+		FetchResult result;
+		result.status = status;
+		result.httpStatus = transfer->httpStatus;
+		result.bytes = status == FetchStatus::OK ? transfer->received : 0;
+		if (status == FetchStatus::OK) result.sha256 = transfer->sha.hexDigest();
+		result.path = transfer->path;
+		result.error = std::move(error);
+		try
+		{
+			transfer->callback(result);
+		}
+		catch (...) {}
+	}
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		active--;
+	}
+	pump();
+}
+
+void HttpFetcher::fail(std::shared_ptr<Transfer> transfer, const asio::error_code& ec, const char* stage)
+{
+	if (transfer->timedOut)
+	{
+		finish(transfer, FetchStatus::TIMEOUT, std::string(stage) + ": timed out after " + std::to_string(transfer->options.timeoutMs) + " ms");
+		return;
+	}
+	//空闲连接可能已被服务器关闭，换新连接重试
+	if (transfer->reused && !transfer->responded && !transfer->retried)
+	{
+		transfer->retried = true;
+		transfer->reused = false;
+		transfer->connection->close();
+		transfer->connection.reset();
+		connect(transfer);
+		return;
+	}
+	finish(transfer, FetchStatus::FAILED, std::string(stage) + ": " + ec.message());
+}
+
+std::shared_ptr<HttpFetcher::Connection> HttpFetcher::acquire(const std::string& key)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto iter = idle.find(key);
+	if (iter == idle.end()) return nullptr;
+	auto deadline = std::chrono::steady_clock::now() - std::chrono::seconds(IDLE_SECONDS);
+	std::shared_ptr<Connection> connection;
+	while (!iter->second.empty() && !connection)
+	{
+		connection = iter->second.back();
+		iter->second.pop_back();
+		if (connection->idleSince < deadline)
+		{
+			connection->close();
+			connection.reset();
+		}
+	}
+	if (iter->second.empty()) idle.erase(iter);
+	return connection;
+}
+
+void HttpFetcher::release(std::shared_ptr<Connection> connection)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto& list = idle[connection->key];
+	if (stopping || list.size() >= IDLE_PER_HOST)
+	{
+		connection->close();
+		return;
+	}
+	connection->idleSince = std::chrono::steady_clock::now();
+	list.push_back(connection);
+}
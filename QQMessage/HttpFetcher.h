@@ -0,0 +1,195 @@
+﻿#define ASIO_STANDALONE
+#pragma once
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <asio.hpp>
+#ifdef HTTPFETCHER_SSL
+#include <asio/ssl.hpp>
+#endif
+
+/// <summary>
+/// 下载结果状态
+/// </summary>
+enum class FetchStatus
+{
+	OK,
+	/// <summary>
+	/// 连接失败、非200响应或写入失败
+	/// </summary>
+	FAILED,
+	TIMEOUT,
+	/// <summary>
+	/// 超过大小上限
+	/// </summary>
+	TOO_LARGE
+};
+
+/// <summary>
+/// 下载结果
+/// </summary>
+struct FetchResult
+{
+	FetchStatus status = FetchStatus::FAILED;
+	/// <summary>
+	/// 最终响应的http状态码，未收到响应时为0
+	/// </summary>
+	int httpStatus = 0;
+	/// <summary>
+	/// 写入的字节数
+	/// </summary>
+	unsigned long long bytes = 0;
+	/// <summary>
+	/// 响应体的SHA-256，边接收边计算，成功时有效
+	/// </summary>
+	std::string sha256;
+	std::filesystem::path path;
+	std::string error;
+};
+
+/// <summary>
+/// 下载完成后执行的函数，在下载线程中执行
+/// </summary>
+typedef std::function<void(const FetchResult&)> FetchCallback;
+
+/// <summary>
+/// 单次下载的限制
+/// </summary>
+struct FetchOptions
+{
+	/// <summary>
+	/// 整个下载（含重定向）的超时（毫秒）
+	/// </summary>
+	long timeoutMs = 60000;
+	/// <summary>
+	/// 响应体大小上限（字节）
+	/// </summary>
+	unsigned long long maxBytes = 64ull * 1024 * 1024;
+	int maxRedirects = 3;
+	/// <summary>
+	/// 可为空，参数为响应体将达到的总字节数：已知Content-Length时以其调用一次，否则每次写入前以累计大小调用
+	/// <para>返回false时以TOO_LARGE结束，用于按存储配额逐步预留</para>
+	/// </summary>
+	std::function<bool(unsigned long long)> admit;
+};
+
+/// <summary>
+/// 进程内异步http下载
+/// <para>固定数量的线程运行asio，同时进行的下载数有上限，超出的排队；同一主机的连接在响应完整后保留复用</para>
+/// <para>响应体边接收边写入 目标文件.part，完成后改名，失败时删除；支持Content-Length、chunked与重定向</para>
+/// <para>定义HTTPFETCHER_SSL并链接OpenSSL后支持https，否则https地址直接返回失败</para>
+/// </summary>
+class HttpFetcher
+{
+public:
+	/// <summary>
+	/// 启动下载线程
+	/// </summary>
+	/// <param name="threads">线程数</param>
+	/// <param name="maxConcurrent">同时进行的下载数上限</param>
+	HttpFetcher(int threads, size_t maxConcurrent);
+	/// <summary>
+	/// 停止下载线程，排队中的下载以失败回调，进行中的下载不再回调
+	/// </summary>
+	~HttpFetcher();
+	HttpFetcher(const HttpFetcher&) = delete;
+	HttpFetcher& operator=(const HttpFetcher&) = delete;
+	/// <summary>
+	/// 下载至文件
+	/// </summary>
+	/// <param name="url">http或https地址</param>
+	/// <param name="path">保存路径，上级目录不存在时自动创建</param>
+	/// <param name="callback">完成后执行，可为空</param>
+	/// <param name="options">超时与大小限制</param>
+	void fetch(std::string url, std::filesystem::path path, FetchCallback callback, FetchOptions options = FetchOptions());
+	/// <summary>
+	/// 下载至文件
+	/// </summary>
+	/// <returns>下载结果</returns>
+	std::future<FetchResult> fetchAsync(std::string url, std::filesystem::path path, FetchOptions options = FetchOptions());
+	/// <summary>
+	/// 空闲连接数
+	/// </summary>
+	size_t idleConnections();
+private:
+	struct Url
+	{
+		bool https = false;
+		std::string host;
+		std::string port;
+		std::string target;
+		/// <summary>
+		/// 连接复用的键 scheme://host:port
+		/// </summary>
+		std::string key() const;
+	};
+	struct Connection;
+	struct Transfer;
+	/// <summary>
+	/// 每个主机保留的空闲连接数
+	/// </summary>
+	static constexpr size_t IDLE_PER_HOST = 4;
+	/// <summary>
+	/// 空闲连接的保留时间（秒）
+	/// </summary>
+	static constexpr long IDLE_SECONDS = 30;
+	/// <summary>
+	/// 解析地址
+	/// </summary>
+	static bool parseUrl(const std::string& url, Url& result);
+	/// <summary>
+	/// 在上限内开始排队的下载
+	/// </summary>
+	void pump();
+	/// <summary>
+	/// 对当前地址发起请求，优先复用空闲连接
+	/// </summary>
+	void begin(std::shared_ptr<Transfer> transfer);
+	void connect(std::shared_ptr<Transfer> transfer);
+	void handshake(std::shared_ptr<Transfer> transfer);
+	void sendRequest(std::shared_ptr<Transfer> transfer);
+	void readHeader(std::shared_ptr<Transfer> transfer);
+	/// <summary>
+	/// 解析响应头，处理重定向与错误状态
+	/// </summary>
+	void onHeader(std::shared_ptr<Transfer> transfer, std::string leftover);
+	void readBody(std::shared_ptr<Transfer> transfer);
+	/// <summary>
+	/// 处理收到的响应体数据
+	/// </summary>
+	/// <returns>响应体是否已完整</returns>
+	bool consume(std::shared_ptr<Transfer> transfer, const char* data, size_t size);
+	/// <summary>
+	/// 结束下载，归还或关闭连接并回调
+	/// </summary>
+	void finish(std::shared_ptr<Transfer> transfer, FetchStatus status, std::string error);
+	/// <summary>
+	/// 读写出错时的处理，复用的连接在收到响应前断开时换新连接重试一次
+	/// </summary>
+	void fail(std::shared_ptr<Transfer> transfer, const asio::error_code& ec, const char* stage);
+	std::shared_ptr<Connection> acquire(const std::string& key);
+	void release(std::shared_ptr<Connection> connection);
+
+	asio::io_context io;
+	std::unique_ptr<asio::executor_work_guard<asio::io_context::executor_type>> work;
+	std::vector<std::thread> workers;
+	std::mutex mtx;
+	size_t maxConcurrent;
+	size_t active;
+	bool stopping;
+	std::deque<std::shared_ptr<Transfer>> pending;
+	/// <summary>
+	/// 空闲连接【scheme://host:port，连接】
+	/// </summary>
+	std::map<std::string, std::vector<std::shared_ptr<Connection>>> idle;
+#ifdef HTTPFETCHER_SSL
+	std::unique_ptr<asio::ssl::context> tls;
+#endif
+};
@@ -0,0 +1,159 @@
+﻿#include "JsonWriter.h"
+
+JsonFragment::JsonFragment(std::string_view text)
+{
+	escaped.reserve(text.size() + text.size() / 16);
+	JsonWriter::escape(escaped, text);
+}
+
+JsonFragment JsonFragment::fromEscaped(std::string escaped)
+{
+	JsonFragment fragment;
+	fragment.escaped = std::move(escaped);
+	return fragment;
+}
+
+const std::string& JsonFragment::str() const
+{
+	return escaped;
+}
+
+void JsonFragment::append(std::string_view text)
+{
+	JsonWriter::escape(escaped, text);
+}
+
+void JsonFragment::append(const JsonFragment& fragment)
+{
+	escaped += fragment.escaped;
+}
+
+bool JsonFragment::empty() const
+{
+	return escaped.empty();
+}
+
+JsonWriter::JsonWriter(std::string& out) : out(out), needComma(false) {}
+
+void JsonWriter::separate()
+{
+	if (needComma) out += ',';
+}
+
+JsonWriter& JsonWriter::beginObject()
+{
+	separate();
+	out += '{';
+	needComma = false;
+	return *this;
+}
+
+JsonWriter& JsonWriter::endObject()
+{
+	out += '}';
+	needComma = true;
+	return *this;
+}
+
+JsonWriter& JsonWriter::beginArray()
+{
+	separate();
+	out += '[';
+	needComma = false;
+	return *this;
+}
+
+JsonWriter& JsonWriter::endArray()
+{
+	out += ']';
+	needComma = true;
+	return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view name)
+{
+	separate();
+	out += '"';
+	escape(out, name);
+	out += "\":";
+	needComma = false;
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view text)
+{
+	separate();
+	out += '"';
+	escape(out, text);
+	out += '"';
+	needComma = true;
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(const char* text)
+{
+	return value(std::string_view(text));
+}
+
+JsonWriter& JsonWriter::value(const JsonFragment& fragment)
+{
+	separate();
+	out += '"';
+	out += fragment.str();
+	out += '"';
+	needComma = true;
+	return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag)
+{
+	separate();
+	out += flag ? "true" : "false";
+	needComma = true;
+	return *this;
+}
+
+JsonWriter& JsonWriter::raw(std::string_view json)
+{
+	separate();
+	out += json;
+	needComma = true;
+	return *this;
+}
+
+void JsonWriter::escape(std::string& out, std::string_view text)
+{
+	static const char HEX[] = "0123456789abcdef";
+	//连续无需转义的字符整段追加
+	size_t begin = 0;
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		unsigned char c = (unsigned char)text[i];
+		if (c >= 0x20 && c != '"' && c != '\\') continue;
+		out.append(text.data() + begin, i - begin);
+		begin = i + 1;
+		switch (c)
+		{
+		case '"': out += "\\\""; break;
+		case '\\': out += "\\\\"; break;
+		case '\n': out += "\\n"; break;
+		case '\r': out += "\\r"; break;
+		case '\t': out += "\\t"; break;
+		case '\b': out += "\\b"; break;
+		case '\f': out += "\\f"; break;
+		default:
+			out += "\\u00";
+			out += HEX[c >> 4];
+			out += HEX[c & 0xf];
+			break;
+		}
+	}
+	out.append(text.data() + begin, text.size() - begin);
+}
+
+std::string& JsonWriter::threadBuffer()
+{
+	thread_local std::string buffer;
+	buffer.clear();
+	return buffer;
+}
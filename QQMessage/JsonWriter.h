@@ -0,0 +1,112 @@
+﻿#pragma once
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/// <summary>
+/// 已转义的json字符串内容，不含两侧引号
+/// <para>固定文本与批量推送的消息只转义一次，发送时直接写入</para>
+/// </summary>
+class JsonFragment
+{
+private:
+	std::string escaped;
+public:
+	JsonFragment() = default;
+	/// <summary>
+	/// 转义文本
+	/// </summary>
+	/// <param name="text">原始文本</param>
+	explicit JsonFragment(std::string_view text);
+	/// <summary>
+	/// 使用已转义的内容，不再检查
+	/// </summary>
+	/// <param name="escaped">已转义的内容</param>
+	static JsonFragment fromEscaped(std::string escaped);
+	/// <summary>
+	/// 转义后的内容
+	/// </summary>
+	const std::string& str() const;
+	/// <summary>
+	/// 追加原始文本，自动转义
+	/// </summary>
+	/// <param name="text">原始文本</param>
+	void append(std::string_view text);
+	/// <summary>
+	/// 追加已转义的内容
+	/// </summary>
+	/// <param name="fragment">已转义的内容</param>
+	void append(const JsonFragment& fragment);
+	bool empty() const;
+};
+
+/// <summary>
+/// 流式json输出
+/// <para>直接写入调用方提供的字符串，字符串转义单次遍历完成，不构造中间对象</para>
+/// <para>不检查结构是否完整，由调用方保证begin与end配对</para>
+/// </summary>
+class JsonWriter
+{
+private:
+	std::string& out;
+	/// <summary>
+	/// 下一个元素前是否需要逗号
+	/// </summary>
+	bool needComma;
+	/// <summary>
+	/// 写入元素间的逗号
+	/// </summary>
+	void separate();
+public:
+	/// <summary>
+	/// 初始化输出
+	/// </summary>
+	/// <param name="out">输出目标，在其末尾追加</param>
+	explicit JsonWriter(std::string& out);
+	JsonWriter& beginObject();
+	JsonWriter& endObject();
+	JsonWriter& beginArray();
+	JsonWriter& endArray();
+	/// <summary>
+	/// 写入对象的键
+	/// </summary>
+	/// <param name="name">键名，自动转义</param>
+	JsonWriter& key(std::string_view name);
+	/// <summary>
+	/// 写入字符串值，自动转义
+	/// </summary>
+	JsonWriter& value(std::string_view text);
+	JsonWriter& value(const char* text);
+	/// <summary>
+	/// 写入已转义的字符串值
+	/// </summary>
+	JsonWriter& value(const JsonFragment& fragment);
+	/// <summary>
+	/// 写入整数值
+	/// </summary>
+	template<typename T, typename = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+	JsonWriter& value(T number)
+	{
+		separate();
+		out += std::to_string(number);
+		needComma = true;
+		return *this;
+	}
+	JsonWriter& value(bool flag);
+	/// <summary>
+	/// 写入完整的json文本，如已序列化的对象
+	/// </summary>
+	/// <param name="json">json文本</param>
+	JsonWriter& raw(std::string_view json);
+	/// <summary>
+	/// 转义文本并追加至输出，不含两侧引号
+	/// </summary>
+	/// <param name="out">输出目标</param>
+	/// <param name="text">原始文本</param>
+	static void escape(std::string& out, std::string_view text);
+	/// <summary>
+	/// 当前线程复用的输出缓冲，返回前清空但保留容量
+	/// <para>下次调用时内容失效，只能在同一函数内使用</para>
+	/// </summary>
+	static std::string& threadBuffer();
+};
@@ -0,0 +1,144 @@
+﻿#include "MessageDispatcher.h"
+#include <algorithm>
+#include <iostream>
+
+MessageDispatcher::MessageDispatcher(SendFunc sendFunc, size_t capacity, double burst, double rate, int maxAttempts) :
+	sendFunc(sendFunc), capacity(capacity), maxAttempts(maxAttempts), bucket(burst, rate),
+	stopping(false), totalLatencyMs(0), totalSendMs(0), sendCalls(0)
+{
+	worker = std::thread(&MessageDispatcher::run, this);
+}
+
+MessageDispatcher::~MessageDispatcher()
+{
+	stop();
+}
+
+bool MessageDispatcher::post(ApiRequest request, SendPriority priority)
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		if (!stopping && lanes[0].size() + lanes[1].size() + delayed.size() < capacity)
+		{
+			Item item;
+			item.request = std::move(request);
+			item.priority = priority;
+			item.enqueued = std::chrono::steady_clock::now();
+			lanes[(int)priority].push_back(std::move(item));
+			cv.notify_one();
+			return true;
+		}
+		metrics.dropped++;
+	}
+	std::cerr << "> Outbound queue full, message dropped." << std::endl;
+	if (request.callback != nullptr)
+	{
+		ApiResult result;
+		result.status = ApiStatus::REJECTED;
+		request.callback(result);
+	}
+	return false;
+}
+
+DispatcherMetrics MessageDispatcher::getMetrics()
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	DispatcherMetrics ret = metrics;
+	ret.interactiveDepth = lanes[(int)SendPriority::INTERACTIVE].size();
+	ret.bulkDepth = lanes[(int)SendPriority::BULK].size();
+	ret.retryDepth = delayed.size();
+	if (metrics.sent != 0) ret.avgLatencyMs = totalLatencyMs / metrics.sent;
+	if (sendCalls != 0) ret.avgSendMs = totalSendMs / sendCalls;
+	return ret;
+}
+
+void MessageDispatcher::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		stopping = true;
+	}
+	cv.notify_all();
+	if (worker.joinable()) worker.join();
+}
+
+std::deque<MessageDispatcher::Item>& MessageDispatcher::nextLane()
+{
+	if (!lanes[(int)SendPriority::INTERACTIVE].empty()) return lanes[(int)SendPriority::INTERACTIVE];
+	return lanes[(int)SendPriority::BULK];
+}
+
+void MessageDispatcher::promoteDue()
+{
+	auto now = std::chrono::steady_clock::now();
+	while (!delayed.empty() && (stopping || delayed.begin()->first <= now))
+	{
+		Item& item = delayed.begin()->second;
+		lanes[(int)item.priority].push_front(std::move(item));
+		delayed.erase(delayed.begin());
+	}
+}
+
+void MessageDispatcher::run()
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while (true)
+	{
+		promoteDue();
+		if (lanes[0].empty() && lanes[1].empty())
+		{
+			if (stopping) return;
+			//队列为空时等待新消息或最早的重试到期
+			auto ready = [this] { return stopping || !lanes[0].empty() || !lanes[1].empty(); };
+			if (delayed.empty()) cv.wait(lock, ready);
+			else cv.wait_until(lock, delayed.begin()->first, ready);
+			continue;
+		}
+		if (!stopping)//停止时不再限速，尽快发出剩余消息
+		{
+			double wait = bucket.waitTime();
+			if (wait > 0)
+			{
+				cv.wait_for(lock, std::chrono::duration<double>(wait), [this] { return stopping; });
+				continue;//等待期间可能有交互消息插队，重新选择队列
+			}
+			bucket.tryConsume();
+		}
+
+		std::deque<Item>& lane = nextLane();
+		Item item = std::move(lane.front());
+		lane.pop_front();
+		item.attempts++;
+
+		lock.unlock();
+		auto begin = std::chrono::steady_clock::now();
+		bool result = sendFunc(item.request);
+		auto end = std::chrono::steady_clock::now();
+		lock.lock();
+
+		sendCalls++;
+		totalSendMs += std::chrono::duration<double, std::milli>(end - begin).count();
+		if (result)
+		{
+			double latency = std::chrono::duration<double, std::milli>(end - item.enqueued).count();
+			metrics.sent++;
+			totalLatencyMs += latency;
+			metrics.maxLatencyMs = std::max(metrics.maxLatencyMs, latency);
+		}
+		else if (item.attempts < maxAttempts && !stopping)
+		{
+			metrics.retried++;
+			//指数退避 200ms 400ms ...，等待期间其他消息照常发送
+			auto due = std::chrono::steady_clock::now() + std::chrono::milliseconds(200 << (item.attempts - 1));
+			delayed.emplace(due, std::move(item));
+		}
+		else
+		{
+			metrics.failed++;
+			lock.unlock();
+			std::cerr << "> Message dropped after " << item.attempts << " attempts." << std::endl;
+			if (item.request.callback != nullptr) item.request.callback(ApiResult());
+			lock.lock();
+		}
+	}
+}
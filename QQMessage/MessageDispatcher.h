@@ -0,0 +1,168 @@
+﻿#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "ApiCall.h"
+#include "RateLimiter.h"
+
+/// <summary>
+/// 发送优先级
+/// </summary>
+enum class SendPriority
+{
+	/// <summary>
+	/// 对用户命令的回复，优先发送
+	/// </summary>
+	INTERACTIVE = 0,
+	/// <summary>
+	/// 作业通知、批改结果等批量推送
+	/// </summary>
+	BULK = 1
+};
+
+/// <summary>
+/// 发送队列统计
+/// </summary>
+struct DispatcherMetrics
+{
+	/// <summary>
+	/// 交互队列长度
+	/// </summary>
+	size_t interactiveDepth = 0;
+	/// <summary>
+	/// 批量队列长度
+	/// </summary>
+	size_t bulkDepth = 0;
+	/// <summary>
+	/// 等待重试的消息数
+	/// </summary>
+	size_t retryDepth = 0;
+	/// <summary>
+	/// 发送成功数
+	/// </summary>
+	unsigned long long sent = 0;
+	/// <summary>
+	/// 重试次数
+	/// </summary>
+	unsigned long long retried = 0;
+	/// <summary>
+	/// 重试耗尽后放弃数
+	/// </summary>
+	unsigned long long failed = 0;
+	/// <summary>
+	/// 队列已满被拒绝数
+	/// </summary>
+	unsigned long long dropped = 0;
+	/// <summary>
+	/// 入队到发送成功的平均耗时（毫秒）
+	/// </summary>
+	double avgLatencyMs = 0;
+	/// <summary>
+	/// 入队到发送成功的最大耗时（毫秒）
+	/// </summary>
+	double maxLatencyMs = 0;
+	/// <summary>
+	/// 单次发送调用的平均耗时（毫秒）
+	/// </summary>
+	double avgSendMs = 0;
+};
+
+/// <summary>
+/// 出站消息调度
+/// <para>多线程入队，单一发送线程按令牌桶节奏发送，交互回复优先于批量推送</para>
+/// <para>发送失败的消息按退避时间放入重试队列，到期后回到原队列队首，等待期间其他消息照常发送</para>
+/// </summary>
+class MessageDispatcher
+{
+public:
+	/// <summary>
+	/// 实际发送函数，返回发送结果
+	/// </summary>
+	typedef std::function<bool(const ApiRequest& request)> SendFunc;
+	/// <summary>
+	/// 初始化并启动发送线程
+	/// </summary>
+	/// <param name="sendFunc">发送函数</param>
+	/// <param name="capacity">队列容量（两条队列与重试队列合计）</param>
+	/// <param name="burst">令牌桶大小</param>
+	/// <param name="rate">每秒补充令牌数</param>
+	/// <param name="maxAttempts">单条消息最大发送次数</param>
+	MessageDispatcher(SendFunc sendFunc, size_t capacity, double burst, double rate, int maxAttempts = 3);
+	/// <summary>
+	/// 发送剩余消息后停止发送线程
+	/// </summary>
+	~MessageDispatcher();
+	MessageDispatcher(const MessageDispatcher&) = delete;
+	MessageDispatcher& operator=(const MessageDispatcher&) = delete;
+	/// <summary>
+	/// 请求入队
+	/// <para>队列已满或已停止时以REJECTED、重试耗尽时以FAILED执行请求的回调</para>
+	/// </summary>
+	/// <param name="request">api请求</param>
+	/// <param name="priority">优先级</param>
+	/// <returns>队列已满或已停止时返回false</returns>
+	bool post(ApiRequest request, SendPriority priority = SendPriority::INTERACTIVE);
+	/// <summary>
+	/// 获取统计
+	/// </summary>
+	/// <returns>统计快照</returns>
+	DispatcherMetrics getMetrics();
+	/// <summary>
+	/// 停止发送线程，队列中剩余消息仍会尝试发送一次
+	/// </summary>
+	void stop();
+private:
+	/// <summary>
+	/// 队列中的消息
+	/// </summary>
+	struct Item
+	{
+		ApiRequest request;
+		SendPriority priority = SendPriority::INTERACTIVE;
+		std::chrono::steady_clock::time_point enqueued;
+		int attempts = 0;
+	};
+	/// <summary>
+	/// 发送线程
+	/// </summary>
+	void run();
+	/// <summary>
+	/// 取出下一条消息，交互队列优先
+	/// </summary>
+	/// <returns>所在队列</returns>
+	std::deque<Item>& nextLane();
+	/// <summary>
+	/// 将到期的重试放回原队列队首，停止时全部放回，调用时须持有mtx
+	/// </summary>
+	void promoteDue();
+
+	SendFunc sendFunc;
+	size_t capacity;
+	int maxAttempts;
+	TokenBucket bucket;
+	/// <summary>
+	/// 按SendPriority下标的队列
+	/// </summary>
+	std::deque<Item> lanes[2];
+	/// <summary>
+	/// 等待重试的消息【到期时间，消息】
+	/// </summary>
+	std::multimap<std::chrono::steady_clock::time_point, Item> delayed;
+	std::mutex mtx;
+	std::condition_variable cv;
+	bool stopping;
+	DispatcherMetrics metrics;
+	/// <summary>
+	/// 累计耗时，用于计算平均值
+	/// </summary>
+	double totalLatencyMs;
+	double totalSendMs;
+	unsigned long long sendCalls;
+	std::thread worker;
+};
@@ -0,0 +1,291 @@
+﻿#include "NotificationJob.h"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <set>
+
+#include "Exception.h"
+#include "PrivateMessageSender.h"
+#include "Tools.h"
+
+extern std::string rootPath;
+
+bool NotificationJobStatus::finished() const
+{
+	return delivered + failed + timeout >= total;
+}
+
+NotificationJobManager::~NotificationJobManager()
+{
+	stop();
+}
+
+std::filesystem::path NotificationJobManager::jobRoot()
+{
+	std::filesystem::path root = rootPath;
+	return root / ".jobs";
+}
+
+std::string NotificationJobManager::submit(long long assignmentId, long long classId, const std::string& message, const std::vector<long long>& recipients)
+{
+	auto job = std::make_shared<Job>();
+	job->message = message;
+	job->status.assignmentId = assignmentId;
+	job->status.classId = classId;
+	job->status.total = recipients.size();
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		long long id = Tools::getTimestamp();
+		while (jobs.count(std::to_string(id)) || std::filesystem::exists(jobRoot() / std::to_string(id))) id++;
+		job->status.id = std::to_string(id);
+		job->dir = jobRoot() / job->status.id;
+		jobs[job->status.id] = job;
+		evict();
+	}
+
+	try
+	{
+		std::filesystem::create_directories(job->dir);
+		std::ofstream out;
+		out.open(job->dir / "message", std::ios::binary | std::ios::trunc);
+		out << message;
+		out.close();
+		//job最后写入，存在job即说明任务完整
+		out.open(job->dir / "job", std::ios::trunc);
+		out << assignmentId << std::endl << classId << std::endl << recipients.size() << std::endl;
+		for (auto& iter : recipients) out << iter << std::endl;
+		out.close();
+	}
+	catch (std::exception& e)
+	{
+		throw FileError("cannot store job:" + job->dir.string() + "\n" + e.what());
+	}
+
+	if (recipients.empty()) std::filesystem::remove_all(job->dir);
+	start(job, recipients);
+	return job->status.id;
+}
+
+void NotificationJobManager::resume()
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		if (resumed) return;
+		resumed = true;
+	}
+	if (!std::filesystem::exists(jobRoot())) return;
+
+	for (auto& entry : std::filesystem::directory_iterator(jobRoot()))
+	{
+		if (!entry.is_directory()) continue;
+		{
+			//本次运行中已提交的任务由submit发送
+			std::lock_guard<std::mutex> lock(mtx);
+			if (jobs.count(entry.path().filename().string()) > 0) continue;
+		}
+		auto job = std::make_shared<Job>();
+		job->dir = entry.path();
+		job->status.id = entry.path().filename().string();
+
+		std::ifstream in(job->dir / "job");
+		size_t count = 0;
+		if (!(in >> job->status.assignmentId >> job->status.classId >> count))
+		{
+			std::filesystem::remove_all(job->dir);//未写完的任务
+			continue;
+		}
+		std::vector<long long> recipients(count);
+		for (auto& iter : recipients) in >> iter;
+		in.close();
+		job->status.total = count;
+
+		in.open(job->dir / "message", std::ios::binary);
+		job->message.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		in.close();
+
+		std::set<long long> done;
+		in.open(job->dir / "progress");
+		long long qq_id;
+		char result;
+		while (in >> qq_id >> result)
+		{
+			if (!done.insert(qq_id).second) continue;
+			if (result == 'O') job->status.delivered++;
+			else if (result == 'T') job->status.timeout++;
+			else job->status.failed++;
+		}
+		in.close();
+
+		std::vector<long long> remaining;
+		for (auto& iter : recipients)
+		{
+			if (done.count(iter) == 0) remaining.push_back(iter);
+		}
+		if (remaining.empty())
+		{
+			std::filesystem::remove_all(job->dir);
+			continue;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			jobs[job->status.id] = job;
+		}
+		std::cerr << "Resume notification job " << job->status.id << ": " << remaining.size() << " remaining." << std::endl;
+		start(job, remaining);
+	}
+}
+
+bool NotificationJobManager::getStatus(const std::string& id, NotificationJobStatus& status)
+{
+	std::shared_ptr<Job> job;
+	std::lock_guard<std::mutex> lock(mtx);
+	evict();
+	auto iter = jobs.find(id);
+	if (iter == jobs.end()) return false;
+	job = iter->second;
+	std::lock_guard<std::mutex> jobLock(job->mtx);
+	status = job->status;
+	if (status.finished()) jobs.erase(iter);//完成后的进度只需读取一次
+	return true;
+}
+
+void NotificationJobManager::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		stopping = true;
+	}
+	cv.notify_all();
+	if (worker.joinable()) worker.join();
+}
+
+void NotificationJobManager::start(std::shared_ptr<Job> job, const std::vector<long long>& recipients)
+{
+	{
+		std::lock_guard<std::mutex> lock(job->mtx);
+		//所有接收者共用一次转义结果
+		job->fragment = JsonFragment(job->message);
+		job->queue.assign(recipients.begin(), recipients.end());
+		if (job->status.finished()) job->finishedAt = std::chrono::steady_clock::now();
+	}
+	std::lock_guard<std::mutex> lock(mtx);
+	if (stopping) return;
+	if (!worker.joinable()) worker = std::thread(&NotificationJobManager::run, this);
+	wake = true;
+	cv.notify_all();
+}
+
+bool NotificationJobManager::feed(std::shared_ptr<Job> job)
+{
+	std::unique_lock<std::mutex> lock(job->mtx);
+	while (!job->queue.empty() && job->inFlight < WINDOW)
+	{
+		long long qq_id = job->queue.front();
+		job->queue.pop_front();
+		job->inFlight++;
+		job->rejected = false;
+		PrivateMessageSender sender(qq_id, job->fragment, SendPriority::BULK);
+		sender.setClassId(job->status.classId);
+		lock.unlock();
+		//出站队列已满时在send中以REJECTED执行回调
+		sender.send([this, job, qq_id](const ApiResult& result) { record(job, qq_id, result.status); });
+		lock.lock();
+		if (job->rejected) return false;
+	}
+	return true;
+}
+
+void NotificationJobManager::record(std::shared_ptr<Job> job, long long qq_id, ApiStatus result)
+{
+	{
+		std::lock_guard<std::mutex> lock(job->mtx);
+		job->inFlight--;
+		if (result == ApiStatus::REJECTED)
+		{
+			//未能加入出站队列，不记入进度，由发送线程稍后重新加入
+			job->queue.push_front(qq_id);
+			job->rejected = true;
+			return;
+		}
+		recordResult(*job, qq_id, result);
+	}
+	//已有结果，可以补充下一个接收者
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		wake = true;
+	}
+	cv.notify_all();
+}
+
+void NotificationJobManager::recordResult(Job& job, long long qq_id, ApiStatus result)
+{
+	char code = 'F';
+	if (result == ApiStatus::OK)
+	{
+		job.status.delivered++;
+		code = 'O';
+	}
+	else if (result == ApiStatus::TIMEOUT)
+	{
+		job.status.timeout++;
+		code = 'T';
+	}
+	else
+	{
+		job.status.failed++;
+	}
+
+	try
+	{
+		if (job.status.finished())
+		{
+			job.finishedAt = std::chrono::steady_clock::now();
+			std::filesystem::remove_all(job.dir);
+			std::cerr << "Notification job " << job.status.id << " finished: " << job.status.delivered << " delivered, "
+				<< job.status.failed << " failed, " << job.status.timeout << " timeout." << std::endl;
+			return;
+		}
+		std::ofstream out;
+		out.open(job.dir / "progress", std::ios::app);
+		out << qq_id << ' ' << code << std::endl;
+		out.close();
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "cannot store job progress:" << job.dir.string() << "\n" << e.what() << std::endl;
+	}
+}
+
+void NotificationJobManager::evict()
+{
+	auto now = std::chrono::steady_clock::now();
+	for (auto iter = jobs.begin(); iter != jobs.end();)
+	{
+		std::shared_ptr<Job> job = iter->second;
+		std::lock_guard<std::mutex> lock(job->mtx);
+		if (job->status.finished() && now - job->finishedAt > FINISHED_TTL) iter = jobs.erase(iter);
+		else iter++;
+	}
+}
+
+void NotificationJobManager::run()
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while (!stopping)
+	{
+		wake = false;
+		std::vector<std::shared_ptr<Job>> active;
+		for (auto& iter : jobs) active.push_back(iter.second);
+		lock.unlock();
+		bool rejected = false;
+		for (auto& job : active)
+		{
+			if (!feed(job)) rejected = true;
+		}
+		lock.lock();
+		evict();
+		//出站队列已满时间隔重试，否则等待结果或新任务
+		if (rejected) cv.wait_for(lock, RETRY_INTERVAL, [this] { return stopping; });
+		else cv.wait(lock, [this] { return stopping || wake; });
+	}
+}
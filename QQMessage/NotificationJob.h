@@ -0,0 +1,173 @@
+﻿#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ApiCall.h"
+#include "JsonWriter.h"
+
+/// <summary>
+/// 通知任务进度
+/// </summary>
+struct NotificationJobStatus
+{
+	std::string id;
+	long long assignmentId = 0;
+	/// <summary>
+	/// 接收者所在班级，用于选择发送账号
+	/// </summary>
+	long long classId = 0;
+	/// <summary>
+	/// 接收者总数
+	/// </summary>
+	size_t total = 0;
+	/// <summary>
+	/// go-cqhttp确认送达数
+	/// </summary>
+	size_t delivered = 0;
+	/// <summary>
+	/// 发送失败数
+	/// </summary>
+	size_t failed = 0;
+	/// <summary>
+	/// 超时未收到回执数，可能已送达
+	/// </summary>
+	size_t timeout = 0;
+	/// <summary>
+	/// 全部接收者均已有结果
+	/// </summary>
+	bool finished() const;
+};
+
+/// <summary>
+/// 通知批量发送任务
+/// <para>消息只生成一次，由发送线程按接收者以BULK优先级逐步加入出站队列；进度持久化于rootPath/.jobs/任务id，重启后继续发送未完成的部分</para>
+/// <para>每个任务同时在出站队列中的接收者不超过WINDOW个，有结果后补充；出站队列已满时稍后重新加入，不计为失败</para>
+/// </summary>
+class NotificationJobManager
+{
+public:
+	/// <summary>
+	/// 停止发送线程
+	/// </summary>
+	~NotificationJobManager();
+	/// <summary>
+	/// 新建任务并开始发送
+	/// </summary>
+	/// <param name="assignmentId">布置作业ID</param>
+	/// <param name="classId">接收者所在班级</param>
+	/// <param name="message">消息内容</param>
+	/// <param name="recipients">接收者qq</param>
+	/// <returns>任务id</returns>
+	std::string submit(long long assignmentId, long long classId, const std::string& message, const std::vector<long long>& recipients);
+	/// <summary>
+	/// 载入上次运行未完成的任务并继续发送，仅首次调用生效
+	/// </summary>
+	void resume();
+	/// <summary>
+	/// 查询任务进度
+	/// <para>已完成的任务在查询后移除，未被查询的在完成FINISHED_TTL后移除</para>
+	/// </summary>
+	/// <param name="id">任务id</param>
+	/// <param name="status">进度</param>
+	/// <returns>任务不存在或已移除时返回false</returns>
+	bool getStatus(const std::string& id, NotificationJobStatus& status);
+	/// <summary>
+	/// 停止发送线程，未发出的接收者不记入进度，下次启动时继续发送
+	/// </summary>
+	void stop();
+private:
+	/// <summary>
+	/// 每个任务同时在出站队列中的接收者数
+	/// </summary>
+	static constexpr size_t WINDOW = 64;
+	/// <summary>
+	/// 出站队列已满时重新加入的间隔
+	/// </summary>
+	static constexpr std::chrono::seconds RETRY_INTERVAL{ 1 };
+	/// <summary>
+	/// 已完成的任务未被查询时保留的时间
+	/// </summary>
+	static constexpr std::chrono::minutes FINISHED_TTL{ 60 };
+
+	/// <summary>
+	/// 任务
+	/// </summary>
+	struct Job
+	{
+		NotificationJobStatus status;
+		std::string message;
+		/// <summary>
+		/// 转义后的消息，所有接收者共用
+		/// </summary>
+		JsonFragment fragment;
+		/// <summary>
+		/// 尚未加入出站队列的接收者
+		/// </summary>
+		std::deque<long long> queue;
+		/// <summary>
+		/// 已加入出站队列、尚无结果的接收者数
+		/// </summary>
+		size_t inFlight = 0;
+		/// <summary>
+		/// 最近一次加入被出站队列拒绝
+		/// </summary>
+		bool rejected = false;
+		std::chrono::steady_clock::time_point finishedAt;
+		/// <summary>
+		/// 任务目录，含job（作业ID、班级与接收者）、message、progress（逐条追加的结果）
+		/// </summary>
+		std::filesystem::path dir;
+		std::mutex mtx;
+	};
+	/// <summary>
+	/// 任务根目录
+	/// </summary>
+	std::filesystem::path jobRoot();
+	/// <summary>
+	/// 登记任务的接收者并唤醒发送线程
+	/// </summary>
+	void start(std::shared_ptr<Job> job, const std::vector<long long>& recipients);
+	/// <summary>
+	/// 将任务的接收者加入出站队列，直到达到WINDOW或被拒绝
+	/// </summary>
+	/// <returns>被出站队列拒绝时返回false</returns>
+	bool feed(std::shared_ptr<Job> job);
+	/// <summary>
+	/// 记录一个接收者的结果，被出站队列拒绝的放回任务队列
+	/// </summary>
+	void record(std::shared_ptr<Job> job, long long qq_id, ApiStatus result);
+	/// <summary>
+	/// 计入进度并追加至进度文件，持有job.mtx时调用
+	/// </summary>
+	void recordResult(Job& job, long long qq_id, ApiStatus result);
+	/// <summary>
+	/// 移除完成超过FINISHED_TTL的任务，持有mtx时调用
+	/// </summary>
+	void evict();
+	/// <summary>
+	/// 发送线程，有结果或新任务时补充出站队列
+	/// </summary>
+	void run();
+
+	std::mutex mtx;
+	std::condition_variable cv;
+	/// <summary>
+	/// 本次运行中的任务【任务id，任务】
+	/// </summary>
+	std::map<std::string, std::shared_ptr<Job>> jobs;
+	bool resumed = false;
+	bool stopping = false;
+	/// <summary>
+	/// 有接收者可以补充
+	/// </summary>
+	bool wake = false;
+	std::thread worker;
+};
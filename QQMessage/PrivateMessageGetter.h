@@ -13,16 +13,16 @@ private:
 
 
 public:
-    PrivateMessageGetter(nlohmann::json decode) :
+    PrivateMessageGetter(const nlohmann::json& decode) :
         senderId(decode.at("user_id").get<long long>()),time(decode.at("time").get<long long>()), rawData(decode.at("message").get<std::string>())
     { }
 
-    std::string getRawData()
+    const std::string& getRawData() const
     {
         return rawData;
     }
 
-    long long getSenderId()
+    long long getSenderId() const
     {
         return senderId;
     }
@@ -1,20 +1,93 @@
 ﻿#include "PrivateMessageSender.h"
-#include "WebsocketClient.h"
+#include "ClientPool.h"
 /// <summary>
-/// ws客户端 位于QQMessage
+/// go-cqhttp连接池 位于QQMessage
 /// </summary>
-extern WebsocketClient wsClient;
+extern ClientPool clientPool;
 
-PrivateMessageSender::PrivateMessageSender(long long targetId, std::string data) :targetId(targetId), data(data) {}
+PrivateMessageSender::PrivateMessageSender(long long targetId, std::string_view data, SendPriority priority) :data(data), targetId(targetId), priority(priority), classId(0) {}
 
-void PrivateMessageSender::setContent(std::string data)
+PrivateMessageSender::PrivateMessageSender(long long targetId, JsonFragment data, SendPriority priority) :data(std::move(data)), targetId(targetId), priority(priority), classId(0) {}
+
+void PrivateMessageSender::setContent(std::string_view data)
+{
+	this->data = JsonFragment(data);
+}
+
+namespace
+{
+	/// <summary>
+	/// 当前线程生效的批次
+	/// </summary>
+	thread_local ReplyBatch* currentBatch = nullptr;
+}
+
+void PrivateMessageSender::setClassId(long long classId)
 {
-	this->data = data;
+	this->classId = classId;
 }
 
-void PrivateMessageSender::send()
+void PrivateMessageSender::send(ApiCallback callback)
 {
-	std::string tmp = R"({"action": "send_private_msg", "params": { "user_id": )" + std::to_string(targetId) + R"(, "message": ")" + data + R"(" }, "echo": 0})";
-	wsClient.Send(tmp);
+	if (currentBatch != nullptr && priority == SendPriority::INTERACTIVE && callback == nullptr)
+	{
+		currentBatch->append(targetId, data);
+		return;
+	}
+	sendNow(callback);
+}
+
+void PrivateMessageSender::sendNow(ApiCallback callback)
+{
+	//内容已转义，只需一次分配
+	std::string params;
+	params.reserve(data.str().size() + 48);
+	JsonWriter(params).beginObject().key("user_id").value(targetId).key("message").value(data).endObject();
+	clientPool.post(targetId, classId, ApiRequest{ "send_private_msg", std::move(params), callback }, priority);
 	return;
-}
\ No newline at end of file
+}
+
+ReplyBatch::ReplyBatch() : previous(currentBatch)
+{
+	currentBatch = this;
+}
+
+ReplyBatch::~ReplyBatch()
+{
+	currentBatch = previous;
+	try
+	{
+		flush();
+	}
+	catch (...)
+	{
+	}
+}
+
+void ReplyBatch::append(long long targetId, const JsonFragment& data)
+{
+	//只合并至该接收者的最后一条，保持发送顺序
+	for (auto iter = replies.rbegin(); iter != replies.rend(); iter++)
+	{
+		if (iter->first != targetId) continue;
+		if (iter->second.str().size() + data.str().size() + 4 > PrivateMessageSender::MAX_MESSAGE_SIZE) break;
+		iter->second.append("\r\n");
+		iter->second.append(data);
+		return;
+	}
+	replies.emplace_back(targetId, data);
+}
+
+void ReplyBatch::flush()
+{
+	for (auto& iter : replies)
+	{
+		PrivateMessageSender(iter.first, std::move(iter.second)).sendNow();
+	}
+	replies.clear();
+}
+
+ReplyBatch* ReplyBatch::current()
+{
+	return currentBatch;
+}
@@ -1,5 +1,10 @@
 ﻿#pragma once
 #include <string>
+#include <vector>
+#include <utility>
+
+#include "MessageDispatcher.h"
+#include "JsonWriter.h"
 /// <summary>
 /// 私聊消息发送
 /// </summary>
@@ -7,27 +12,102 @@ class PrivateMessageSender
 {
 private:
 	/// <summary>
-	/// 发送的信息
+	/// 发送的信息，已转义
 	/// </summary>
-	std::string data;
+	JsonFragment data;
 	/// <summary>
 	/// 接收者qq
 	/// </summary>
 	long long targetId;
+	/// <summary>
+	/// 发送优先级
+	/// </summary>
+	SendPriority priority;
+	/// <summary>
+	/// 接收者班级，用于选择发送账号，未知时为0
+	/// </summary>
+	long long classId;
 public:
+	/// <summary>
+	/// 单条消息转义后的最大字节数，ReplyBatch合并时不超过该长度
+	/// </summary>
+	static constexpr size_t MAX_MESSAGE_SIZE = 4000;
 	/// <summary>
 	/// 初始化消息发送
 	/// </summary>
 	/// <param name="targetId">接收者qq</param>
 	/// <param name="data">内容</param>
-	PrivateMessageSender(long long targetId, std::string data);
+	/// <param name="priority">发送优先级，批量推送使用BULK</param>
+	PrivateMessageSender(long long targetId, std::string_view data, SendPriority priority = SendPriority::INTERACTIVE);
+	/// <summary>
+	/// 初始化消息发送，内容已转义，用于固定文本与批量推送
+	/// </summary>
+	/// <param name="targetId">接收者qq</param>
+	/// <param name="data">已转义的内容</param>
+	/// <param name="priority">发送优先级，批量推送使用BULK</param>
+	PrivateMessageSender(long long targetId, JsonFragment data, SendPriority priority = SendPriority::INTERACTIVE);
 	/// <summary>
 	/// 设置发送的消息
 	/// </summary>
 	/// <param name="data">内容</param>
-	void setContent(std::string data);
+	void setContent(std::string_view data);
+	/// <summary>
+	/// 设置接收者班级，批量推送按班级选择发送账号
+	/// </summary>
+	/// <param name="classId">班级id</param>
+	void setClassId(long long classId);
 	/// <summary>
 	/// 发送
+	/// <para>当前线程存在ReplyBatch时，无回调的交互回复缓存至批次中合并发送</para>
+	/// </summary>
+	/// <param name="callback">收到go-cqhttp回执、超时或发送失败后执行，可为空</param>
+	void send(ApiCallback callback = nullptr);
+	/// <summary>
+	/// 不经过ReplyBatch，直接加入出站队列
+	/// </summary>
+	/// <param name="callback">收到go-cqhttp回执、超时或发送失败后执行，可为空</param>
+	void sendNow(ApiCallback callback = nullptr);
+};
+
+/// <summary>
+/// 回复合并
+/// <para>作用域内当前线程发送的私聊消息按接收者缓存，析构时每人合并发送，合并后超过MAX_MESSAGE_SIZE时另起一条</para>
+/// </summary>
+class ReplyBatch
+{
+private:
+	/// <summary>
+	/// 外层批次，支持嵌套
+	/// </summary>
+	ReplyBatch* previous;
+	/// <summary>
+	/// 缓存的回复【接收者qq，合并内容】，按首次出现顺序
+	/// </summary>
+	std::vector<std::pair<long long, JsonFragment>> replies;
+public:
+	/// <summary>
+	/// 开始合并当前线程的回复
+	/// </summary>
+	ReplyBatch();
+	/// <summary>
+	/// 发送所有缓存的回复
+	/// </summary>
+	~ReplyBatch();
+	ReplyBatch(const ReplyBatch&) = delete;
+	ReplyBatch& operator=(const ReplyBatch&) = delete;
+	/// <summary>
+	/// 缓存回复
+	/// </summary>
+	/// <param name="targetId">接收者qq</param>
+	/// <param name="data">已转义的内容</param>
+	void append(long long targetId, const JsonFragment& data);
+	/// <summary>
+	/// 立即发送所有缓存的回复
+	/// </summary>
+	void flush();
+	/// <summary>
+	/// 当前线程生效的批次
 	/// </summary>
-	void send();
+	/// <returns>无批次时返回nullptr</returns>
+	static ReplyBatch* current();
 };
\ No newline at end of file
@@ -1,13 +1,28 @@
 ﻿#include <string>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <json.hpp>
 
 #include "Exception.h"
+#include "EventFilter.h"
 #include "PrivateMessageGetter.h"
+#include "PrivateMessageSender.h"
 
 #include "QQMessage.h"
 #include "Tools.h"
+#include "RateLimiter.h"
+#include "ClientPool.h"
+#include "NotificationJob.h"
+#include "ReminderScheduler.h"
+#include "ReplyCache.h"
+#include "HttpFetcher.h"
+#include "File.h"
+#include "StorageQuota.h"
+#include "FileCache.h"
+#include "ClassArchiver.h"
+#include "SessionMap.h"
+#include <DataManager.hpp>
 /// <summary>
 /// 连接url
 /// </summary>
@@ -15,28 +30,72 @@ std::string connectUrl;
 /// <summary>
 /// 一级菜单状态记录【qq号，状态】
 /// </summary>
-std::map<long long, PeerStatus> status;
+SessionMap<PeerStatus> status;
 /// <summary>
 /// 二级菜单 注册 状态记录【qq号，注册信息】
 /// </summary>
-std::map<long long, RegInfo> regStatus;
+SessionMap<RegInfo> regStatus;
 /// <summary>
 /// 本地学生信息，可判断是否注册【qq号，id号】
 /// </summary>
-std::map<long long, StuInfo> getStuInfo;
+SessionMap<StuInfo> getStuInfo;
 /// <summary>
 /// 本地保存作业提交详情
 /// </summary>
-std::map<long long, HomeworkInfo> getHomeworkInfo;
+SessionMap<HomeworkInfo> getHomeworkInfo;
 /// <summary>
 /// 本地保存作业提交id，提交后销毁
 /// </summary>
 std::map<long long, long long>getSubmitId;
 /// <summary>
-/// ws客户端
+/// 作业列表下一页的位置，发送最后一页后销毁
 /// </summary>
-WebsocketClient wsClient;
+SessionMap<ListPage> listPage;
+/// <summary>
+/// 超出频率限制的消息记录，恢复后销毁
+/// </summary>
+SessionMap<FloodInfo> floodStatus;
+/// <summary>
+/// 会话锁，每个账号有各自的io线程，同一学生的消息持其分片锁依次处理，不同学生并行
+/// </summary>
+SessionLocks sessionLocks;
+/// <summary>
+/// 消息入口限流，每个qq号突发5条，每2秒恢复1条
+/// </summary>
+RateLimiter ingressLimiter(5, 0.5);
+/// <summary>
+/// 作业回复片段缓存
+/// </summary>
+ReplyCache replyCache;
 WebsocketServer wsServer;
+/// <summary>
+/// 通知批量发送任务，须在clientPool之前定义，保证后于出站队列析构
+/// </summary>
+NotificationJobManager notificationJobs;
+/// <summary>
+/// go-cqhttp连接池，每个账号的出站节奏与go-cqhttp config.yml中rate-limit一致（bucket: 1, frequency: 1）
+/// </summary>
+ClientPool clientPool(4096, 1, 1);
+/// <summary>
+/// 截止提醒，须在clientPool之后定义，保证先于clientPool析构
+/// </summary>
+ReminderScheduler reminderScheduler;
+/// <summary>
+/// 存储用量与配额，下载回调中会更新，须在httpFetcher之前定义，保证后于httpFetcher析构
+/// </summary>
+StorageQuota storageQuota;
+/// <summary>
+/// 提交文件读取缓存，共64MB、1024个文件，单个文件不超过1MB
+/// </summary>
+FileCache fileCache(64 * 1024 * 1024, 1024, 1024 * 1024);
+/// <summary>
+/// 附件下载，下载回调中会发送回复，须在clientPool之后定义，保证先于clientPool析构
+/// </summary>
+HttpFetcher httpFetcher(4, 16);
+/// <summary>
+/// 结课班级归档，每秒读写不超过4MB
+/// </summary>
+ClassArchiver classArchiver(4 * 1024 * 1024);
 
 void QQMessage::onOpen()
 {
@@ -45,64 +104,64 @@ void QQMessage::onOpen()
 }
 void QQMessage::onClose()
 {
-	std::cerr << "Client Closed." << std::endl << "Re-connecting..." << std::endl;
-#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
-	Sleep(15000);
-#else
-	sleep(15);
-#endif
-	wsClient.Connect("");
+	std::cerr << "Client Closed." << std::endl << "Re-connecting..." << std::endl;//由WebsocketClient按退避时间重连
 	return;
 }
 void QQMessage::onFail()
 {
-	std::cerr << "Client Connect Failed." << std::endl << "Re-connecting..." << std::endl;
-#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
-	Sleep(1000);
-#else
-	sleep(1);
-#endif
-	wsClient.Connect("");
+	std::cerr << "Client Connect Failed." << std::endl << "Re-connecting..." << std::endl;//由WebsocketClient按退避时间重连
 	return;
 }
 
 void QQMessage::readMessage(const std::string& message)
 {
-	auto decode = nlohmann::json::parse(message);//解析json
-	if (decode.contains("post_type"))//判断存在post_type
+	EventHeader header = EventFilter::scan(message);//预分类，心跳包与API回执无需解析
+	ReplyBatch batch;//处理本条消息产生的回复合并发送
+	if (header.kind == EventKind::PRIVATE_MESSAGE)//收到私聊消息
 	{
-		if (decode.at("post_type") == "meta_event") return; //收到心跳包
-		if (decode.at("post_type") == "message")
+		auto decode = nlohmann::json::parse(message);//解析json
+		PrivateMessageGetter getter(decode);//获取消息
+		std::lock_guard<std::mutex> lock(sessionLocks.of(getter.getSenderId()));
+		clientPool.bindSender(getter.getSenderId());//回复由收到消息的账号发出
+		if (ingressLimiter.tryAcquire(getter.getSenderId()))
 		{
-			if (decode.at("message_type") == "private")//收到私聊消息
-			{
-				PrivateMessageGetter getter(decode);//获取消息
-				AnaText(Tools::to_utf16(getter.getRawData()), getter.getSenderId());//对消息文本分析
-			}
-
+			floodStatus.erase(getter.getSenderId());
+			AnaText(getter.getRawData(), getter.getSenderId());//对消息文本分析
 		}
-	}
-	if (decode.contains("notice_type"))
-	{
-		if (decode.at("notice_type") == "offline_file")
+		else
 		{
-			AnaFile(decode.at("file").at("name"), decode.at("file").at("url"), decode.at("user_id"));
+			AnaThrottled(getter.getRawData(), getter.getSenderId());
 		}
+		return;
+	}
+	if (header.kind == EventKind::OFFLINE_FILE)
+	{
+		auto decode = nlohmann::json::parse(message);//解析json
+		std::lock_guard<std::mutex> lock(sessionLocks.of(decode.at("user_id").get<long long>()));
+		AnaFile(decode.at("file").at("name"), decode.at("file").at("url"), decode.at("file").value("size", 0LL), decode.at("user_id"));
+		return;
 	}
 	return;
 }
 
 void QQMessage::_InitClient(std::string url)
 {
-	connectUrl = "ws://" + url;
-	//设置回调函数
-	wsClient.SetOnOpenFunc(onOpen);
-	wsClient.SetOnCloseFunc(onClose);
-	wsClient.SetOnFailFunc(onFail);
-	wsClient.SetMessageFunc(readMessage);
-
-	if (wsClient.Connect(connectUrl) == false) throw WsConnectError("Connect to " + connectUrl + " failed.");
+	_InitClient(std::vector<std::string>{ url });
+}
 
+void QQMessage::_InitClient(std::vector<std::string> urls)
+{
+	std::vector<std::string> connectUrls;
+	for (auto& iter : urls)
+	{
+		connectUrls.push_back("ws://" + iter);
+	}
+	if (!connectUrls.empty()) connectUrl = connectUrls.front();
+#ifndef HTTPFETCHER_SSL
+	std::cerr << "Warning: built without HTTPFETCHER_SSL, https attachments cannot be downloaded." << std::endl;
+#endif
+	//设置回调函数，所有账号的消息进入同一处理流程
+	if (clientPool.init(connectUrls, onOpen, onClose, onFail, readMessage) == false) throw WsConnectError("Connect to go-cqhttp failed.");
 }
 
 void QQMessage::_InitServer(int port)
@@ -110,7 +169,35 @@ void QQMessage::_InitServer(int port)
 	wsServer.start(port);
 }
 
+void QQMessage::_InitStorage(bool compressText, unsigned long long studentQuotaMb, unsigned long long classQuotaMb)
+{
+	File::setTextCompression(compressText);
+	storageQuota.setLimits(studentQuotaMb * 1024 * 1024, classQuotaMb * 1024 * 1024);
+}
+
+void QQMessage::_InitScheduler()
+{
+	//继续上次未完成的通知，须在wsServer接受请求前载入，未连接时消息在出站队列中等待
+	notificationJobs.resume();
+	//本进程内新建、修改或删除作业时更新提醒并释放回复片段
+	DataManager::setAssignmentHandler([](unsigned long assignmentId)
+		{
+			replyCache.invalidate(assignmentId);
+			reminderScheduler.refresh(assignmentId);
+		});
+	reminderScheduler.start();
+	//本进程内结课的班级在后台归档
+	DataManager::setClassEndedHandler([](long classId)
+		{
+			classArchiver.add(classId);
+		});
+	classArchiver.start();
+}
+
 void QQMessage::_Stop()
 {
-	wsClient.Close("close connection");
+	reminderScheduler.stop();
+	notificationJobs.stop();
+	classArchiver.stop();
+	clientPool.close("close connection");
 }
@@ -1,6 +1,8 @@
 ﻿#pragma once
 #include "Analyst.h"
 #include "WebsocketServer.h"
+#include <string>
+#include <vector>
 
 /// <summary>
 /// 静态类
@@ -30,8 +32,25 @@ public:
 	/// </summary>
 	/// <param name="url">连接ip:端口</param>
 	static void _InitClient(std::string url = "127.0.0.1:6700");
+	/// <summary>
+	/// 初始化多个机器人账号的连接
+	/// </summary>
+	/// <param name="urls">各账号go-cqhttp的ip:端口</param>
+	static void _InitClient(std::vector<std::string> urls);
 	static void _InitServer(int port);
 	/// <summary>
+	/// 设置提交文件的存储方式
+	/// </summary>
+	/// <param name="compressText">正文与代码是否压缩存储，服务端以--compress开启</param>
+	/// <param name="studentQuotaMb">每个学生的存储配额（MB），0为不限</param>
+	/// <param name="classQuotaMb">每个班级的存储配额（MB），0为不限</param>
+	static void _InitStorage(bool compressText, unsigned long long studentQuotaMb = 1024, unsigned long long classQuotaMb = 0);
+	/// <summary>
+	/// 继续上次未完成的通知，载入未截止的作业并开始截止提醒，开始归档已结课的班级
+	/// <para>须在_InitServer之前调用</para>
+	/// </summary>
+	static void _InitScheduler();
+	/// <summary>
 	/// 关闭连接
 	/// </summary>
 	static void _Stop();
@@ -0,0 +1,70 @@
+﻿#include "RateLimiter.h"
+#include <algorithm>
+
+namespace
+{
+	/// <summary>
+	/// 桶数少于该值时不清理
+	/// </summary>
+	constexpr size_t SWEEP_MIN = 1024;
+}
+
+TokenBucket::TokenBucket(double capacity, double rate) :
+	capacity(capacity), rate(rate), tokens(capacity), last(std::chrono::steady_clock::now())
+{}
+
+void TokenBucket::refill()
+{
+	auto now = std::chrono::steady_clock::now();
+	std::chrono::duration<double> elapsed = now - last;
+	tokens = std::min(capacity, tokens + elapsed.count() * rate);
+	last = now;
+}
+
+bool TokenBucket::tryConsume(double count)
+{
+	refill();
+	if (tokens < count) return false;
+	tokens -= count;
+	return true;
+}
+
+double TokenBucket::waitTime(double count)
+{
+	refill();
+	if (tokens >= count) return 0;
+	return (count - tokens) / rate;
+}
+
+bool TokenBucket::full()
+{
+	refill();
+	return tokens >= capacity;
+}
+
+RateLimiter::RateLimiter(double capacity, double rate) :
+	capacity(capacity), rate(rate), sweepAt(SWEEP_MIN)
+{}
+
+void RateLimiter::sweep()
+{
+	for (auto iter = buckets.begin(); iter != buckets.end();)
+	{
+		if (iter->second.full()) iter = buckets.erase(iter);
+		else iter++;
+	}
+	sweepAt = std::max(SWEEP_MIN, buckets.size() * 2);
+}
+
+bool RateLimiter::tryAcquire(long long id)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto iter = buckets.find(id);
+	if (iter == buckets.end())
+	{
+		//新id加入前按需清理，map大小随活跃id数而非历史id数增长
+		if (buckets.size() >= sweepAt) sweep();
+		iter = buckets.emplace(id, TokenBucket(capacity, rate)).first;
+	}
+	return iter->second.tryConsume();
+}
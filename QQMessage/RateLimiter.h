@@ -0,0 +1,91 @@
+﻿#pragma once
+#include <chrono>
+#include <map>
+#include <mutex>
+
+/// <summary>
+/// 令牌桶
+/// </summary>
+class TokenBucket
+{
+private:
+	/// <summary>
+	/// 桶容量
+	/// </summary>
+	double capacity;
+	/// <summary>
+	/// 每秒补充令牌数
+	/// </summary>
+	double rate;
+	/// <summary>
+	/// 当前令牌数
+	/// </summary>
+	double tokens;
+	/// <summary>
+	/// 上次补充时间
+	/// </summary>
+	std::chrono::steady_clock::time_point last;
+	/// <summary>
+	/// 按经过时间补充令牌
+	/// </summary>
+	void refill();
+public:
+	/// <summary>
+	/// 初始化令牌桶，初始为满
+	/// </summary>
+	/// <param name="capacity">桶容量</param>
+	/// <param name="rate">每秒补充令牌数</param>
+	TokenBucket(double capacity, double rate);
+	/// <summary>
+	/// 尝试取出令牌
+	/// </summary>
+	/// <param name="count">令牌数</param>
+	/// <returns>令牌足够时取出并返回true</returns>
+	bool tryConsume(double count = 1);
+	/// <summary>
+	/// 距离令牌足够还需等待的时间
+	/// </summary>
+	/// <param name="count">令牌数</param>
+	/// <returns>等待秒数，令牌足够时返回0</returns>
+	double waitTime(double count = 1);
+	/// <summary>
+	/// 令牌是否已补满，满的桶与新建的桶等价
+	/// </summary>
+	bool full();
+};
+
+/// <summary>
+/// 按id分别限流
+/// </summary>
+class RateLimiter
+{
+private:
+	double capacity;
+	double rate;
+	std::mutex mtx;
+	/// <summary>
+	/// 令牌桶【id，令牌桶】
+	/// </summary>
+	std::map<long long, TokenBucket> buckets;
+	/// <summary>
+	/// 桶数达到该值时清理一次已补满的桶，清理后设为剩余桶数的两倍
+	/// </summary>
+	size_t sweepAt;
+	/// <summary>
+	/// 删除已补满的桶，这些id长时间未请求，再次请求时重新创建
+	/// </summary>
+	void sweep();
+public:
+	/// <summary>
+	/// 初始化限流器
+	/// </summary>
+	/// <param name="capacity">每个id的突发上限</param>
+	/// <param name="rate">每个id每秒补充令牌数</param>
+	RateLimiter(double capacity, double rate);
+	/// <summary>
+	/// 尝试通过
+	/// </summary>
+	/// <param name="id">qq号</param>
+	/// <returns>未超限返回true</returns>
+	bool tryAcquire(long long id);
+};
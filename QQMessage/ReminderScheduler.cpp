@@ -0,0 +1,137 @@
+﻿#include "ReminderScheduler.h"
+#include <ctime>
+#include <iterator>
+#include <iostream>
+#include <DataManager.hpp>
+
+#include "Analyst.h"
+
+namespace
+{
+	/// <summary>
+	/// 提醒时间，截止前秒数
+	/// </summary>
+	const long REMIND_BEFORE[] = { 24 * 3600, 3600 };
+}
+
+ReminderScheduler::ReminderScheduler() : wheel(time(nullptr)), stopping(false) {}
+
+ReminderScheduler::~ReminderScheduler()
+{
+	stop();
+}
+
+void ReminderScheduler::start()
+{
+	if (worker.joinable()) return;
+	try
+	{
+		auto assignmentList = DataManager::getOpenAssignmentList();
+		for (auto& iter : assignmentList)
+		{
+			schedule(iter.getId(), iter.getDeadline());
+		}
+		std::cerr << "Reminder loaded " << assignmentList.size() << " assignments." << std::endl;
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Reminder load failed: " << e.what() << std::endl;
+	}
+	worker = std::thread(&ReminderScheduler::run, this);
+}
+
+void ReminderScheduler::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		stopping = true;
+	}
+	cv.notify_all();
+	if (worker.joinable()) worker.join();
+}
+
+void ReminderScheduler::refresh(unsigned long assignmentId)
+{
+	try
+	{
+		DataManager::Assignment assignment(assignmentId);
+		schedule(assignmentId, assignment.getDeadline());
+	}
+	catch (DataManager::DMException::TARGET_NOT_FOUND&)
+	{
+		remove(assignmentId);//作业已删除
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Reminder refresh failed: " << e.what() << std::endl;
+	}
+}
+
+void ReminderScheduler::schedule(unsigned long assignmentId, long deadline)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto iter = reminders.find(assignmentId);
+	if (iter != reminders.end())
+	{
+		if (iter->second.deadline == deadline) return;
+		for (auto& timer : iter->second.timers) wheel.cancel(timer);
+		reminders.erase(iter);
+	}
+
+	Reminder reminder;
+	reminder.deadline = deadline;
+	long now = (long)time(nullptr);
+	for (long before : REMIND_BEFORE)
+	{
+		if (deadline - before <= now) continue;//已错过的提醒不补发
+		reminder.timers.push_back(wheel.add(deadline - before, [this, assignmentId, deadline] { remind(assignmentId, deadline); }));
+	}
+	if (!reminder.timers.empty()) reminders[assignmentId] = reminder;
+}
+
+void ReminderScheduler::remove(unsigned long assignmentId)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto iter = reminders.find(assignmentId);
+	if (iter == reminders.end()) return;
+	for (auto& timer : iter->second.timers) wheel.cancel(timer);
+	reminders.erase(iter);
+}
+
+void ReminderScheduler::remind(unsigned long assignmentId, long deadline)
+{
+	{
+		//最后一次提醒后不再跟踪该作业
+		std::lock_guard<std::mutex> lock(mtx);
+		auto iter = reminders.find(assignmentId);
+		if (iter != reminders.end() && iter->second.deadline == deadline && deadline - REMIND_BEFORE[std::size(REMIND_BEFORE) - 1] <= (long)time(nullptr))
+		{
+			reminders.erase(iter);
+		}
+	}
+	try
+	{
+		std::string jobId = sendDeadlineReminder(assignmentId, deadline);
+		if (!jobId.empty()) std::cerr << "Reminder of assignment " << assignmentId << " queued as job " << jobId << "." << std::endl;
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Reminder of assignment " << assignmentId << " failed: " << e.what() << std::endl;
+	}
+}
+
+void ReminderScheduler::run()
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while (!stopping)
+	{
+		auto due = wheel.advance(time(nullptr));
+		if (!due.empty())
+		{
+			lock.unlock();
+			for (auto& task : due) task();
+			lock.lock();
+		}
+		cv.wait_for(lock, std::chrono::seconds(1), [this] { return stopping; });
+	}
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "TimerWheel.h"
+
+/// <summary>
+/// 截止提醒
+/// <para>启动时从数据库载入未截止的作业，在截止前24小时与1小时向尚未提交的学生发送提醒</para>
+/// <para>作业新建或截止时间修改后通过refresh增量更新，不轮询数据库</para>
+/// </summary>
+class ReminderScheduler
+{
+public:
+	ReminderScheduler();
+	/// <summary>
+	/// 停止调度线程
+	/// </summary>
+	~ReminderScheduler();
+	/// <summary>
+	/// 载入未截止的作业并启动调度线程
+	/// </summary>
+	void start();
+	/// <summary>
+	/// 停止调度线程
+	/// </summary>
+	void stop();
+	/// <summary>
+	/// 重新读取作业的截止时间并更新提醒，作业已删除时取消提醒
+	/// </summary>
+	/// <param name="assignmentId">布置作业ID</param>
+	void refresh(unsigned long assignmentId);
+private:
+	/// <summary>
+	/// 按截止时间安排提醒，取消原有提醒
+	/// </summary>
+	/// <param name="assignmentId">布置作业ID</param>
+	/// <param name="deadline">截止时间（秒）</param>
+	void schedule(unsigned long assignmentId, long deadline);
+	/// <summary>
+	/// 取消提醒
+	/// </summary>
+	/// <param name="assignmentId">布置作业ID</param>
+	void remove(unsigned long assignmentId);
+	/// <summary>
+	/// 发送提醒
+	/// </summary>
+	/// <param name="assignmentId">布置作业ID</param>
+	/// <param name="deadline">安排提醒时的截止时间（秒）</param>
+	void remind(unsigned long assignmentId, long deadline);
+	/// <summary>
+	/// 调度线程，每秒转动时间轮
+	/// </summary>
+	void run();
+
+	/// <summary>
+	/// 已安排的提醒
+	/// </summary>
+	struct Reminder
+	{
+		long deadline;
+		std::vector<unsigned long long> timers;
+	};
+	TimerWheel wheel;
+	/// <summary>
+	/// 已安排的提醒【布置作业ID，提醒】
+	/// </summary>
+	std::map<unsigned long, Reminder> reminders;
+	std::mutex mtx;
+	std::condition_variable cv;
+	bool stopping;
+	std::thread worker;
+};
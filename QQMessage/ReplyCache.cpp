@@ -0,0 +1,76 @@
+﻿#include "ReplyCache.h"
+#include "Analyst.h"
+
+namespace
+{
+	/// <summary>
+	/// FNV-1a 64位哈希，可连续累加
+	/// </summary>
+	unsigned long long fnv1a(unsigned long long hash, const void* data, size_t size)
+	{
+		const unsigned char* p = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= p[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+}
+
+std::shared_ptr<const AssignmentFragments> ReplyCache::get(DataManager::Assignment& assignment)
+{
+	unsigned long id = assignment.getId();
+	unsigned long long version = fingerprint(assignment);
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		auto iter = entries.find(id);
+		if (iter != entries.end() && iter->second.version == version) return iter->second.fragments;
+	}
+
+	//锁外生成，并发生成同一作业时结果相同
+	auto fragments = render(assignment);
+	std::lock_guard<std::mutex> lock(mtx);
+	if (entries.size() >= CAPACITY && entries.count(id) == 0) entries.clear();
+	entries[id] = Entry{ version, fragments };
+	return fragments;
+}
+
+void ReplyCache::invalidate(unsigned long assignmentId)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	entries.erase(assignmentId);
+}
+
+size_t ReplyCache::size()
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return entries.size();
+}
+
+unsigned long long ReplyCache::fingerprint(DataManager::Assignment& assignment)
+{
+	std::string title = assignment.getTitle();
+	std::string description = assignment.getDescription();
+	long deadline = assignment.getDeadline();
+	size_t titleSize = title.size();
+	//标题长度参与哈希，避免标题与内容的分界变化后指纹相同
+	unsigned long long hash = 14695981039346656037ull;
+	hash = fnv1a(hash, &titleSize, sizeof(titleSize));
+	hash = fnv1a(hash, title.data(), title.size());
+	hash = fnv1a(hash, description.data(), description.size());
+	hash = fnv1a(hash, &deadline, sizeof(deadline));
+	return hash;
+}
+
+std::shared_ptr<const AssignmentFragments> ReplyCache::render(DataManager::Assignment& assignment)
+{
+	auto fragments = std::make_shared<AssignmentFragments>();
+	fragments->listTitle.append(u8"【作业" + std::to_string(assignment.getId()) + u8"】 ");
+	fragments->listTitle.append(assignment.getTitle());
+	fragments->listTitle.append(u8"  ");
+	fragments->deadline.append(TimeConvert(assignment.getDeadline()));
+	fragments->detail.append(u8"【作业标题】 " + assignment.getTitle() + "\r\n");
+	fragments->detail.append(u8"【作业内容】\r\n" + assignment.getDescription() + u8"\r\n");
+	return fragments;
+}
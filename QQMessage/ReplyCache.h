@@ -0,0 +1,75 @@
+﻿#pragma once
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <DataManager.hpp>
+
+#include "JsonWriter.h"
+
+/// <summary>
+/// 作业的固定回复片段，均已转义
+/// </summary>
+struct AssignmentFragments
+{
+	/// <summary>
+	/// 作业列表行首 【作业ID】 标题
+	/// </summary>
+	JsonFragment listTitle;
+	/// <summary>
+	/// 截止时间文本
+	/// </summary>
+	JsonFragment deadline;
+	/// <summary>
+	/// 作业详情的标题与内容段
+	/// </summary>
+	JsonFragment detail;
+};
+
+/// <summary>
+/// 回复模板缓存
+/// <para>同一班级的学生查询作业时生成相同的作业片段，按作业ID缓存转义后的结果，回复只需拼接片段</para>
+/// <para>数据库中没有版本号，以标题、内容与截止时间的指纹作为版本，客户端在其他进程中修改作业后同样失效；本进程内的修改由invalidate立即释放</para>
+/// </summary>
+class ReplyCache
+{
+public:
+	/// <summary>
+	/// 获取作业片段，版本不一致时重新生成
+	/// </summary>
+	/// <param name="assignment">已读取的作业</param>
+	/// <returns>片段，在缓存失效后仍然有效</returns>
+	std::shared_ptr<const AssignmentFragments> get(DataManager::Assignment& assignment);
+	/// <summary>
+	/// 释放作业片段
+	/// </summary>
+	/// <param name="assignmentId">布置作业ID</param>
+	void invalidate(unsigned long assignmentId);
+	/// <summary>
+	/// 缓存的作业数
+	/// </summary>
+	size_t size();
+private:
+	/// <summary>
+	/// 缓存的作业数上限，超出时清空
+	/// </summary>
+	static constexpr size_t CAPACITY = 4096;
+	struct Entry
+	{
+		unsigned long long version;
+		std::shared_ptr<const AssignmentFragments> fragments;
+	};
+	/// <summary>
+	/// 计算作业版本
+	/// </summary>
+	static unsigned long long fingerprint(DataManager::Assignment& assignment);
+	/// <summary>
+	/// 生成作业片段
+	/// </summary>
+	static std::shared_ptr<const AssignmentFragments> render(DataManager::Assignment& assignment);
+
+	std::mutex mtx;
+	/// <summary>
+	/// 作业片段【布置作业ID，片段】
+	/// </summary>
+	std::unordered_map<unsigned long, Entry> entries;
+};
@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <array>
+#include <map>
+#include <mutex>
+
+/// <summary>
+/// 按qq号保存的会话状态
+/// <para>只在查找、插入与删除时加锁，返回的引用在删除该qq号前有效</para>
+/// <para>同一qq号的状态只由持有其SessionLocks锁的线程读写，不同学生的消息可并行处理</para>
+/// </summary>
+template <typename T>
+class SessionMap
+{
+public:
+	size_t count(long long id) const
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		return items.count(id);
+	}
+	/// <summary>
+	/// 不存在时插入默认值
+	/// </summary>
+	T& operator[](long long id)
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		return items[id];
+	}
+	/// <summary>
+	/// 不存在时抛出std::out_of_range
+	/// </summary>
+	T& at(long long id)
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		return items.at(id);
+	}
+	/// <summary>
+	/// 已存在时不覆盖
+	/// </summary>
+	void insert(const std::pair<long long, T>& item)
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		items.insert(item);
+	}
+	void erase(long long id)
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		items.erase(id);
+	}
+private:
+	mutable std::mutex mtx;
+	std::map<long long, T> items;
+};
+
+/// <summary>
+/// 按qq号分片的会话锁，同一学生的消息依次处理
+/// </summary>
+class SessionLocks
+{
+public:
+	/// <summary>
+	/// 分片数，不同学生落在同一分片的概率较小
+	/// </summary>
+	static constexpr size_t SHARDS = 256;
+	std::mutex& of(long long id)
+	{
+		return shards[(unsigned long long)id % SHARDS];
+	}
+private:
+	std::array<std::mutex, SHARDS> shards;
+};
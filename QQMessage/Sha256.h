@@ -0,0 +1,35 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// <summary>
+/// SHA-256，可分段输入
+/// <para>内容寻址存储的文件指纹，不依赖OpenSSL</para>
+/// </summary>
+class Sha256
+{
+public:
+	Sha256();
+	/// <summary>
+	/// 追加数据
+	/// </summary>
+	void update(const void* data, size_t size);
+	void update(std::string_view data);
+	/// <summary>
+	/// 结束计算，之后不可再追加
+	/// </summary>
+	/// <returns>64位小写十六进制</returns>
+	std::string hexDigest();
+	/// <summary>
+	/// 计算一段数据的摘要
+	/// </summary>
+	static std::string hash(std::string_view data);
+private:
+	void transform(const unsigned char* block);
+
+	uint32_t state[8];
+	unsigned char buffer[64];
+	size_t buffered;
+	uint64_t length;
+};
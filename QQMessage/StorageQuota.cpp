@@ -0,0 +1,191 @@
+﻿#include "StorageQuota.h"
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+extern std::string rootPath;
+
+void StorageQuota::setLimits(unsigned long long studentLimit, unsigned long long classLimit)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	this->studentLimit = studentLimit;
+	this->classLimit = classLimit;
+}
+
+unsigned long long StorageQuota::getStudentLimit()
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return studentLimit;
+}
+
+unsigned long long StorageQuota::getClassLimit()
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return classLimit;
+}
+
+std::filesystem::path StorageQuota::usagePath(long long classId)
+{
+	std::filesystem::path path = rootPath;
+	return path / std::to_string(classId) / ".usage";
+}
+
+ClassUsage& StorageQuota::load(long long classId, bool* scanned)
+{
+	auto iter = classes.find(classId);
+	if (iter != classes.end()) return iter->second;
+	ClassUsage& usage = classes[classId];
+
+	std::ifstream in(usagePath(classId));
+	if (in)
+	{
+		//学生id\t字节数
+		long long studentId;
+		unsigned long long bytes;
+		while (in >> studentId >> bytes)
+		{
+			usage.students[studentId] = bytes;
+			usage.total += bytes;
+		}
+		return usage;
+	}
+
+	//旧数据没有.usage，遍历一次 班级id/学生id/作业id/文件
+	if (scanned) *scanned = true;
+	std::error_code ec;
+	std::filesystem::path classPath = usagePath(classId).parent_path();
+	for (auto& student : std::filesystem::directory_iterator(classPath, ec))
+	{
+		if (!student.is_directory()) continue;
+		long long studentId = std::atoll(student.path().filename().string().c_str());
+		unsigned long long bytes = 0;
+		for (auto& file : std::filesystem::recursive_directory_iterator(student.path(), ec))
+		{
+			std::string name = file.path().filename().string();
+			std::string extension = file.path().extension().string();
+			//跳过.info与下载、压缩、改名中的临时文件
+			if (!file.is_regular_file() || name[0] == '.' || extension == ".part" || extension == ".tmp" || extension == ".z") continue;
+			bytes += file.file_size(ec);
+		}
+		if (bytes == 0) continue;
+		usage.students[studentId] = bytes;
+		usage.total += bytes;
+	}
+	if (!usage.students.empty()) save(classId, usage);
+	return usage;
+}
+
+void StorageQuota::save(long long classId, const ClassUsage& usage)
+{
+	std::string content;
+	for (auto& iter : usage.students)
+	{
+		content += std::to_string(iter.first) + "\t" + std::to_string(iter.second) + "\n";
+	}
+	std::filesystem::path path = usagePath(classId);
+	std::filesystem::path tmpPath = path;
+	tmpPath += ".tmp";
+	std::error_code ec;
+	std::filesystem::create_directories(path.parent_path(), ec);
+	std::ofstream out;
+	out.open(tmpPath, std::ios::binary | std::ios::trunc);
+	out.write(content.data(), content.size());
+	out.close();
+	if (out) std::filesystem::rename(tmpPath, path, ec);
+	if (!out || ec) std::cerr << "Cannot write " << path.string() << std::endl;
+}
+
+void StorageQuota::add(long long classId, long long studentId, long long delta)
+{
+	if (delta == 0) return;
+	std::lock_guard<std::mutex> lock(mtx);
+	bool scanned = false;
+	ClassUsage& usage = load(classId, &scanned);
+	//文件已写入或删除后才记录用量，遍历的结果已包含本次变化
+	if (scanned) return;
+	unsigned long long& bytes = usage.students[studentId];
+	//不低于0，避免初始化时并发写入的文件被重复计算后下溢
+	unsigned long long change = delta < 0 ? std::min(bytes, (unsigned long long)-delta) : (unsigned long long)delta;
+	if (delta < 0)
+	{
+		bytes -= change;
+		usage.total -= change;
+		if (bytes == 0) usage.students.erase(studentId);
+	}
+	else
+	{
+		bytes += change;
+		usage.total += change;
+	}
+	save(classId, usage);
+}
+
+unsigned long long StorageQuota::available(long long classId, long long studentId)
+{
+	ClassUsage& usage = load(classId);
+	auto held = reserved.find(classId);
+	auto bytesOf = [studentId](const ClassUsage& usage)
+	{
+		auto iter = usage.students.find(studentId);
+		return iter == usage.students.end() ? 0ull : iter->second;
+	};
+	unsigned long long result = ULLONG_MAX;
+	if (studentLimit > 0)
+	{
+		unsigned long long used = bytesOf(usage) + (held == reserved.end() ? 0 : bytesOf(held->second));
+		result = std::min(result, used >= studentLimit ? 0 : studentLimit - used);
+	}
+	if (classLimit > 0)
+	{
+		unsigned long long used = usage.total + (held == reserved.end() ? 0 : held->second.total);
+		result = std::min(result, used >= classLimit ? 0 : classLimit - used);
+	}
+	return result;
+}
+
+unsigned long long StorageQuota::remaining(long long classId, long long studentId)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return available(classId, studentId);
+}
+
+unsigned long long StorageQuota::reserve(long long classId, long long studentId, unsigned long long bytes)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	bytes = std::min(bytes, available(classId, studentId));
+	if (bytes == 0) return 0;
+	ClassUsage& held = reserved[classId];
+	held.students[studentId] += bytes;
+	held.total += bytes;
+	return bytes;
+}
+
+void StorageQuota::release(long long classId, long long studentId, unsigned long long bytes)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto held = reserved.find(classId);
+	if (held == reserved.end()) return;
+	auto iter = held->second.students.find(studentId);
+	if (iter == held->second.students.end()) return;
+	bytes = std::min(bytes, iter->second);
+	iter->second -= bytes;
+	held->second.total -= bytes;
+	if (iter->second == 0) held->second.students.erase(iter);
+	if (held->second.students.empty()) reserved.erase(held);
+}
+
+unsigned long long StorageQuota::getStudentUsage(long long classId, long long studentId)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	ClassUsage& usage = load(classId);
+	auto iter = usage.students.find(studentId);
+	return iter == usage.students.end() ? 0 : iter->second;
+}
+
+ClassUsage StorageQuota::getClassUsage(long long classId)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return load(classId);
+}
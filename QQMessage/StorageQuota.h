@@ -0,0 +1,85 @@
+﻿#pragma once
+#include <filesystem>
+#include <map>
+#include <mutex>
+
+/// <summary>
+/// 班级的存储用量
+/// </summary>
+struct ClassUsage
+{
+	unsigned long long total = 0;
+	/// <summary>
+	/// 【学生id，字节数】
+	/// </summary>
+	std::map<long long, unsigned long long> students;
+};
+
+/// <summary>
+/// 存储用量统计与配额
+/// <para>提交清单每次变化时按差值更新学生与班级的用量，持久化于 rootPath/班级id/.usage，查询不扫描目录</para>
+/// <para>.usage不存在时（旧数据）遍历一次班级目录初始化</para>
+/// <para>下载开始时预留配额，完成后记录实际用量并释放预留，并发的下载合计不超过剩余配额</para>
+/// </summary>
+class StorageQuota
+{
+public:
+	/// <summary>
+	/// 设置配额，0为不限
+	/// </summary>
+	/// <param name="studentLimit">每个学生的字节数上限</param>
+	/// <param name="classLimit">每个班级的字节数上限</param>
+	void setLimits(unsigned long long studentLimit, unsigned long long classLimit);
+	unsigned long long getStudentLimit();
+	unsigned long long getClassLimit();
+	/// <summary>
+	/// 记录用量变化
+	/// </summary>
+	/// <param name="delta">增加的字节数，删除时为负</param>
+	void add(long long classId, long long studentId, long long delta);
+	/// <summary>
+	/// 学生与班级配额中较小的剩余量，已扣除下载中的预留
+	/// </summary>
+	/// <returns>字节数，不限时为ULLONG_MAX</returns>
+	unsigned long long remaining(long long classId, long long studentId);
+	/// <summary>
+	/// 为一次下载预留配额
+	/// </summary>
+	/// <param name="bytes">希望预留的字节数</param>
+	/// <returns>实际预留的字节数，不超过剩余量，配额已满时为0</returns>
+	unsigned long long reserve(long long classId, long long studentId, unsigned long long bytes);
+	/// <summary>
+	/// 下载结束后释放预留，成功时先以add记录实际用量
+	/// </summary>
+	/// <param name="bytes">reserve返回的字节数</param>
+	void release(long long classId, long long studentId, unsigned long long bytes);
+	unsigned long long getStudentUsage(long long classId, long long studentId);
+	ClassUsage getClassUsage(long long classId);
+private:
+	/// <summary>
+	/// 取班级用量，首次使用时从.usage读取，调用时须持有锁
+	/// </summary>
+	/// <param name="scanned">.usage不存在、遍历目录初始化时置为true</param>
+	ClassUsage& load(long long classId, bool* scanned = nullptr);
+	/// <summary>
+	/// 先写.usage.tmp再改名，调用时须持有锁
+	/// </summary>
+	void save(long long classId, const ClassUsage& usage);
+	/// <summary>
+	/// 扣除用量与预留后的剩余量，调用时须持有锁
+	/// </summary>
+	unsigned long long available(long long classId, long long studentId);
+	std::filesystem::path usagePath(long long classId);
+
+	std::mutex mtx;
+	unsigned long long studentLimit = 1024ull * 1024 * 1024;
+	unsigned long long classLimit = 0;
+	/// <summary>
+	/// 已载入的班级【班级id，用量】
+	/// </summary>
+	std::map<long long, ClassUsage> classes;
+	/// <summary>
+	/// 下载中预留的字节数【班级id，预留量】，不持久化
+	/// </summary>
+	std::map<long long, ClassUsage> reserved;
+};
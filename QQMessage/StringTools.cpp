@@ -0,0 +1,78 @@
+﻿#include "StringTools.h"
+#include <charconv>
+#include <algorithm>
+
+namespace
+{
+	const std::string_view whitespace = " \t\r\n";
+}
+
+SplitIterator::SplitIterator(std::string_view rest, const std::bitset<256>* seperator) :
+	rest(rest), seperator(seperator)
+{
+	++(*this);
+}
+
+SplitIterator& SplitIterator::operator++()
+{
+	size_t i = 0;
+	//找到首个不等于分隔符的字符
+	while (i < rest.size() && seperator->test(static_cast<unsigned char>(rest[i]))) i++;
+	//找到下一个分隔符
+	size_t j = i;
+	while (j < rest.size() && !seperator->test(static_cast<unsigned char>(rest[j]))) j++;
+	if (i == j)
+	{
+		current = std::string_view();
+		rest = std::string_view();
+		return *this;
+	}
+	current = rest.substr(i, j - i);
+	rest.remove_prefix(j);
+	return *this;
+}
+
+SplitIterator SplitIterator::operator++(int)
+{
+	SplitIterator tmp = *this;
+	++(*this);
+	return tmp;
+}
+
+SplitRange::SplitRange(std::string_view s, std::string_view seperator) :
+	s(s)
+{
+	for (char c : seperator) table.set(static_cast<unsigned char>(c));
+}
+
+std::string_view StringTools::trimLeft(std::string_view s)
+{
+	size_t pos = s.find_first_not_of(whitespace);
+	return pos == std::string_view::npos ? std::string_view() : s.substr(pos);
+}
+
+std::string_view StringTools::trim(std::string_view s)
+{
+	s = trimLeft(s);
+	return s.substr(0, s.find_last_not_of(whitespace) + 1);
+}
+
+std::string_view StringTools::stripPrefix(std::string_view data, size_t len)
+{
+	return trimLeft(data.substr(std::min(len, data.size())));
+}
+
+SplitRange StringTools::split(std::string_view s, std::string_view seperator)
+{
+	return SplitRange(s, seperator);
+}
+
+bool StringTools::parseInt(std::string_view s, long long& value)
+{
+	s = trim(s);
+	if (s.empty()) return false;
+	const char* first = s.data();
+	if (*first == '+' && s.size() > 1 && s[1] != '-') first++;
+	auto result = std::from_chars(first, s.data() + s.size(), value);
+	return result.ec == std::errc() && result.ptr == s.data() + s.size();
+}
@@ -0,0 +1,97 @@
+﻿#pragma once
+#include <string_view>
+#include <bitset>
+#include <iterator>
+
+/// <summary>
+/// 字符串分隔迭代器
+/// <para>依次返回分隔符之间的非空子串，不复制原始字符串</para>
+/// </summary>
+class SplitIterator
+{
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = std::string_view;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const std::string_view*;
+	using reference = const std::string_view&;
+
+	SplitIterator() = default;
+	SplitIterator(std::string_view rest, const std::bitset<256>* seperator);
+
+	reference operator*() const { return current; }
+	pointer operator->() const { return &current; }
+	SplitIterator& operator++();
+	SplitIterator operator++(int);
+	bool operator==(const SplitIterator& other) const { return current.data() == other.current.data() && current.size() == other.current.size(); }
+	bool operator!=(const SplitIterator& other) const { return !(*this == other); }
+private:
+	/// <summary>
+	/// 剩余未分隔部分
+	/// </summary>
+	std::string_view rest;
+	/// <summary>
+	/// 当前子串，结束时为空
+	/// </summary>
+	std::string_view current;
+	const std::bitset<256>* seperator = nullptr;
+};
+
+/// <summary>
+/// 字符串分隔结果，用于range-for
+/// </summary>
+class SplitRange
+{
+public:
+	SplitRange(std::string_view s, std::string_view seperator);
+	SplitIterator begin() const { return SplitIterator(s, &table); }
+	SplitIterator end() const { return SplitIterator(); }
+private:
+	std::string_view s;
+	/// <summary>
+	/// 分隔符查找表
+	/// </summary>
+	std::bitset<256> table;
+};
+
+/// <summary>
+/// 静态类
+/// <para>基于string_view的字符串工具，不分配内存</para>
+/// </summary>
+class StringTools
+{
+public:
+	/// <summary>
+	/// 删除前端空白
+	/// </summary>
+	/// <param name="s">字符串</param>
+	/// <returns>子串</returns>
+	static std::string_view trimLeft(std::string_view s);
+	/// <summary>
+	/// 删除两端空白
+	/// </summary>
+	/// <param name="s">字符串</param>
+	/// <returns>子串</returns>
+	static std::string_view trim(std::string_view s);
+	/// <summary>
+	/// 删除前序命令及其后的空白
+	/// </summary>
+	/// <param name="data">原始消息</param>
+	/// <param name="len">前序命令字节长度</param>
+	/// <returns>二级消息</returns>
+	static std::string_view stripPrefix(std::string_view data, size_t len);
+	/// <summary>
+	/// 字符串分隔
+	/// </summary>
+	/// <param name="s">原始字符串</param>
+	/// <param name="seperator">分隔符 可多个</param>
+	/// <returns>可迭代的分隔结果</returns>
+	static SplitRange split(std::string_view s, std::string_view seperator);
+	/// <summary>
+	/// 解析整数，允许两端空白
+	/// </summary>
+	/// <param name="s">字符串</param>
+	/// <param name="value">解析结果</param>
+	/// <returns>是否为完整的整数</returns>
+	static bool parseInt(std::string_view s, long long& value);
+};
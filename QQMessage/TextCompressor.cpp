@@ -0,0 +1,532 @@
+﻿#include "TextCompressor.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	/// <summary>
+	/// 魔数，首字节不是合法的utf8开头，不会与文本文件混淆
+	/// </summary>
+	const char MAGIC[] = { '\x89', 'H', 'C', 'Z' };
+	/// <summary>
+	/// 格式与字典版本，更换字典时递增，旧版本仍须可读
+	/// </summary>
+	const char VERSION = 1;
+	constexpr size_t HEADER_SIZE = sizeof(MAGIC) + 1;
+	constexpr size_t MIN_MATCH = 4;
+	constexpr size_t MAX_OFFSET = 65535;
+	constexpr int HASH_BITS = 15;
+	/// <summary>
+	/// 每个位置最多比较的候选数
+	/// </summary>
+	constexpr int MAX_CHAIN = 32;
+
+	/// <summary>
+	/// 预设字典，由以往提交中常见的代码片段与作业用语整理而成，越常用的越靠后
+	/// </summary>
+	const std::string_view DICTIONARY = u8R"dict(</head><body></body></html><div class="
+SELECT * FROM  WHERE  ORDER BY  GROUP BY  INSERT INTO  VALUES (
+import java.util.Scanner;
+import java.util.*;
+public class Main {
+    public static void main(String[] args) {
+        Scanner sc = new Scanner(System.in);
+        System.out.println(
+    }
+}
+import numpy as np
+import matplotlib.pyplot as plt
+def main():
+if __name__ == "__main__":
+    main()
+for i in range(len(
+    return
+print(
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+using namespace std;
+typedef long long ll;
+const int N =
+struct Node {
+class Solution {
+public:
+private:
+    int n, m;
+    scanf("%d", &n);
+    scanf("%d%d", &n, &m);
+    printf("%d\n",
+    printf("%d ",
+    printf("\n");
+    cin >> n;
+    cout <<
+ << endl;
+    while (
+    if (
+    } else {
+    else if (
+    for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+        for (int j = 0; j < m; j++) {
+            if (a[i] > a[j]) {
+    return 0;
+}
+int main() {
+int main()
+{
+    return 0;
+}
+实验报告
+实验目的：
+实验内容：
+实验步骤：
+实验结果：
+实验总结：
+运行结果如下：
+源代码如下：
+解：由题意得，
+证明：因为
+所以
+因此
+由于
+根据
+其中
+则有
+可得
+即
+故
+第一题
+第二题
+第三题
+第四题
+第五题
+答：
+答案：
+题目：
+作业
+姓名：
+学号：
+班级：
+)dict";
+
+	uint32_t read32(const char* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	void writeLE32(std::string& out, uint32_t value)
+	{
+		for (int i = 0; i < 4; i++) out.push_back((char)((value >> (8 * i)) & 0xFF));
+	}
+
+	uint32_t readLE32(const char* p)
+	{
+		uint32_t value = 0;
+		for (int i = 3; i >= 0; i--) value = (value << 8) | (unsigned char)p[i];
+		return value;
+	}
+
+	/// <summary>
+	/// 写入超出4位的长度，每字节255表示继续
+	/// </summary>
+	void writeLength(std::string& out, size_t length)
+	{
+		while (length >= 255)
+		{
+			out.push_back((char)255);
+			length -= 255;
+		}
+		out.push_back((char)length);
+	}
+
+	bool readLength(std::string_view data, size_t& pos, size_t& length)
+	{
+		unsigned char byte;
+		do
+		{
+			if (pos >= data.size()) return false;
+			byte = (unsigned char)data[pos++];
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+
+	/// <summary>
+	/// 一组序列：字面量，然后是距离与匹配长度；最后一组只有字面量
+	/// </summary>
+	void writeSequence(std::string& out, std::string_view literals, size_t offset, size_t matchLength)
+	{
+		size_t literalLength = literals.size();
+		size_t matchCode = matchLength >= MIN_MATCH ? matchLength - MIN_MATCH : 0;
+		out.push_back((char)(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15)));
+		if (literalLength >= 15) writeLength(out, literalLength - 15);
+		out.append(literals);
+		if (matchLength < MIN_MATCH) return;
+		out.push_back((char)(offset & 0xFF));
+		out.push_back((char)(offset >> 8));
+		if (matchCode >= 15) writeLength(out, matchCode - 15);
+	}
+}
+
+bool TextCompressor::isCompressed(std::string_view head)
+{
+	return head.size() >= HEADER_SIZE && memcmp(head.data(), MAGIC, sizeof(MAGIC)) == 0 && head[sizeof(MAGIC)] == VERSION;
+}
+
+std::string TextCompressor::compressBlock(std::string_view block)
+{
+	std::string buffer;
+	buffer.reserve(DICTIONARY.size() + block.size());
+	buffer.append(DICTIONARY).append(block);
+	const char* data = buffer.data();
+	size_t size = buffer.size();
+	std::vector<int> head((size_t)1 << HASH_BITS, -1);
+	std::vector<int> prev(size, -1);
+	auto insert = [&](size_t pos)
+	{
+		if (pos + MIN_MATCH > size) return;
+		uint32_t hash = (read32(data + pos) * 2654435761u) >> (32 - HASH_BITS);
+		prev[pos] = head[hash];
+		head[hash] = (int)pos;
+	};
+	for (size_t i = 0; i < DICTIONARY.size(); i++) insert(i);
+
+	std::string out;
+	out.reserve(block.size());
+	size_t pos = DICTIONARY.size(), anchor = pos;
+	while (pos + MIN_MATCH <= size)
+	{
+		size_t bestLength = 0, bestOffset = 0;
+		uint32_t hash = (read32(data + pos) * 2654435761u) >> (32 - HASH_BITS);
+		int depth = 0;
+		for (int candidate = head[hash]; candidate >= 0 && depth < MAX_CHAIN && pos - candidate <= MAX_OFFSET; candidate = prev[candidate], depth++)
+		{
+			size_t length = 0;
+			while (pos + length < size && data[candidate + length] == data[pos + length]) length++;
+			if (length > bestLength)
+			{
+				bestLength = length;
+				bestOffset = pos - candidate;
+			}
+		}
+		if (bestLength < MIN_MATCH)
+		{
+			insert(pos++);
+			continue;
+		}
+		writeSequence(out, std::string_view(data + anchor, pos - anchor), bestOffset, bestLength);
+		for (size_t end = pos + bestLength; pos < end; pos++) insert(pos);
+		anchor = pos;
+		if (out.size() >= block.size()) return "";
+	}
+	writeSequence(out, std::string_view(data + anchor, size - anchor), 0, 0);
+	if (out.size() >= block.size()) return "";
+	return out;
+}
+
+bool TextCompressor::decompressBlock(std::string_view data, size_t rawSize, std::string& out)
+{
+	std::string buffer;
+	buffer.reserve(DICTIONARY.size() + rawSize);
+	buffer.append(DICTIONARY);
+	size_t limit = DICTIONARY.size() + rawSize;
+	size_t pos = 0;
+	while (true)
+	{
+		if (pos >= data.size()) return false;
+		unsigned char token = (unsigned char)data[pos++];
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !readLength(data, pos, literalLength)) return false;
+		if (literalLength > data.size() - pos || buffer.size() + literalLength > limit) return false;
+		buffer.append(data.substr(pos, literalLength));
+		pos += literalLength;
+		if (pos == data.size()) break;
+
+		if (data.size() - pos < 2) return false;
+		size_t offset = (unsigned char)data[pos] | ((size_t)(unsigned char)data[pos + 1] << 8);
+		pos += 2;
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !readLength(data, pos, matchLength)) return false;
+		matchLength += MIN_MATCH;
+		if (offset == 0 || offset > buffer.size() || buffer.size() + matchLength > limit) return false;
+		//匹配可与自身重叠，逐字节复制
+		size_t from = buffer.size() - offset;
+		for (size_t i = 0; i < matchLength; i++) buffer.push_back(buffer[from + i]);
+	}
+	if (buffer.size() != limit) return false;
+	out.assign(buffer, DICTIONARY.size(), std::string::npos);
+	return true;
+}
+
+void TextCompressor::appendBlock(std::string& out, std::string_view block)
+{
+	std::string compressed = compressBlock(block);
+	writeLE32(out, (uint32_t)block.size());
+	//存储长度等于原长度表示未压缩
+	if (compressed.empty())
+	{
+		writeLE32(out, (uint32_t)block.size());
+		out.append(block);
+	}
+	else
+	{
+		writeLE32(out, (uint32_t)compressed.size());
+		out.append(compressed);
+	}
+}
+
+bool TextCompressor::readBlock(std::istream& in, std::string& block)
+{
+	char header[8];
+	if (!in.read(header, sizeof(header))) return false;
+	uint32_t rawSize = readLE32(header), storedSize = readLE32(header + 4);
+	block.clear();
+	if (rawSize == 0) return storedSize == 0;
+	if (rawSize > BLOCK_SIZE || storedSize > rawSize) return false;
+	std::string stored(storedSize, '\0');
+	if (!in.read(&stored[0], storedSize)) return false;
+	if (storedSize == rawSize)
+	{
+		block = std::move(stored);
+		return true;
+	}
+	return decompressBlock(stored, rawSize, block);
+}
+
+std::string TextCompressor::compress(std::string_view data)
+{
+	std::string out(MAGIC, sizeof(MAGIC));
+	out.push_back(VERSION);
+	for (size_t pos = 0; pos < data.size(); pos += BLOCK_SIZE)
+	{
+		appendBlock(out, data.substr(pos, BLOCK_SIZE));
+	}
+	writeLE32(out, 0);
+	writeLE32(out, 0);
+	//原数据恰好以魔数开头时必须保存为压缩格式，否则读取时会被误认
+	if (out.size() >= data.size() && !isCompressed(data)) return std::string(data);
+	return out;
+}
+
+bool TextCompressor::decompress(std::string_view data, std::string& out)
+{
+	if (!isCompressed(data))
+	{
+		out.assign(data);
+		return true;
+	}
+	out.clear();
+	size_t pos = HEADER_SIZE;
+	std::string block;
+	while (true)
+	{
+		if (data.size() - pos < 8) return false;
+		uint32_t rawSize = readLE32(data.data() + pos), storedSize = readLE32(data.data() + pos + 4);
+		pos += 8;
+		if (rawSize == 0) return storedSize == 0;
+		if (rawSize > BLOCK_SIZE || storedSize > rawSize || storedSize > data.size() - pos) return false;
+		std::string_view stored = data.substr(pos, storedSize);
+		pos += storedSize;
+		if (storedSize == rawSize)
+		{
+			out.append(stored);
+			continue;
+		}
+		if (!decompressBlock(stored, rawSize, block)) return false;
+		out.append(block);
+	}
+}
+
+bool TextCompressor::compressFile(const std::filesystem::path& path)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in) return false;
+	std::string block(BLOCK_SIZE, '\0');
+	in.read(&block[0], HEADER_SIZE);
+	std::string_view head(block.data(), (size_t)in.gcount());
+	if (isCompressed(head)) return false;
+	bool startsWithMagic = head.size() >= sizeof(MAGIC) && memcmp(head.data(), MAGIC, sizeof(MAGIC)) == 0;
+	in.clear();
+	in.seekg(0);
+
+	std::filesystem::path tmpPath = path;
+	tmpPath += ".z";
+	std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+	std::string chunk(MAGIC, sizeof(MAGIC));
+	chunk.push_back(VERSION);
+	unsigned long long rawTotal = 0, storedTotal = 0;
+	while (in.read(&block[0], BLOCK_SIZE) || in.gcount() > 0)
+	{
+		size_t size = (size_t)in.gcount();
+		rawTotal += size;
+		appendBlock(chunk, std::string_view(block.data(), size));
+		storedTotal += chunk.size();
+		out.write(chunk.data(), chunk.size());
+		chunk.clear();
+	}
+	writeLE32(chunk, 0);
+	writeLE32(chunk, 0);
+	storedTotal += chunk.size();
+	out.write(chunk.data(), chunk.size());
+	out.close();
+
+	std::error_code ec;
+	if (in.bad() || !out || (storedTotal >= rawTotal && !startsWithMagic))
+	{
+		std::filesystem::remove(tmpPath, ec);
+		return false;
+	}
+	//改名替换：文件若是blob的硬链接，blob内容不受影响
+	std::filesystem::rename(tmpPath, path, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tmpPath, ec);
+		return false;
+	}
+	return true;
+}
+
+bool TextCompressor::readFile(const std::filesystem::path& path, std::string& out, unsigned long long offset, unsigned long long length)
+{
+	Reader reader(path, offset, length);
+	out.clear();
+	std::string chunk;
+	while (reader.read(chunk)) out += chunk;
+	return !reader.failed();
+}
+
+bool TextCompressor::contentSize(const std::filesystem::path& path, unsigned long long& size, unsigned long long offset, unsigned long long length)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in) return false;
+	in.seekg(offset);
+	std::string head(HEADER_SIZE, '\0');
+	in.read(&head[0], (std::streamsize)std::min<unsigned long long>(HEADER_SIZE, length));
+	head.resize((size_t)in.gcount());
+	if (!isCompressed(head))
+	{
+		if (length != ULLONG_MAX)
+		{
+			size = length;
+			return true;
+		}
+		std::error_code ec;
+		size = std::filesystem::file_size(path, ec);
+		return !ec;
+	}
+	size = 0;
+	char header[8];
+	while (in.read(header, sizeof(header)))
+	{
+		uint32_t rawSize = readLE32(header), storedSize = readLE32(header + 4);
+		if (rawSize == 0) return storedSize == 0;
+		if (rawSize > BLOCK_SIZE || storedSize > rawSize) return false;
+		size += rawSize;
+		in.seekg(storedSize, std::ios::cur);
+	}
+	return false;
+}
+
+TextCompressor::Reader::Reader(const std::filesystem::path& path, unsigned long long offset, unsigned long long length) :
+	in(path, std::ios::binary), compressed(false), finished(false), error(false), left(length)
+{
+	if (offset > 0) in.seekg(offset);
+	if (!in)
+	{
+		finished = error = true;
+		return;
+	}
+	pending.resize(HEADER_SIZE);
+	pending.resize(readRaw(&pending[0], HEADER_SIZE));
+	if (isCompressed(pending))
+	{
+		compressed = true;
+		pending.clear();
+	}
+}
+
+bool TextCompressor::Reader::read(std::string& chunk)
+{
+	if (finished) return false;
+	if (compressed)
+	{
+		std::streamoff start = in.tellg();
+		//块头损坏时不读出数据范围之外的内容
+		if (!readBlock(in, chunk) || (unsigned long long)(in.tellg() - start) > left)
+		{
+			finished = error = true;
+			return false;
+		}
+		left -= in.tellg() - start;
+		if (chunk.empty()) finished = true;
+		return !finished;
+	}
+	chunk.swap(pending);
+	pending.clear();
+	size_t start = chunk.size();
+	chunk.resize(BLOCK_SIZE);
+	size_t count = readRaw(&chunk[start], BLOCK_SIZE - start);
+	chunk.resize(start + count);
+	if (in.bad()) error = true;
+	if (chunk.empty() || count < BLOCK_SIZE - start) finished = true;
+	return !chunk.empty();
+}
+
+size_t TextCompressor::Reader::read(char* buffer, size_t size)
+{
+	size_t filled = 0;
+	if (!compressed)
+	{
+		size_t head = std::min(pending.size(), size);
+		memcpy(buffer, pending.data(), head);
+		pending.erase(0, head);
+		filled = head;
+		if (filled < size && !finished)
+		{
+			size_t count = readRaw(buffer + filled, size - filled);
+			if (count < size - filled) finished = true;
+			filled += count;
+			if (in.bad()) error = true;
+		}
+		return filled;
+	}
+	while (filled < size)
+	{
+		if (blockOffset == block.size())
+		{
+			blockOffset = 0;
+			if (!read(block)) break;
+		}
+		size_t count = std::min(size - filled, block.size() - blockOffset);
+		memcpy(buffer + filled, block.data() + blockOffset, count);
+		blockOffset += count;
+		filled += count;
+	}
+	return filled;
+}
+
+size_t TextCompressor::Reader::readRaw(char* buffer, size_t size)
+{
+	size = (size_t)std::min<unsigned long long>(size, left);
+	if (size == 0) return 0;
+	in.read(buffer, size);
+	size_t count = (size_t)in.gcount();
+	left -= count;
+	return count;
+}
+
+bool TextCompressor::Reader::failed() const
+{
+	return error;
+}
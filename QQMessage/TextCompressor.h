@@ -0,0 +1,114 @@
+﻿#pragma once
+#include <climits>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+/// <summary>
+/// 正文与代码文件的压缩存储
+/// <para>LZ77按64K分块压缩，每块以内置的预设字典为前缀，字典收录常见代码片段与作业用语，小文件也能压缩</para>
+/// <para>文件以魔数开头，没有魔数的旧文件按原样读取；压缩后不变小的文件保持原样</para>
+/// </summary>
+class TextCompressor
+{
+public:
+	/// <summary>
+	/// 分块大小，解压时最多缓存一块
+	/// </summary>
+	static constexpr size_t BLOCK_SIZE = 65536;
+	/// <summary>
+	/// 是否为压缩格式
+	/// </summary>
+	/// <param name="head">文件开头的数据，不足5字节时返回false</param>
+	static bool isCompressed(std::string_view head);
+	/// <summary>
+	/// 压缩一段数据
+	/// </summary>
+	/// <returns>压缩格式；压缩后不变小时返回原数据</returns>
+	static std::string compress(std::string_view data);
+	/// <summary>
+	/// 解压一段数据，非压缩格式时原样返回
+	/// </summary>
+	/// <returns>数据损坏时返回false</returns>
+	static bool decompress(std::string_view data, std::string& out);
+	/// <summary>
+	/// 分块压缩文件，先写 文件.z 再改名替换
+	/// </summary>
+	/// <returns>文件被替换返回true；已压缩、压缩后不变小或失败时返回false，原文件不变</returns>
+	static bool compressFile(const std::filesystem::path& path);
+	/// <summary>
+	/// 读取整个文件，压缩格式时解压
+	/// </summary>
+	/// <param name="offset">数据在文件中的起始位置，读取归档中的一项时使用</param>
+	/// <param name="length">数据长度，默认到文件结尾</param>
+	/// <returns>文件不存在或数据损坏时返回false</returns>
+	static bool readFile(const std::filesystem::path& path, std::string& out, unsigned long long offset = 0, unsigned long long length = ULLONG_MAX);
+	/// <summary>
+	/// 解压后的大小，压缩格式时只读取各块的块头
+	/// </summary>
+	/// <returns>文件不存在或数据损坏时返回false</returns>
+	static bool contentSize(const std::filesystem::path& path, unsigned long long& size, unsigned long long offset = 0, unsigned long long length = ULLONG_MAX);
+
+	/// <summary>
+	/// 分块读取文件，压缩格式时逐块解压，否则按原样读取
+	/// </summary>
+	class Reader
+	{
+	public:
+		/// <param name="offset">数据在文件中的起始位置</param>
+		/// <param name="length">数据长度，默认到文件结尾</param>
+		explicit Reader(const std::filesystem::path& path, unsigned long long offset = 0, unsigned long long length = ULLONG_MAX);
+		/// <summary>
+		/// 读取下一段
+		/// </summary>
+		/// <param name="chunk">解压后的数据，不超过BLOCK_SIZE</param>
+		/// <returns>没有更多数据或出错时返回false</returns>
+		bool read(std::string& chunk);
+		/// <summary>
+		/// 读满缓冲区，跨块时拼接；未压缩的文件直接读入缓冲区。不可与read(chunk)混用
+		/// </summary>
+		/// <returns>读出的字节数，小于size表示已到结尾或出错</returns>
+		size_t read(char* buffer, size_t size);
+		/// <summary>
+		/// 文件不存在或数据损坏
+		/// </summary>
+		bool failed() const;
+	private:
+		std::ifstream in;
+		bool compressed;
+		bool finished;
+		bool error;
+		/// <summary>
+		/// 数据范围内尚未读出的字节数
+		/// </summary>
+		unsigned long long left;
+		/// <summary>
+		/// 从文件读取，不超出数据范围
+		/// </summary>
+		size_t readRaw(char* buffer, size_t size);
+		/// <summary>
+		/// 判断格式时读出的开头数据
+		/// </summary>
+		std::string pending;
+		/// <summary>
+		/// read(buffer)解压出的当前块与已读出的位置
+		/// </summary>
+		std::string block;
+		size_t blockOffset = 0;
+	};
+private:
+	/// <summary>
+	/// 压缩一块，不变小时返回空
+	/// </summary>
+	static std::string compressBlock(std::string_view block);
+	static bool decompressBlock(std::string_view data, size_t rawSize, std::string& out);
+	/// <summary>
+	/// 追加一块的块头与数据
+	/// </summary>
+	static void appendBlock(std::string& out, std::string_view block);
+	/// <summary>
+	/// 读取一块并解压，读到结束块时block为空
+	/// </summary>
+	static bool readBlock(std::istream& in, std::string& block);
+};
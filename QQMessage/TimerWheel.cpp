@@ -0,0 +1,72 @@
+﻿#include "TimerWheel.h"
+
+TimerWheel::TimerWheel(long long now) : current(now), nextId(1) {}
+
+unsigned long long TimerWheel::add(long long when, Task task)
+{
+	if (when <= current) when = current + 1;//当前格已转过
+	unsigned long long id = nextId++;
+	live.insert(id);
+	place(Entry{ id, when, std::move(task) });
+	return id;
+}
+
+void TimerWheel::cancel(unsigned long long id)
+{
+	live.erase(id);
+}
+
+size_t TimerWheel::size() const
+{
+	return live.size();
+}
+
+void TimerWheel::place(Entry entry)
+{
+	long long delta = entry.when - current;
+	for (int level = 0; level < LEVELS; level++)
+	{
+		if (delta < (1LL << (BITS * (level + 1))))
+		{
+			int slot = (int)((entry.when >> (BITS * level)) & (SLOTS - 1));
+			slots[level][slot].push_back(std::move(entry));
+			return;
+		}
+	}
+	//超出范围，放入最高层最后转到的一格，届时重新放置
+	int slot = (int)(((current >> (BITS * (LEVELS - 1))) - 1) & (SLOTS - 1));
+	slots[LEVELS - 1][slot].push_back(std::move(entry));
+}
+
+void TimerWheel::cascade(int level)
+{
+	int slot = (int)((current >> (BITS * level)) & (SLOTS - 1));
+	std::vector<Entry> entries;
+	entries.swap(slots[level][slot]);
+	for (auto& iter : entries)
+	{
+		if (live.count(iter.id)) place(std::move(iter));
+	}
+}
+
+std::vector<TimerWheel::Task> TimerWheel::advance(long long now)
+{
+	std::vector<Task> due;
+	while (current < now)
+	{
+		current++;
+		//低层转完一圈时，高层当前格下移
+		for (int level = 1; level < LEVELS; level++)
+		{
+			if ((current & ((1LL << (BITS * level)) - 1)) != 0) break;
+			cascade(level);
+		}
+		std::vector<Entry> entries;
+		entries.swap(slots[0][current & (SLOTS - 1)]);
+		for (auto& iter : entries)
+		{
+			if (live.erase(iter.id)) due.push_back(std::move(iter.task));
+		}
+	}
+	return due;
+}
@@ -0,0 +1,71 @@
+﻿#pragma once
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+/// <summary>
+/// 分层时间轮
+/// <para>刻度为1秒，4层每层64格，覆盖约194天，更远的任务放在最高层并在转动时逐层下移</para>
+/// <para>非线程安全，由调用方加锁</para>
+/// </summary>
+class TimerWheel
+{
+public:
+	typedef std::function<void()> Task;
+	/// <summary>
+	/// 初始化时间轮
+	/// </summary>
+	/// <param name="now">当前时间（秒）</param>
+	explicit TimerWheel(long long now);
+	/// <summary>
+	/// 添加任务，时间已过的任务在下一刻度执行
+	/// </summary>
+	/// <param name="when">执行时间（秒）</param>
+	/// <param name="task">任务</param>
+	/// <returns>任务id</returns>
+	unsigned long long add(long long when, Task task);
+	/// <summary>
+	/// 取消任务
+	/// </summary>
+	/// <param name="id">任务id</param>
+	void cancel(unsigned long long id);
+	/// <summary>
+	/// 转动至指定时间
+	/// </summary>
+	/// <param name="now">当前时间（秒）</param>
+	/// <returns>到期的任务，由调用方在锁外执行</returns>
+	std::vector<Task> advance(long long now);
+	/// <summary>
+	/// 未执行且未取消的任务数
+	/// </summary>
+	size_t size() const;
+private:
+	static const int LEVELS = 4;
+	static const int BITS = 6;
+	static const int SLOTS = 1 << BITS;
+	struct Entry
+	{
+		unsigned long long id;
+		long long when;
+		Task task;
+	};
+	/// <summary>
+	/// 按与当前时间的差值放入对应层
+	/// </summary>
+	void place(Entry entry);
+	/// <summary>
+	/// 将一格中的任务重新放入下层
+	/// </summary>
+	void cascade(int level);
+
+	std::vector<Entry> slots[LEVELS][SLOTS];
+	/// <summary>
+	/// 已转到的时间
+	/// </summary>
+	long long current;
+	unsigned long long nextId;
+	/// <summary>
+	/// 未执行且未取消的任务id，取消的任务在到期时丢弃
+	/// </summary>
+	std::unordered_set<unsigned long long> live;
+};
@@ -1,57 +1,84 @@
-﻿#define _SILENCE_ALL_CXX17_DEPRECATION_WARNINGS
-#include <iostream>
+﻿#include <iostream>
 #include <map>
-#include <sstream>
 #include <string>
-#include <locale>
-#include <codecvt>
+#include <cstring>
+#include <cstdint>
 #include <chrono>
 #include "Tools.h"
 
-std::u16string Tools::to_utf16(std::string str)
+bool Tools::isValidUtf8(std::string_view str)
 {
-	return std::wstring_convert< std::codecvt_utf8_utf16<char16_t>, char16_t >{}.from_bytes(str);
-}
-
-std::string Tools::to_utf8(std::u16string str16)
-{
-	return std::wstring_convert< std::codecvt_utf8_utf16<char16_t>, char16_t >{}.to_bytes(str16);
+	const unsigned char* p = reinterpret_cast<const unsigned char*>(str.data());
+	const unsigned char* end = p + str.size();
+	while (p < end)
+	{
+		//ASCII快速路径，一次检查8字节
+		if (end - p >= 8)
+		{
+			uint64_t word;
+			std::memcpy(&word, p, 8);
+			if ((word & 0x8080808080808080ULL) == 0)
+			{
+				p += 8;
+				continue;
+			}
+		}
+		if (*p < 0x80)
+		{
+			p++;
+			continue;
+		}
+		int len;
+		uint32_t cp;
+		if ((*p & 0xE0) == 0xC0) { len = 2; cp = *p & 0x1F; }
+		else if ((*p & 0xF0) == 0xE0) { len = 3; cp = *p & 0x0F; }
+		else if ((*p & 0xF8) == 0xF0) { len = 4; cp = *p & 0x07; }
+		else return false;
+		if (end - p < len) return false;
+		for (int i = 1; i < len; i++)
+		{
+			if ((p[i] & 0xC0) != 0x80) return false;
+			cp = (cp << 6) | (p[i] & 0x3F);
+		}
+		//过长编码、代理区、超出范围
+		if ((len == 2 && cp < 0x80) || (len == 3 && cp < 0x800) || (len == 4 && cp < 0x10000)) return false;
+		if ((cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) return false;
+		p += len;
+	}
+	return true;
 }
 
-bool Tools::isNum(std::string str)
+size_t Tools::utf8Length(std::string_view str)
 {
-	std::stringstream sin(str);
-	double d;
-	char c;
-	if (!(sin >> d))
+	size_t count = 0;
+	for (char c : str)
 	{
-		return false;
+		if ((static_cast<unsigned char>(c) & 0xC0) != 0x80) count++;
 	}
-	if (sin >> c)
-	{
-		return false;
-	}
-	return true;
+	return count;
 }
 
-void Tools::delSpaceAhead(std::u16string& x)
+bool Tools::equalsAny(std::string_view data, std::initializer_list<std::string_view> aliases)
 {
-	while (x.substr(0, 1) == u" ")
+	for (auto& alias : aliases)
 	{
-		x = x.substr(1, x.length() - 1);
+		if (data == alias) return true;
 	}
-	return;
+	return false;
 }
 
-std::u16string Tools::delFirstCom(std::u16string data,int len)
+size_t Tools::matchPrefix(std::string_view data, std::initializer_list<std::string_view> aliases)
 {
-	std::u16string subCom = data.substr(len, data.length() - len);
-	Tools::delSpaceAhead(subCom);
-	return subCom;
+	//别名均为完整字符，字节前缀匹配即在码位边界上
+	for (auto& alias : aliases)
+	{
+		if (data.substr(0, alias.size()) == alias) return alias.size();
+	}
+	return 0;
 }
 
 long long Tools::getTimestamp()
 {
 	auto timeNow = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
 	return timeNow.count();
-}
\ No newline at end of file
+}
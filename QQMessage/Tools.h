@@ -1,43 +1,42 @@
 ﻿#pragma once
+#include <string>
+#include <string_view>
+#include <initializer_list>
 
 /// <summary>
 /// 工具集
+/// <para>文本均为utf8编码，按码位处理</para>
 /// </summary>
 class Tools
 {
 public:
 	/// <summary>
-	/// utf8转utf16
+	/// 检测是否为合法utf8
 	/// </summary>
-	/// <param name="str">utf8字串</param>
-	/// <returns>utf16字串</returns>
-	static std::u16string to_utf16(std::string str);
-
-	/// <summary>
-	/// utf16转utf8
-	/// </summary>
-	/// <param name="str">utf16字串</param>
-	/// <returns>utf8字串</returns>
-	static std::string to_utf8(std::u16string str16);
+	/// <param name="str">字符串</param>
+	/// <returns></returns>
+	static bool isValidUtf8(std::string_view str);
 	/// <summary>
-	/// 检测是否为数字
+	/// utf8字符数（码位数）
 	/// </summary>
 	/// <param name="str">utf8字符串</param>
-	/// <returns></returns>
-	static bool isNum(std::string str);
+	/// <returns>字符数</returns>
+	static size_t utf8Length(std::string_view str);
 	/// <summary>
-	/// 删除前端多余空格
+	/// 检测是否与任一别名完全相同
 	/// </summary>
-	/// <param name="x">utf16字符串</param>
-	static void delSpaceAhead(std::u16string& x);
+	/// <param name="data">utf8字符串</param>
+	/// <param name="aliases">命令别名</param>
+	/// <returns></returns>
+	static bool equalsAny(std::string_view data, std::initializer_list<std::string_view> aliases);
 	/// <summary>
-	/// 删除前序命令
+	/// 匹配前序命令
+	/// <para>按顺序匹配，较长的别名应排在前面</para>
 	/// </summary>
-	/// <param name="data">原始utf16消息</param>
-	/// <param name="data">前序命令长度</param>
-	/// <returns>二级消息</returns>
-	static std::u16string delFirstCom(std::u16string data,int len);
-
+	/// <param name="data">utf8字符串</param>
+	/// <param name="aliases">命令别名</param>
+	/// <returns>匹配到的别名字节长度，未匹配返回0</returns>
+	static size_t matchPrefix(std::string_view data, std::initializer_list<std::string_view> aliases);
 	/// <summary>
 	/// 获取当前时间戳
 	/// </summary>
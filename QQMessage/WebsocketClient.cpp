@@ -1,11 +1,17 @@
 ﻿#include "WebsocketClient.h"
-WebsocketClient::WebsocketClient()
+#include <charconv>
+#include <json.hpp>
+#include "EventFilter.h"
+#include "JsonWriter.h"
+WebsocketClient::WebsocketClient() :
+	m_Connected(false), m_Closing(false), m_ReconnectAttempts(0), m_Random(std::random_device()()), m_NextEcho(1)
 {
 	m_WebsocketClient.clear_access_channels(websocketpp::log::alevel::all);  // 开启全部接入日志级别
 	m_WebsocketClient.clear_error_channels(websocketpp::log::elevel::all);   // 开启全部错误日志级别
 
 	m_WebsocketClient.init_asio();       // 初始化asio
 	m_WebsocketClient.start_perpetual(); // 避免请求为空时退出，实际上，也是避免asio退出
+	m_ReconnectTimer = std::make_shared<asio::steady_timer>(m_WebsocketClient.get_io_service());
 
 	// 独立运行client::run()的线程，主要是避免阻塞
 	m_Thread = websocketpp::lib::make_shared<websocketpp::lib::thread>(&client::run, &m_WebsocketClient);
@@ -18,9 +24,21 @@ WebsocketClient::WebsocketClient()
 
 WebsocketClient::~WebsocketClient()
 {
+	m_Closing = true;
 	m_WebsocketClient.stop_perpetual();
+	m_ReconnectTimer->cancel();
 
-	if (m_ConnectionMetadataPtr != nullptr && m_ConnectionMetadataPtr->get_status() == "Open")
+	{
+		// 取消等待中的超时计时器，避免io线程等待计时器到期
+		std::lock_guard<std::mutex> lock(m_PendingMutex);
+		for (auto& iter : m_Pending)
+		{
+			if (iter.second.timer) iter.second.timer->cancel();
+		}
+		m_Pending.clear();
+	}
+
+	if (m_ConnectionMetadataPtr != nullptr && IsConnected())
 	{
 		websocketpp::lib::error_code ec;
 		m_WebsocketClient.close(m_ConnectionMetadataPtr->get_hdl(), websocketpp::close::status::going_away, "", ec); // 关闭连接
@@ -48,7 +66,10 @@ bool WebsocketClient::Connect(std::string const& url)
 
 	// 创建连接的metadata信息，并保存
 	connection_metadata::ptr metadata_ptr = websocketpp::lib::make_shared<connection_metadata>(con->get_handle(), lastURL);
-	m_ConnectionMetadataPtr = metadata_ptr;
+	{
+		std::lock_guard<std::mutex> lock(m_SendMutex);
+		m_ConnectionMetadataPtr = metadata_ptr;
+	}
 
 	// 注册连接打开的Handler
 	//con->set_open_handler(websocketpp::lib::bind(
@@ -109,18 +130,15 @@ bool WebsocketClient::Connect(std::string const& url)
 	// 进行连接
 	m_WebsocketClient.connect(con);
 
-	//std::cout << "Websocket连接成功" << std::endl;
-
-	// 注意，不能在Websocket连接完成之后马上就发送消息，不然会出现Invalid State的错误，
-	// 导致消息发送不成功，所以在连接成功之后，主线程休眠1秒
-	std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-
+	// 连接建立前发送的消息存入m_Backlog，在OnOpen中发送，无需等待
 	return true;
 }
 
 bool WebsocketClient::Close(std::string reason)
 {
 	websocketpp::lib::error_code ec;
+	m_Closing = true;
+	m_ReconnectTimer->cancel();
 
 	if (m_ConnectionMetadataPtr != nullptr)
 	{
@@ -137,23 +155,172 @@ bool WebsocketClient::Close(std::string reason)
 	return true;
 }
 
-bool WebsocketClient::Send(std::string message)
+bool WebsocketClient::Send(const std::string& message)
+{
+	bool written;
+	return Write(message, 0, written);
+}
+
+bool WebsocketClient::Write(const std::string& message, unsigned long long echo, bool& written)
 {
 	websocketpp::lib::error_code ec;
+	std::lock_guard<std::mutex> lock(m_SendMutex);
+	written = false;
 
-	if (m_ConnectionMetadataPtr != nullptr)
+	if (!m_Connected || m_ConnectionMetadataPtr == nullptr)
 	{
-		// 连接发送数据
-		m_WebsocketClient.send(m_ConnectionMetadataPtr->get_hdl(), message, websocketpp::frame::opcode::text, ec);
-		if (ec)
+		// 未连接，缓冲至重连后发送；已满时拒绝，由出站队列稍后重试
+		if (m_Backlog.size() >= BACKLOG_CAPACITY)
 		{
-			std::cerr << "> Error sending message: " << ec.message() << std::endl;
-			std::string errorMessage = ec.message();
+			std::cerr << "> Send backlog full, message rejected." << std::endl;
 			return false;
 		}
-		//std::cout << "发送数据成功" << std::endl;
+		m_Backlog.push_back(BacklogFrame{ message, echo });
+		return true;
 	}
 
+	// 连接发送数据
+	m_WebsocketClient.send(m_ConnectionMetadataPtr->get_hdl(), message, websocketpp::frame::opcode::text, ec);
+	if (ec)
+	{
+		std::cerr << "> Error sending message: " << ec.message() << std::endl;
+		std::string errorMessage = ec.message();
+		return false;
+	}
+	//std::cout << "发送数据成功" << std::endl;
+	written = true;
+	return true;
+}
+
+bool WebsocketClient::IsConnected()
+{
+	std::lock_guard<std::mutex> lock(m_SendMutex);
+	return m_Connected;
+}
+
+void WebsocketClient::ScheduleReconnect()
+{
+	if (m_Closing) return;
+	// 指数退避，在[delay/2, delay]内随机，避免多个客户端同时重连
+	long delay = std::min(RECONNECT_MAX_MS, RECONNECT_BASE_MS << std::min(m_ReconnectAttempts, 16));
+	long wait = std::uniform_int_distribution<long>(delay / 2, delay)(m_Random);
+	m_ReconnectAttempts++;
+	std::cerr << "> Re-connecting in " << wait << " ms." << std::endl;
+
+	m_ReconnectTimer->expires_after(std::chrono::milliseconds(wait));
+	m_ReconnectTimer->async_wait([this](const asio::error_code& ec)
+		{
+			if (ec || m_Closing) return;//已取消
+			if (!Connect("")) ScheduleReconnect();
+		});
+}
+
+bool WebsocketClient::Call(const ApiRequest& request, long timeoutMs)
+{
+	unsigned long long echo = m_NextEcho++;
+	// 写入线程复用的缓冲，发送时由websocketpp复制
+	std::string& frame = JsonWriter::threadBuffer();
+	JsonWriter(frame).beginObject().key("action").value(request.action).key("params").raw(request.params).key("echo").value(echo).endObject();
+
+	// 先登记再发送，避免回执先于登记到达
+	{
+		std::lock_guard<std::mutex> lock(m_PendingMutex);
+		m_Pending[echo] = PendingCall{ request.action, request.callback, std::chrono::steady_clock::now(), timeoutMs, nullptr };
+	}
+
+	bool written;
+	if (!Write(frame, echo, written))
+	{
+		std::lock_guard<std::mutex> lock(m_PendingMutex);
+		m_Pending.erase(echo);
+		return false;
+	}
+	// 存入缓冲的调用在OnOpen中写入连接后开始计时
+	if (written) StartTimer(echo);
+	return true;
+}
+
+void WebsocketClient::StartTimer(unsigned long long echo)
+{
+	std::lock_guard<std::mutex> lock(m_PendingMutex);
+	auto iter = m_Pending.find(echo);
+	if (iter == m_Pending.end() || iter->second.timer) return;//回执已先到达
+	iter->second.start = std::chrono::steady_clock::now();
+	iter->second.timer = std::make_shared<asio::steady_timer>(m_WebsocketClient.get_io_service(), std::chrono::milliseconds(iter->second.timeoutMs));
+	iter->second.timer->async_wait([this, echo](const asio::error_code& ec)
+		{
+			if (ec) return;//已取消
+			ApiResult result;
+			result.status = ApiStatus::TIMEOUT;
+			Complete(echo, result);
+		});
+}
+
+std::future<ApiResult> WebsocketClient::CallAsync(std::string action, std::string params, long timeoutMs)
+{
+	auto promise = std::make_shared<std::promise<ApiResult>>();
+	std::future<ApiResult> future = promise->get_future();
+	ApiRequest request{ action, params, [promise](const ApiResult& result) { promise->set_value(result); } };
+	if (!Call(request, timeoutMs))
+	{
+		promise->set_value(ApiResult());
+	}
+	return future;
+}
+
+std::map<std::string, LatencyHistogram> WebsocketClient::GetLatency()
+{
+	std::lock_guard<std::mutex> lock(m_PendingMutex);
+	return m_Latency;
+}
+
+void WebsocketClient::Complete(unsigned long long echo, ApiResult result)
+{
+	ApiCallback callback;
+	{
+		std::lock_guard<std::mutex> lock(m_PendingMutex);
+		auto iter = m_Pending.find(echo);
+		if (iter == m_Pending.end()) return;//已超时或已完成
+		if (iter->second.timer) iter->second.timer->cancel();
+		result.latencyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - iter->second.start).count();
+		LatencyHistogram& histogram = m_Latency[iter->second.action];
+		if (result.status == ApiStatus::TIMEOUT) histogram.timeouts++;
+		else histogram.record(result.latencyMs);
+		callback = std::move(iter->second.callback);
+		m_Pending.erase(iter);
+	}
+	if (callback != nullptr)
+	{
+		callback(result);
+	}
+}
+
+bool WebsocketClient::Resolve(const std::string& message)
+{
+	EventHeader header = EventFilter::scan(message);
+	if (header.kind != EventKind::API_RESPONSE || header.echo.empty()) return false;
+	unsigned long long echo = 0;
+	auto ret = std::from_chars(header.echo.data(), header.echo.data() + header.echo.size(), echo);
+	if (ret.ec != std::errc() || ret.ptr != header.echo.data() + header.echo.size()) return false;
+	{
+		std::lock_guard<std::mutex> lock(m_PendingMutex);
+		if (m_Pending.find(echo) == m_Pending.end()) return false;
+	}
+
+	ApiResult result;
+	result.response = message;
+	try
+	{
+		auto decode = nlohmann::json::parse(message);
+		std::string status = decode.value("status", "failed");
+		result.retcode = decode.value("retcode", -1);
+		result.status = (status == "ok" || status == "async") ? ApiStatus::OK : ApiStatus::FAILED;
+	}
+	catch (...)
+	{
+		result.status = ApiStatus::FAILED;
+	}
+	Complete(echo, result);
 	return true;
 }
 
@@ -164,6 +331,27 @@ connection_metadata::ptr WebsocketClient::GetConnectionMetadataPtr()
 
 void WebsocketClient::OnOpen(client* c, websocketpp::connection_hdl hdl)
 {
+	m_ReconnectAttempts = 0;
+	std::vector<unsigned long long> written;
+	{
+		// 发送断线期间缓冲的消息
+		std::lock_guard<std::mutex> lock(m_SendMutex);
+		m_Connected = true;
+		while (!m_Backlog.empty())
+		{
+			websocketpp::lib::error_code ec;
+			c->send(hdl, m_Backlog.front().message, websocketpp::frame::opcode::text, ec);
+			if (ec)
+			{
+				std::cerr << "> Error sending message: " << ec.message() << std::endl;
+				break;
+			}
+			if (m_Backlog.front().echo != 0) written.push_back(m_Backlog.front().echo);
+			m_Backlog.pop_front();
+		}
+	}
+	// 缓冲中的调用自写入连接时开始计时
+	for (unsigned long long echo : written) StartTimer(echo);
 	if (m_OnOpenFunc != nullptr)
 	{
 		m_OnOpenFunc();
@@ -172,6 +360,11 @@ void WebsocketClient::OnOpen(client* c, websocketpp::connection_hdl hdl)
 
 void WebsocketClient::OnFail(client* c, websocketpp::connection_hdl hdl)
 {
+	{
+		std::lock_guard<std::mutex> lock(m_SendMutex);
+		m_Connected = false;
+	}
+	ScheduleReconnect();
 	if (m_OnFailFunc != nullptr)
 	{
 		m_OnFailFunc();
@@ -180,6 +373,11 @@ void WebsocketClient::OnFail(client* c, websocketpp::connection_hdl hdl)
 
 void WebsocketClient::OnClose(client* c, websocketpp::connection_hdl hdl)
 {
+	{
+		std::lock_guard<std::mutex> lock(m_SendMutex);
+		m_Connected = false;
+	}
+	ScheduleReconnect();
 	if (m_OnCloseFunc != nullptr)
 	{
 		m_OnCloseFunc();
@@ -193,6 +391,8 @@ void WebsocketClient::OnMessage(websocketpp::connection_hdl, client::message_ptr
 		std::string message = msg->get_payload();
 		//std::cout << "收到来自服务器的消息：" << message << std::endl;
 
+		if (Resolve(message)) return;//api回执
+
 		if (m_MessageFunc != nullptr)
 		{
 			m_MessageFunc(message);
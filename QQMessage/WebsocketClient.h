@@ -17,6 +17,15 @@
 #include <string>
 #include <locale>
 #include <codecvt>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <random>
+#include <map>
+#include <vector>
+#include <mutex>
+
+#include "ApiCall.h"
 
 typedef websocketpp::client<websocketpp::config::asio_client> client;
 
@@ -111,7 +120,8 @@ public:
 
 public:
 	/// <summary>
-	/// 开始连接
+	/// 开始连接，不等待连接建立
+	/// <para>连接失败或断开后按指数退避自动重连，直到调用Close</para>
 	/// </summary>
 	/// <param name="url">地址
 	/// ws://ip:port
@@ -119,17 +129,44 @@ public:
 	/// <returns>连接结果</returns>
 	bool Connect(std::string const& url);
 	/// <summary>
-	/// 主动关闭连接
+	/// 主动关闭连接，不再重连
 	/// </summary>
 	/// <param name="reason">关闭原因</param>
 	/// <returns>关闭结果</returns>
 	bool Close(std::string reason = "");
 	/// <summary>
 	/// 发送消息
+	/// <para>未连接时存入缓冲队列，连接建立后按序发送</para>
 	/// </summary>
 	/// <param name="message">消息内容</param>
+	/// <returns>已发送或已存入缓冲返回true；发送出错或缓冲已满返回false，由调用方重试</returns>
+	bool Send(const std::string& message);
+	/// <summary>
+	/// 是否已建立连接
+	/// </summary>
+	bool IsConnected();
+	/// <summary>
+	/// 调用go-cqhttp api
+	/// <para>分配唯一echo并登记，收到回执或超时后执行回调；发送失败时不执行回调</para>
+	/// <para>未连接时存入缓冲，超时从实际写入连接时开始计算</para>
+	/// </summary>
+	/// <param name="request">请求</param>
+	/// <param name="timeoutMs">超时（毫秒）</param>
 	/// <returns>发送结果</returns>
-	bool Send(std::string message);
+	bool Call(const ApiRequest& request, long timeoutMs = 30000);
+	/// <summary>
+	/// 调用go-cqhttp api
+	/// </summary>
+	/// <param name="action">终结点</param>
+	/// <param name="params">参数，json对象文本</param>
+	/// <param name="timeoutMs">超时（毫秒）</param>
+	/// <returns>调用结果，发送失败时立即就绪</returns>
+	std::future<ApiResult> CallAsync(std::string action, std::string params, long timeoutMs = 30000);
+	/// <summary>
+	/// 获取各终结点的耗时统计
+	/// </summary>
+	/// <returns>【终结点，直方图】</returns>
+	std::map<std::string, LatencyHistogram> GetLatency();
 
 	connection_metadata::ptr GetConnectionMetadataPtr();
 
@@ -154,4 +191,103 @@ private:
 	OnFailFunc m_OnFailFunc;
 	OnCloseFunc m_OnCloseFunc;
 	OnMessageFunc m_MessageFunc; 
+
+	/// <summary>
+	/// 按指数退避安排重连，在io线程中调用
+	/// </summary>
+	void ScheduleReconnect();
+	/// <summary>
+	/// 写入连接，未连接时存入缓冲
+	/// </summary>
+	/// <param name="echo">api调用编号，写入连接时开始计时，非api调用为0</param>
+	/// <param name="written">已写入连接时置为true，存入缓冲时为false</param>
+	/// <returns>发送出错或缓冲已满返回false</returns>
+	bool Write(const std::string& message, unsigned long long echo, bool& written);
+
+	/// <summary>
+	/// 未连接时缓冲的最大消息数，超出时发送失败，不丢弃已接受的消息
+	/// </summary>
+	static constexpr size_t BACKLOG_CAPACITY = 1024;
+	/// <summary>
+	/// 首次重连等待（毫秒）
+	/// </summary>
+	static constexpr long RECONNECT_BASE_MS = 100;
+	/// <summary>
+	/// 最长重连等待（毫秒）
+	/// </summary>
+	static constexpr long RECONNECT_MAX_MS = 30000;
+
+	std::mutex m_SendMutex;
+	/// <summary>
+	/// 连接状态，由m_SendMutex保护
+	/// </summary>
+	bool m_Connected;
+	/// <summary>
+	/// 未连接时缓冲的消息
+	/// </summary>
+	struct BacklogFrame
+	{
+		std::string message;
+		/// <summary>
+		/// api调用编号，非api调用为0
+		/// </summary>
+		unsigned long long echo;
+	};
+	/// <summary>
+	/// 未连接时缓冲的消息，由m_SendMutex保护
+	/// </summary>
+	std::deque<BacklogFrame> m_Backlog;
+	/// <summary>
+	/// 已主动关闭，不再重连
+	/// </summary>
+	std::atomic<bool> m_Closing;
+	std::shared_ptr<asio::steady_timer> m_ReconnectTimer;
+	int m_ReconnectAttempts;
+	std::mt19937 m_Random;
+
+	/// <summary>
+	/// 等待回执的调用
+	/// </summary>
+	struct PendingCall
+	{
+		std::string action;
+		ApiCallback callback;
+		/// <summary>
+		/// 写入连接的时间
+		/// </summary>
+		std::chrono::steady_clock::time_point start;
+		long timeoutMs;
+		/// <summary>
+		/// 超时计时器，写入连接后才创建，缓冲中的调用为空
+		/// </summary>
+		std::shared_ptr<asio::steady_timer> timer;
+	};
+	/// <summary>
+	/// 调用已写入连接，开始计算耗时与超时
+	/// </summary>
+	/// <param name="echo">调用编号</param>
+	void StartTimer(unsigned long long echo);
+	/// <summary>
+	/// 收到回执或超时，结束调用
+	/// </summary>
+	/// <param name="echo">调用编号</param>
+	/// <param name="result">结果</param>
+	void Complete(unsigned long long echo, ApiResult result);
+	/// <summary>
+	/// 尝试将消息作为api回执处理
+	/// </summary>
+	/// <param name="message">消息</param>
+	/// <returns>是等待中的回执时返回true</returns>
+	bool Resolve(const std::string& message);
+
+	std::atomic<unsigned long long> m_NextEcho;
+	std::mutex m_PendingMutex;
+	/// <summary>
+	/// 等待回执的调用【echo，调用】
+	/// </summary>
+	std::map<unsigned long long, PendingCall> m_Pending;
+	/// <summary>
+	/// 耗时统计【终结点，直方图】
+	/// </summary>
+	std::map<std::string, LatencyHistogram> m_Latency;
 };
\ No newline at end of file
@@ -5,8 +5,90 @@
 #include "Analyst.h"
 #include "DataManager.hpp"
 #include "File.h"
+#include "TextCompressor.h"
 #include <fstream>
 #include <ctime>
+#include "ClientPool.h"
+#include "NotificationJob.h"
+#include "ReminderScheduler.h"
+#include "StorageQuota.h"
+#include "FileCache.h"
+#include "ClassArchiver.h"
+/// <summary>
+/// go-cqhttp连接池 位于QQMessage
+/// </summary>
+extern ClientPool clientPool;
+/// <summary>
+/// 通知批量发送任务 位于QQMessage
+/// </summary>
+extern NotificationJobManager notificationJobs;
+/// <summary>
+/// 截止提醒 位于QQMessage
+/// </summary>
+extern ReminderScheduler reminderScheduler;
+/// <summary>
+/// 存储用量与配额 位于QQMessage
+/// </summary>
+extern StorageQuota storageQuota;
+/// <summary>
+/// 提交文件读取缓存 位于QQMessage
+/// </summary>
+extern FileCache fileCache;
+/// <summary>
+/// 结课班级归档 位于QQMessage
+/// </summary>
+extern ClassArchiver classArchiver;
+
+struct WebsocketServer::FileTransfer
+{
+    websocketpp::connection_hdl hdl;
+    TextCompressor::Reader reader;
+    /// <summary>
+    /// 复用的分块缓冲区
+    /// </summary>
+    std::string part;
+    /// <summary>
+    /// 缓存中的文件内容，不为空时从此发送，不读取文件
+    /// </summary>
+    std::shared_ptr<const std::string> content;
+    /// <summary>
+    /// 开始消息中声明的大小尚未发送的部分
+    /// </summary>
+    unsigned long long remaining = 0;
+
+    FileTransfer(websocketpp::connection_hdl hdl, const FileLocation& location) :
+        hdl(hdl), reader(location.path, location.offset, location.length), part(FILE_PART_SIZE, '\0')
+    {}
+};
+
+void WebsocketServer::pumpFile(server* s, std::shared_ptr<FileTransfer> transfer)
+{
+    websocketpp::lib::error_code ec;
+    server::connection_ptr con = s->get_con_from_hdl(transfer->hdl, ec);
+    //连接已断开，放弃发送
+    if (ec || con->get_state() != websocketpp::session::state::open) return;
+    while (con->get_buffered_amount() < FILE_MAX_BUFFERED)
+    {
+        size_t size = (size_t)std::min<unsigned long long>(FILE_PART_SIZE, transfer->remaining);
+        const char* data = transfer->part.data();
+        if (transfer->content) data = transfer->content->data() + (transfer->content->size() - transfer->remaining);
+        else if (size > 0) size = transfer->reader.read(&transfer->part[0], size);
+        if (size == 0)
+        {
+            //文件在开始消息后被改动或损坏时提前结束，客户端按已收到的部分保存
+            if (transfer->remaining > 0) std::cerr << "get_file: " << transfer->remaining << " bytes missing" << std::endl;
+            con->send(std::string("{\"action\":\"send_file\",\"status\":\"finish\"}"), websocketpp::frame::opcode::text);
+            return;
+        }
+        //分块直接从缓冲区写入websocket帧
+        if (con->send(data, size, websocketpp::frame::opcode::binary)) return;
+        transfer->remaining -= size;
+    }
+    con->set_timer(FILE_RETRY_MS, [s, transfer](const websocketpp::lib::error_code& ec)
+        {
+            if (!ec) pumpFile(s, transfer);
+        });
+}
 WebsocketServer::WebsocketServer()
 {
     m_connection_list.clear();
@@ -83,29 +165,183 @@ void WebsocketServer::OnMessage(server* s, WebsocketServer* pWebSocket, websocke
             if (decode.at("action") == "send_review") //发送review
             {
                 std::string homeworkId_str = decode.at("homework_id");
-                if (sendReview(atol(homeworkId_str.c_str())))
+                //收到go-cqhttp回执后再答复App
+                auto reply = [s, hdl, homeworkId_str](bool success)
                 {
-                    
-                    std::string ret = "{\"action\":\"send_review\",\"homework_id\":" + to_string(decode.at("homework_id")) + "\"status\":\"success\"}";
-                    s->send(hdl, ret, websocketpp::frame::opcode::text);
-                    return;
-                }
-                else
+                    nlohmann::json ret;
+                    ret["action"] = "send_review";
+                    ret["homework_id"] = homeworkId_str;
+                    ret["status"] = success ? "success" : "fail";
+                    websocketpp::lib::error_code ec;
+                    s->send(hdl, ret.dump(), websocketpp::frame::opcode::text, ec);
+                };
+                if (!sendReview(atol(homeworkId_str.c_str()), [reply](const ApiResult& result) { reply(result.status == ApiStatus::OK); }))
                 {
-                    std::string ret = "{\"action\":\"send_review\",\"homework_id\":" + to_string(decode.at("homework_id")) + "\"status\":\"fail\"}";
-                    s->send(hdl, ret, websocketpp::frame::opcode::text);
-                    return;
+                    reply(false);
                 }
+                return;
             }
             if (decode.at("action") == "send_notification")
             {
                 if (decode.at("type") == "new_homework")
                 {
                     long long assignmentId = std::atoll(std::string(decode.at("assignment_id")).c_str());
-                    sendHomeworkNotification(assignmentId, 1);
+                    nlohmann::json ret;
+                    ret["action"] = "send_notification";
+                    ret["type"] = "new_homework";
+                    ret["assignment_id"] = decode.at("assignment_id");
+                    try
+                    {
+                        reminderScheduler.refresh((unsigned long)assignmentId);//作业由App新建，在此安排截止提醒
+                        ret["job_id"] = sendHomeworkNotification(assignmentId, 1);//立即返回任务id，进度通过get_job_status查询
+                        ret["status"] = "queued";
+                    }
+                    catch (std::exception& e)
+                    {
+                        std::cerr << e.what() << std::endl;
+                        ret["status"] = "fail";
+                    }
+                    s->send(hdl, ret.dump(), websocketpp::frame::opcode::text);
                     return;
                 }
             }
+            if (decode.at("action") == "get_job_status")
+            {
+                NotificationJobStatus status;
+                nlohmann::json ret;
+                ret["action"] = "get_job_status";
+                ret["job_id"] = decode.at("job_id");
+                if (notificationJobs.getStatus(decode.at("job_id"), status))
+                {
+                    ret["assignment_id"] = std::to_string(status.assignmentId);
+                    ret["total"] = status.total;
+                    ret["delivered"] = status.delivered;
+                    ret["failed"] = status.failed;
+                    ret["timeout"] = status.timeout;
+                    ret["status"] = status.finished() ? "finished" : "running";
+                }
+                else
+                {
+                    ret["status"] = "not_found";
+                }
+                s->send(hdl, ret.dump(), websocketpp::frame::opcode::text);
+                return;
+            }
+            if (decode.at("action") == "get_metrics")
+            {
+                nlohmann::json ret;
+                ret["action"] = "get_metrics";
+                ret["accounts"] = nlohmann::json::array();
+                for (auto& account : clientPool.getMetrics())
+                {
+                    const DispatcherMetrics& metrics = account.outbound;
+                    nlohmann::json item;
+                    item["url"] = account.url;
+                    item["connected"] = account.connected;
+                    item["outbound"] = {
+                        {"interactive_depth", metrics.interactiveDepth},
+                        {"bulk_depth", metrics.bulkDepth},
+                        {"retry_depth", metrics.retryDepth},
+                        {"sent", metrics.sent},
+                        {"retried", metrics.retried},
+                        {"failed", metrics.failed},
+                        {"dropped", metrics.dropped},
+                        {"avg_latency_ms", metrics.avgLatencyMs},
+                        {"max_latency_ms", metrics.maxLatencyMs},
+                        {"avg_send_ms", metrics.avgSendMs}
+                    };
+                    item["api"] = nlohmann::json::object();
+                    for (auto& iter : account.latency)
+                    {
+                        const LatencyHistogram& histogram = iter.second;
+                        item["api"][iter.first] = {
+                            {"count", histogram.count},
+                            {"timeouts", histogram.timeouts},
+                            {"avg_ms", histogram.count == 0 ? 0 : histogram.sumMs / histogram.count},
+                            {"max_ms", histogram.maxMs},
+                            {"p50_ms", histogram.percentile(0.5)},
+                            {"p99_ms", histogram.percentile(0.99)},
+                            {"buckets", histogram.buckets}
+                        };
+                    }
+                    ret["accounts"].push_back(item);
+                }
+                FileCacheMetrics cache = fileCache.getMetrics();
+                ret["file_cache"] = {
+                    {"hits", cache.hits},
+                    {"misses", cache.misses},
+                    {"hit_rate", cache.hits + cache.misses == 0 ? 0 : (double)cache.hits / (cache.hits + cache.misses)},
+                    {"entries", cache.entries},
+                    {"bytes", cache.bytes},
+                    {"max_entries", cache.maxEntries},
+                    {"max_bytes", cache.maxBytes}
+                };
+                s->send(hdl, ret.dump(), websocketpp::frame::opcode::text);
+                return;
+            }
+            if (decode.at("action") == "get_usage")
+            {
+                //用量来自增量维护的计数，不扫描目录
+                long long classId = std::atoll(std::string(decode.at("class_id")).c_str());
+                ClassUsage usage = storageQuota.getClassUsage(classId);
+                nlohmann::json ret;
+                ret["action"] = "get_usage";
+                ret["class_id"] = decode.at("class_id");
+                ret["total"] = usage.total;
+                ret["student_limit"] = storageQuota.getStudentLimit();
+                ret["class_limit"] = storageQuota.getClassLimit();
+                ret["students"] = nlohmann::json::array();
+                for (auto& iter : usage.students)
+                {
+                    ret["students"].push_back({ {"student_id", std::to_string(iter.first)}, {"bytes", iter.second} });
+                }
+                if (decode.contains("homework_id"))
+                {
+                    //单次提交的用量即提交清单中文件大小之和
+                    ret["homework_id"] = decode.at("homework_id");
+                    try
+                    {
+                        DataManager::Homework hm(std::atol(std::string(decode.at("homework_id")).c_str()));
+                        File file(classId, hm.getStudentId(), hm.getAssignmentId());
+                        ret["submission"] = file.getSize();
+                    }
+                    catch (std::exception& e)
+                    {
+                        std::cerr << e.what() << std::endl;
+                        ret["submission"] = nullptr;
+                    }
+                }
+                s->send(hdl, ret.dump(), websocketpp::frame::opcode::text);
+                return;
+            }
+            if (decode.at("action") == "archive_class")
+            {
+                //班级由App结课，在此加入后台归档队列
+                long long classId = std::atoll(std::string(decode.at("class_id")).c_str());
+                nlohmann::json ret;
+                ret["action"] = "archive_class";
+                ret["class_id"] = decode.at("class_id");
+                try
+                {
+                    DataManager::Class cl(classId);
+                    if (cl.getStatus() == DataManager::CLASS_ENDED)
+                    {
+                        classArchiver.add(classId);
+                        ret["status"] = "queued";
+                    }
+                    else
+                    {
+                        ret["status"] = "running";//未结课的班级不归档
+                    }
+                }
+                catch (std::exception& e)
+                {
+                    std::cerr << e.what() << std::endl;
+                    ret["status"] = "fail";
+                }
+                s->send(hdl, ret.dump(), websocketpp::frame::opcode::text);
+                return;
+            }
             if (decode.at("action") == "get_file")
             {
                 //Init
@@ -115,47 +351,31 @@ void WebsocketServer::OnMessage(server* s, WebsocketServer* pWebSocket, websocke
                 DataManager::Student st(hm.getStudentId());
                 File file(st.getClassId(), st.getId(), as.getId());
                 std::string fileName = decode.at("file_name");
-                std::vector<std::string> fileContent;
-                const int BUFFER_SIZE = 1024 * 10; //10K
-                std::ifstream ifs(file.getFilePath(fileName), std::ios::binary);
-                ifs.seekg(0, ifs.end);
-                int length = (int)ifs.tellg();
-                if (ifs) {
-                    ifs.seekg(0, ifs.beg);
-                    std::string buffer(BUFFER_SIZE, '\0');
-                    int offset = 0;
-                    int readSize = std::min(BUFFER_SIZE, length - offset);
-                    while (readSize > 0 && ifs.read(&buffer[0], readSize)) {
-                        fileContent.push_back(buffer);
-                        offset += readSize;
-                        readSize = std::min(BUFFER_SIZE, length - offset);
-                    }
+                //压缩存储的正文与代码逐块解压，长度为解压后的长度；已归档的提交从班级归档中读取
+                FileLocation location = file.locate(fileName);
+                auto transfer = std::make_shared<FileTransfer>(hdl, location);
+                unsigned long long length = 0;
+                if (!TextCompressor::contentSize(location.path, length, location.offset, location.length)) length = 0;//文件不存在时只发送开始与结束消息
+                //小文件经过读取缓存，多位教师批改同一提交时不重复读取与解压
+                if (length > 0 && length <= fileCache.getMaxFileSize())
+                {
+                    transfer->content = fileCache.get(location.path, location.offset, location.length);
+                    length = transfer->content ? transfer->content->size() : 0;
                 }
-                ifs.close();
+                transfer->remaining = length;
                 //send Init Message
                 srand((unsigned)time(0));
                 std::string transferId = std::to_string(rand() % 1000000);
+                unsigned long long totalPart = (length + FILE_PART_SIZE - 1) / FILE_PART_SIZE;
 
-                std::string msgInit = "{\"action\":\"send_file\",\"transfer_id\":\"" + transferId + "\",\"homework_id\":\"" + std::to_string(hm.getId()) + "\",\"name\":\"" + fileName + "\",\"totol_part\":\"" + std::to_string(fileContent.size()) + "\",\"part_size\":\"" + std::to_string(BUFFER_SIZE) + "\",\"" + "size" + "\":\"" + std::to_string(length) + "\",\"class_id\":\"" + std::to_string(st.getClassId()) + "\",\"student_id\":\"" + std::to_string(st.getId()) + "\",\"homework_id\":\"" + std::to_string(as.getId()) + "\",\"status\":\"start\"}";
-                //std::string msgInit = "{\"action\":\"send_file\",\"transfer_id\":\"" + transferId + "\",\"homework_id\":\"" + std::to_string(hm.getId()) + "\",\"file_name\":\"" + fileName + "\",\"status\":\"start\"}";
-                s->send(hdl, msgInit, websocketpp::frame::opcode::text);
-#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
-				Sleep(100);
-#else
-				usleep(100000);
-#endif
-                
-                //s->send(hdl, "12345", websocketpp::frame::opcode::text);
-                //send file
-                std::string msgFile;
-                for (int i = 0; i != fileContent.size(); i++)
-                {
-                    msgFile = "{\"action\":\"send_file\",\"transer_id\":\"" + transferId + "\",\"part\":\"" + std::to_string(i) + "\",\"content\":\"" + fileContent[i] + "\"}";
-                    s->send(hdl, fileContent[i], websocketpp::frame::opcode::binary);
-                    //Sleep(50);
-                }
-                msgInit = "{\"action\":\"send_file\",\"status\":\"finish\"}";
+                std::string msgInit = "{\"action\":\"send_file\",\"transfer_id\":\"" + transferId + "\",\"homework_id\":\"" + std::to_string(hm.getId()) + "\",\"name\":\"" + fileName + "\",\"totol_part\":\"" + std::to_string(totalPart) + "\",\"part_size\":\"" + std::to_string(FILE_PART_SIZE) + "\",\"" + "size" + "\":\"" + std::to_string(length) + "\",\"class_id\":\"" + std::to_string(st.getClassId()) + "\",\"student_id\":\"" + std::to_string(st.getId()) + "\",\"homework_id\":\"" + std::to_string(as.getId()) + "\",\"status\":\"start\"}";
                 s->send(hdl, msgInit, websocketpp::frame::opcode::text);
+                //分块由定时器按发送缓冲的余量逐块读取发送，不阻塞服务端线程，也不把整个文件读入内存
+                //开始消息后间隔100ms再发送分块，留给客户端创建文件
+                s->get_con_from_hdl(hdl)->set_timer(100, [s, transfer](const websocketpp::lib::error_code& ec)
+                    {
+                        if (!ec) pumpFile(s, transfer);
+                    });
             }
         }
 
@@ -65,6 +65,26 @@ public:
     void start(int port);
 private:
     typedef std::map<std::string, connection_metadata_server::ptr> con_list;
+    /// <summary>
+    /// 进行中的get_file发送
+    /// </summary>
+    struct FileTransfer;
+    /// <summary>
+    /// 文件分块大小
+    /// </summary>
+    static constexpr size_t FILE_PART_SIZE = 1024 * 10;
+    /// <summary>
+    /// 每个连接发送缓冲中的数据上限，超出时暂停读取文件
+    /// </summary>
+    static constexpr size_t FILE_MAX_BUFFERED = 256 * 1024;
+    /// <summary>
+    /// 发送缓冲已满时的重试间隔（毫秒）
+    /// </summary>
+    static constexpr long FILE_RETRY_MS = 10;
+    /// <summary>
+    /// 在发送缓冲未满时继续读取并发送分块，否则稍后重试；在服务端线程中执行
+    /// </summary>
+    static void pumpFile(server* s, std::shared_ptr<FileTransfer> transfer);
 
     server echo_server;
     con_list m_connection_list;
@@ -0,0 +1,33 @@
+﻿#include "Bench.h"
+#include <iomanip>
+
+volatile size_t benchSink = 0;
+
+void printComparison(std::ostream& out, const BenchResult& current, const BenchResult& baseline)
+{
+	out << std::fixed << std::setprecision(1)
+		<< std::left << std::setw(34) << current.name << std::right
+		<< std::setw(12) << current.nsPerOp << " ns" << std::setw(10) << current.mbPerSec << " MB/s  |  "
+		<< std::left << std::setw(26) << baseline.name << std::right
+		<< std::setw(12) << baseline.nsPerOp << " ns" << std::setw(10) << baseline.mbPerSec << " MB/s  |  x"
+		<< baseline.nsPerOp / current.nsPerOp << std::endl;
+}
+
+std::string sampleHomeworkText(size_t bytes)
+{
+	static const char* lines[] = {
+		"  第三章习题 3.2：已知数组 a[10]，编写函数求最大值与最小值。  ",
+		"int maxOf(const int* a, int n) { int m = a[0]; for (int i = 1; i < n; i++) if (a[i] > m) m = a[i]; return m; }",
+		"答：时间复杂度为 O(n)，空间复杂度为 O(1)。\t",
+		"    // 测试用例：{3, 1, 4, 1, 5, 9, 2, 6}  期望输出 9 1",
+		"The loop compares each element once; n-1 comparisons in total.",
+		"",
+	};
+	std::string text;
+	for (size_t i = 0; text.size() < bytes; i++)
+	{
+		text += lines[i % std::size(lines)];
+		text += i % 3 == 0 ? "\r\n" : "\n";
+	}
+	return text;
+}
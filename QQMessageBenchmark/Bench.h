@@ -0,0 +1,75 @@
+﻿#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+/// <summary>
+/// 一项基准的结果
+/// </summary>
+struct BenchResult
+{
+	std::string name;
+	/// <summary>
+	/// 每次操作的耗时（纳秒）
+	/// </summary>
+	double nsPerOp = 0;
+	/// <summary>
+	/// 每秒处理的输入（MB）
+	/// </summary>
+	double mbPerSec = 0;
+};
+
+/// <summary>
+/// 累加各项操作的返回值，防止被测代码被优化掉
+/// </summary>
+extern volatile size_t benchSink;
+
+/// <summary>
+/// 预热后重复执行op，累计约seconds秒
+/// <para>每批次数翻倍，直到一批耗时超过10ms，计时开销不计入单次操作</para>
+/// </summary>
+/// <param name="bytes">每次操作处理的输入字节数</param>
+/// <param name="op">被测操作，返回任意计数</param>
+template<class Op>
+BenchResult measure(std::string name, size_t bytes, double seconds, Op op)
+{
+	typedef std::chrono::steady_clock clock;
+	size_t sink = 0;
+	for (int i = 0; i < 16; i++) sink += op();
+
+	size_t count = 0;
+	size_t batch = 1;
+	double elapsed = 0;
+	auto begin = clock::now();
+	while (elapsed < seconds)
+	{
+		auto batchBegin = clock::now();
+		for (size_t i = 0; i < batch; i++) sink += op();
+		auto batchEnd = clock::now();
+		count += batch;
+		if (std::chrono::duration<double>(batchEnd - batchBegin).count() < 0.01) batch *= 2;
+		elapsed = std::chrono::duration<double>(batchEnd - begin).count();
+	}
+	benchSink += sink;
+
+	BenchResult result;
+	result.name = std::move(name);
+	result.nsPerOp = elapsed * 1e9 / count;
+	result.mbPerSec = (double)bytes * count / elapsed / 1e6;
+	return result;
+}
+
+/// <summary>
+/// 输出新旧实现的对比
+/// </summary>
+/// <param name="current">当前实现</param>
+/// <param name="baseline">对照实现</param>
+void printComparison(std::ostream& out, const BenchResult& current, const BenchResult& baseline);
+
+/// <summary>
+/// 模拟学生粘贴的长作业正文，中英文与代码混排，多行，带首尾空白
+/// </summary>
+/// <param name="bytes">大致字节数</param>
+std::string sampleHomeworkText(size_t bytes);
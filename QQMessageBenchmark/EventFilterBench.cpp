@@ -0,0 +1,82 @@
+﻿#include "EventFilterBench.h"
+#include <string>
+#include <vector>
+#include <json.hpp>
+
+#include "Bench.h"
+#include "EventFilter.h"
+
+namespace
+{
+	struct Frame
+	{
+		const char* name;
+		std::string text;
+		EventKind kind;
+	};
+
+	/// <summary>
+	/// 自go-cqhttp正向websocket抓取的帧，qq号与消息内容已替换
+	/// </summary>
+	std::vector<Frame> capturedFrames()
+	{
+		std::vector<Frame> frames;
+		frames.push_back({ "heartbeat",
+			R"({"interval":5000,"meta_event_type":"heartbeat","post_type":"meta_event","self_id":1234567890,"status":{"app_enabled":true,"app_good":true,"app_initialized":true,"good":true,"online":true,"plugins_good":null,"stat":{"packet_received":1372,"packet_sent":1317,"packet_lost":0,"message_received":32,"message_sent":15,"disconnect_times":0,"lost_times":0,"last_message_time":1634539213}},"time":1634539215})",
+			EventKind::HEARTBEAT });
+		frames.push_back({ "echo",
+			R"({"data":{"message_id":-1482375921},"echo":1024,"msg":"","retcode":0,"status":"ok","wording":""})",
+			EventKind::API_RESPONSE });
+		frames.push_back({ "private message",
+			R"({"font":0,"message":"提交作业 3","message_id":-1180239583,"message_type":"private","post_type":"message","raw_message":"提交作业 3","self_id":1234567890,"sender":{"age":0,"nickname":"张三","sex":"unknown","user_id":987654321},"sub_type":"friend","target_id":1234567890,"time":1634539220,"user_id":987654321})",
+			EventKind::PRIVATE_MESSAGE });
+		frames.push_back({ "offline file",
+			R"({"file":{"name":"实验报告.docx","size":482816,"url":"http://njc-download.ftn.qq.com/ftn_handler/3f9c2a7e1b5d4c8a6e0f1d2b3c4a5e6f7a8b9c0d/?fname=%E5%AE%9E%E9%AA%8C%E6%8A%A5%E5%91%8A.docx"},"notice_type":"offline_file","post_type":"notice","self_id":1234567890,"time":1634539225,"user_id":987654321})",
+			EventKind::OFFLINE_FILE });
+
+		//粘贴的长正文，字段顺序与go-cqhttp一致（按key排序）
+		std::string text = sampleHomeworkText(4096);
+		nlohmann::json pasted = {
+			{"font", 0}, {"message", text}, {"message_id", -1180239584}, {"message_type", "private"}, {"post_type", "message"},
+			{"raw_message", text}, {"self_id", 1234567890}, {"sender", {{"age", 0}, {"nickname", "张三"}, {"sex", "unknown"}, {"user_id", 987654321}}},
+			{"sub_type", "friend"}, {"target_id", 1234567890}, {"time", 1634539221}, {"user_id", 987654321}
+		};
+		frames.push_back({ "private message 8K", pasted.dump(), EventKind::PRIVATE_MESSAGE });
+		return frames;
+	}
+
+	/// <summary>
+	/// 预分类之前的做法：完整解析后读取顶层字段，规则与EventFilter::scan相同
+	/// </summary>
+	EventKind classifyByParse(const std::string& frame)
+	{
+		auto decode = nlohmann::json::parse(frame);
+		std::string postType = decode.value("post_type", "");
+		if (postType == "meta_event") return EventKind::HEARTBEAT;
+		if (postType == "message" && decode.value("message_type", "") == "private") return EventKind::PRIVATE_MESSAGE;
+		if (decode.value("notice_type", "") == "offline_file") return EventKind::OFFLINE_FILE;
+		if (postType.empty() && (decode.contains("echo") || decode.contains("retcode"))) return EventKind::API_RESPONSE;
+		return EventKind::OTHER;
+	}
+}
+
+int runEventFilterBench(double seconds, std::ostream& out)
+{
+	int failures = 0;
+	out << "EventFilter::scan vs nlohmann::json::parse" << std::endl;
+	for (auto& frame : capturedFrames())
+	{
+		if (EventFilter::scan(frame.text).kind != frame.kind || classifyByParse(frame.text) != frame.kind)
+		{
+			out << frame.name << ": classification mismatch" << std::endl;
+			failures++;
+			continue;
+		}
+		BenchResult scan = measure(std::string("scan ") + frame.name + " (" + std::to_string(frame.text.size()) + "B)", frame.text.size(), seconds,
+			[&frame] { return (size_t)EventFilter::scan(frame.text).kind; });
+		BenchResult parse = measure("json::parse", frame.text.size(), seconds,
+			[&frame] { return (size_t)classifyByParse(frame.text); });
+		printComparison(out, scan, parse);
+	}
+	return failures;
+}
@@ -0,0 +1,11 @@
+﻿#pragma once
+#include <ostream>
+
+/// <summary>
+/// 对抓取的上报帧比较EventFilter::scan与完整json解析后分类的吞吐
+/// <para>帧包括心跳、api回执、私聊消息，以及正文为长作业文本的私聊消息</para>
+/// </summary>
+/// <param name="seconds">每项的运行时间</param>
+/// <param name="out">逐项输出结果</param>
+/// <returns>两种方式分类结果与预期不一致的帧数</returns>
+int runEventFilterBench(double seconds, std::ostream& out);
@@ -0,0 +1,165 @@
+﻿#include "StringToolsBench.h"
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "StringTools.h"
+
+namespace legacy
+{
+	//以下为StringTools之前Tools与Analyst中的实现，u16string改为std::string，逻辑不变
+
+	void delSpaceAhead(std::string& x)
+	{
+		while (x.substr(0, 1) == " ")
+		{
+			x = x.substr(1, x.length() - 1);
+		}
+	}
+
+	std::string delFirstCom(std::string data, int len)
+	{
+		std::string subCom = data.substr(len, data.length() - len);
+		delSpaceAhead(subCom);
+		return subCom;
+	}
+
+	std::vector<std::string> split(std::string_view s, std::string_view seperator)
+	{
+		std::vector<std::string> result;
+		typedef std::string_view::size_type string_size;
+		string_size i = 0;
+		while (i != s.size())
+		{
+			int flag = 0;
+			while (i != s.size() && flag == 0)
+			{
+				flag = 1;
+				for (string_size x = 0; x < seperator.size(); ++x)
+					if (s[i] == seperator[x])
+					{
+						++i;
+						flag = 0;
+						break;
+					}
+			}
+			flag = 0;
+			string_size j = i;
+			while (j != s.size() && flag == 0)
+			{
+				for (string_size x = 0; x < seperator.size(); ++x)
+					if (s[j] == seperator[x])
+					{
+						flag = 1;
+						break;
+					}
+				if (flag == 0)
+					++j;
+			}
+			if (i != j)
+			{
+				result.push_back(std::string(s.substr(i, j - i)));
+				i = j;
+			}
+		}
+		return result;
+	}
+
+	bool isNum(std::string str)
+	{
+		std::stringstream sin(str);
+		double d;
+		char c;
+		if (!(sin >> d)) return false;
+		if (sin >> c) return false;
+		return true;
+	}
+}
+
+namespace
+{
+	/// <summary>
+	/// 各分隔结果的长度之和，用于核对两种实现
+	/// </summary>
+	size_t totalLength(const std::vector<std::string>& parts)
+	{
+		size_t total = 0;
+		for (auto& iter : parts) total += iter.size() + 1;
+		return total;
+	}
+
+	size_t totalLength(const SplitRange& parts)
+	{
+		size_t total = 0;
+		for (std::string_view iter : parts) total += iter.size() + 1;
+		return total;
+	}
+}
+
+int runStringToolsBench(double seconds, std::ostream& out)
+{
+	int failures = 0;
+	auto check = [&out, &failures](const char* name, bool same)
+	{
+		if (same) return true;
+		out << name << ": result mismatch" << std::endl;
+		failures++;
+		return false;
+	};
+	out << "StringTools vs removed copying helpers" << std::endl;
+
+	//提交正文：前序命令、空白与16K的粘贴内容
+	const std::string command = "提交";
+	const std::string text = sampleHomeworkText(16384);
+	const std::string message = command + std::string(32, ' ') + text;
+	if (check("strip prefix", StringTools::stripPrefix(message, command.size()).size() == legacy::delFirstCom(message, (int)command.size()).size()))
+	{
+		printComparison(out,
+			measure("stripPrefix (16K text)", message.size(), seconds, [&] { return StringTools::stripPrefix(message, command.size()).size(); }),
+			measure("delFirstCom", message.size(), seconds, [&] { return legacy::delFirstCom(message, (int)command.size()).size(); }));
+	}
+
+	if (check("split lines", totalLength(StringTools::split(text, "\r\n")) == totalLength(legacy::split(text, "\r\n"))))
+	{
+		printComparison(out,
+			measure("SplitRange lines (16K text)", text.size(), seconds, [&] { return totalLength(StringTools::split(text, "\r\n")); }),
+			measure("split", text.size(), seconds, [&] { return totalLength(legacy::split(text, "\r\n")); }));
+	}
+
+	//删除文件命令中的文件列表
+	std::string names;
+	for (int i = 1; i <= 20; i++) names += std::to_string(i) + (i % 4 == 0 ? ".png" : ".txt") + (i < 20 ? "|" : "");
+	if (check("split names", totalLength(StringTools::split(names, "|")) == totalLength(legacy::split(names, "|"))))
+	{
+		printComparison(out,
+			measure("SplitRange names (20 files)", names.size(), seconds, [&] { return totalLength(StringTools::split(names, "|")); }),
+			measure("split", names.size(), seconds, [&] { return totalLength(legacy::split(names, "|")); }));
+	}
+
+	//学号与作业id
+	const std::vector<std::string> ids = { "2021000123", "42", " 7 ", "3a", "", "201830581234" };
+	size_t idBytes = 0;
+	for (auto& iter : ids) idBytes += iter.size();
+	auto parseAll = [&ids]
+	{
+		size_t sum = 0;
+		long long value;
+		for (auto& iter : ids) if (StringTools::parseInt(iter, value)) sum += (size_t)value;
+		return sum;
+	};
+	auto isNumAll = [&ids]
+	{
+		size_t sum = 0;
+		for (auto& iter : ids) if (legacy::isNum(iter)) sum += (size_t)atoll(iter.c_str());
+		return sum;
+	};
+	if (check("parse ids", parseAll() == isNumAll()))
+	{
+		printComparison(out,
+			measure("parseInt (6 ids)", idBytes, seconds, parseAll),
+			measure("isNum + atoll", idBytes, seconds, isNumAll));
+	}
+	return failures;
+}
@@ -0,0 +1,11 @@
+﻿#pragma once
+#include <ostream>
+
+/// <summary>
+/// 对长作业正文比较StringTools与被其替换的复制式字符串函数
+/// <para>包括去除前序命令与空白、按行与按|分隔、解析整数</para>
+/// </summary>
+/// <param name="seconds">每项的运行时间</param>
+/// <param name="out">逐项输出结果</param>
+/// <returns>两种实现结果不一致的项数</returns>
+int runStringToolsBench(double seconds, std::ostream& out);
@@ -0,0 +1,51 @@
+﻿#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "EventFilterBench.h"
+#include "StringToolsBench.h"
+
+namespace
+{
+	void usage()
+	{
+		std::cerr <<
+			"QQMessageBenchmark [options]\n"
+			"  Microbenchmarks of QQMessage hot paths against the implementations they replaced.\n"
+			"  --seconds X            run time of each case (1)\n"
+			"  --only NAME            run one group: event, string\n";
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	double seconds = 1;
+	std::string only;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--help" || option == "-h")
+		{
+			usage();
+			return 0;
+		}
+		if (i + 1 >= argc)
+		{
+			usage();
+			return 1;
+		}
+		const char* value = argv[++i];
+		if (option == "--seconds") seconds = atof(value);
+		else if (option == "--only") only = value;
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+
+	int failures = 0;
+	if (only.empty() || only == "event") failures += runEventFilterBench(seconds, std::cout);
+	if (only.empty() || only == "string") failures += runStringToolsBench(seconds, std::cout);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+﻿#include "FetchCheck.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "HttpFetcher.h"
+
+namespace
+{
+	/// <summary>
+	/// 校验下载结果与文件大小
+	/// </summary>
+	bool expect(const FetchResult& result, FetchStatus status, unsigned long long size)
+	{
+		if (result.status != status) return false;
+		if (status != FetchStatus::OK) return !std::filesystem::exists(result.path);
+		std::error_code ec;
+		return result.bytes == size && std::filesystem::file_size(result.path, ec) == size;
+	}
+}
+
+int runFetchCheck(int httpPort, std::ostream& out)
+{
+	std::string base = "http://127.0.0.1:" + std::to_string(httpPort);
+	std::filesystem::path dir = std::filesystem::temp_directory_path() / "QQMessageSimulatorFetch";
+	std::filesystem::remove_all(dir);
+	int failed = 0;
+	auto report = [&out, &failed](const char* name, bool ok, const FetchResult& result)
+	{
+		out << (ok ? "ok    " : "FAIL  ") << name;
+		if (!ok) out << " (status " << (int)result.status << ", http " << result.httpStatus << ", " << result.bytes << " bytes, " << result.error << ")";
+		out << std::endl;
+		if (!ok) failed++;
+	};
+
+	{
+		HttpFetcher fetcher(2, 4);
+		FetchResult result = fetcher.fetchAsync(base + "/image/a.png", dir / "a.png").get();
+		report("image", expect(result, FetchStatus::OK, 67), result);
+		result = fetcher.fetchAsync(base + "/file/100000/b.txt", dir / "sub" / "b.txt").get();
+		report("content-length", expect(result, FetchStatus::OK, 100000), result);
+		report("keep-alive", fetcher.idleConnections() == 1, result);
+		result = fetcher.fetchAsync(base + "/chunked/file/100000/c.txt", dir / "c.txt").get();
+		report("chunked", expect(result, FetchStatus::OK, 100000), result);
+		result = fetcher.fetchAsync(base + "/redirect/file/10/d.txt", dir / "d.txt").get();
+		report("redirect", expect(result, FetchStatus::OK, 10), result);
+		result = fetcher.fetchAsync(base + "/missing", dir / "e.txt").get();
+		report("404", expect(result, FetchStatus::FAILED, 0) && result.httpStatus == 404, result);
+
+		FetchOptions options;
+		options.timeoutMs = 200;
+		result = fetcher.fetchAsync(base + "/delay/2000/image/f.png", dir / "f.png", options).get();
+		report("timeout", expect(result, FetchStatus::TIMEOUT, 0), result);
+		options = FetchOptions();
+		options.maxBytes = 1000;
+		result = fetcher.fetchAsync(base + "/file/5000/g.txt", dir / "g.txt", options).get();
+		report("size cap", expect(result, FetchStatus::TOO_LARGE, 0), result);
+		result = fetcher.fetchAsync(base + "/chunked/file/5000/h.txt", dir / "h.txt", options).get();
+		report("size cap chunked", expect(result, FetchStatus::TOO_LARGE, 0), result);
+		//admit按Content-Length或累计大小放行
+		options = FetchOptions();
+		unsigned long long admitted = 0;
+		options.admit = [&admitted](unsigned long long total) { admitted = total; return total <= 3000; };
+		result = fetcher.fetchAsync(base + "/file/5000/j.txt", dir / "j.txt", options).get();
+		report("admit", expect(result, FetchStatus::TOO_LARGE, 0) && admitted == 5000, result);
+		result = fetcher.fetchAsync(base + "/chunked/file/5000/k.txt", dir / "k.txt", options).get();
+		report("admit chunked", expect(result, FetchStatus::TOO_LARGE, 0) && admitted > 3000, result);
+		result = fetcher.fetchAsync(base + "/chunked/file/2000/l.txt", dir / "l.txt", options).get();
+		report("admit chunked ok", expect(result, FetchStatus::OK, 2000) && admitted == 2000, result);
+		result = fetcher.fetchAsync("http://127.0.0.1:1/i.txt", dir / "i.txt").get();
+		report("unreachable", expect(result, FetchStatus::FAILED, 0), result);
+
+		//超过并发上限的排队执行
+		std::vector<std::future<FetchResult>> futures;
+		for (int i = 0; i < 32; i++)
+		{
+			futures.push_back(fetcher.fetchAsync(base + "/delay/20/file/20000/" + std::to_string(i), dir / "many" / std::to_string(i)));
+		}
+		bool ok = true;
+		for (auto& future : futures)
+		{
+			result = future.get();
+			ok = ok && expect(result, FetchStatus::OK, 20000);
+		}
+		report("concurrent", ok, result);
+		report("idle limit", fetcher.idleConnections() <= 4, result);
+	}
+	std::filesystem::remove_all(dir);
+	return failed;
+}
@@ -0,0 +1,10 @@
+﻿#pragma once
+#include <ostream>
+
+/// <summary>
+/// 以本地http服务验证HttpFetcher：普通与chunked下载、重定向、404、超时、大小上限、连接复用与并发排队
+/// </summary>
+/// <param name="httpPort">HttpStub已监听的端口</param>
+/// <param name="out">逐项输出结果</param>
+/// <returns>失败项数</returns>
+int runFetchCheck(int httpPort, std::ostream& out);
@@ -0,0 +1,188 @@
+﻿#include "HttpStub.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+namespace
+{
+	/// <summary>
+	/// 1x1透明png
+	/// </summary>
+	const unsigned char PNG[] = {
+		0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52,
+		0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x08, 0x06, 0x00, 0x00, 0x00, 0x1f, 0x15, 0xc4,
+		0x89, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9c, 0x63, 0x00, 0x01, 0x00, 0x00,
+		0x05, 0x00, 0x01, 0x0d, 0x0a, 0x2d, 0xb4, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae,
+		0x42, 0x60, 0x82
+	};
+	/// <summary>
+	/// 模拟文件的最大字节数
+	/// </summary>
+	const size_t MAX_FILE_SIZE = 64 * 1024 * 1024;
+}
+
+/// <summary>
+/// 单个连接，按keep-alive依次处理请求
+/// </summary>
+struct HttpStub::Session
+{
+	explicit Session(asio::io_context& io) : socket(io), timer(io) {}
+	asio::ip::tcp::socket socket;
+	asio::steady_timer timer;
+	asio::streambuf request;
+	std::string response;
+};
+
+HttpStub::HttpStub() : acceptor(io), requestCount(0), bodyBytes(0) {}
+
+HttpStub::~HttpStub()
+{
+	stop();
+}
+
+void HttpStub::start(int port)
+{
+	asio::ip::tcp::endpoint endpoint(asio::ip::tcp::v4(), (unsigned short)port);
+	acceptor.open(endpoint.protocol());
+	acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true));
+	acceptor.bind(endpoint);
+	acceptor.listen();
+	accept();
+	worker = std::thread([this] { io.run(); });
+}
+
+void HttpStub::stop()
+{
+	if (!worker.joinable()) return;
+	io.stop();
+	worker.join();
+}
+
+unsigned long long HttpStub::requests() const
+{
+	return requestCount;
+}
+
+unsigned long long HttpStub::bytesSent() const
+{
+	return bodyBytes;
+}
+
+void HttpStub::accept()
+{
+	auto session = std::make_shared<Session>(io);
+	acceptor.async_accept(session->socket, [this, session](const asio::error_code& ec)
+		{
+			if (ec) return;
+			accept();
+			serve(session);
+		});
+}
+
+void HttpStub::serve(std::shared_ptr<Session> session)
+{
+	asio::async_read_until(session->socket, session->request, "\r\n\r\n", [this, session](const asio::error_code& ec, size_t size)
+		{
+			if (ec) return;
+			std::string request(asio::buffers_begin(session->request.data()), asio::buffers_begin(session->request.data()) + size);
+			session->request.consume(size);
+			long delayMs = 0;
+			bool keepAlive = true;
+			session->response = respond(request, delayMs, keepAlive);
+			requestCount++;
+			size_t header = session->response.find("\r\n\r\n");
+			bodyBytes += header == std::string::npos ? 0 : session->response.size() - header - 4;
+			session->timer.expires_after(std::chrono::milliseconds(delayMs));
+			session->timer.async_wait([this, session, keepAlive](const asio::error_code&)
+				{
+					asio::async_write(session->socket, asio::buffer(session->response), [this, session, keepAlive](const asio::error_code& ec, size_t)
+						{
+							if (!ec && keepAlive)
+							{
+								serve(session);
+								return;
+							}
+							asio::error_code ignored;
+							session->socket.shutdown(asio::ip::tcp::socket::shutdown_both, ignored);
+						});
+				});
+		});
+}
+
+std::string HttpStub::respond(const std::string& request, long& delayMs, bool& keepAlive)
+{
+	//请求行 GET /path HTTP/1.1
+	size_t begin = request.find(' ');
+	size_t end = begin == std::string::npos ? std::string::npos : request.find(' ', begin + 1);
+	std::string path = end == std::string::npos ? "" : request.substr(begin + 1, end - begin - 1);
+
+	std::string lower = request;
+	std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char ch) { return (char)std::tolower(ch); });
+	keepAlive = lower.find("connection: close") == std::string::npos && lower.find("http/1.0\r\n") == std::string::npos;
+
+	//前缀可叠加，如 /delay/500/chunked/image/a.png
+	bool chunked = false;
+	std::string redirect;
+	while (true)
+	{
+		if (path.rfind("/delay/", 0) == 0)
+		{
+			char* next;
+			delayMs = std::strtol(path.c_str() + 7, &next, 10);
+			path = next;
+		}
+		else if (path.rfind("/chunked/", 0) == 0)
+		{
+			chunked = true;
+			path = path.substr(8);
+		}
+		else if (path.rfind("/redirect/", 0) == 0)
+		{
+			redirect = path.substr(9);
+			break;
+		}
+		else break;
+	}
+	if (!redirect.empty())
+	{
+		return "HTTP/1.1 302 Found\r\nLocation: " + redirect + "\r\nContent-Length: 0\r\n" + (keepAlive ? "" : "Connection: close\r\n") + "\r\n";
+	}
+
+	std::string status = "200 OK";
+	std::string type = "text/plain";
+	std::string body;
+	if (path.rfind("/image/", 0) == 0)
+	{
+		type = "image/png";
+		body.assign((const char*)PNG, sizeof(PNG));
+	}
+	else if (path.rfind("/file/", 0) == 0)
+	{
+		size_t size = std::strtoull(path.c_str() + 6, nullptr, 10);
+		if (size > MAX_FILE_SIZE) size = MAX_FILE_SIZE;
+		type = "application/octet-stream";
+		static const std::string LINE = "simulated homework file content 0123456789\n";
+		body.reserve(size);
+		while (body.size() < size) body.append(LINE, 0, std::min(LINE.size(), size - body.size()));
+	}
+	else
+	{
+		status = "404 Not Found";
+		body = "not found\n";
+	}
+	std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: " + type + "\r\n" + (keepAlive ? "" : "Connection: close\r\n");
+	if (!chunked) return response + "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+
+	//每块至多8K
+	response += "Transfer-Encoding: chunked\r\n\r\n";
+	char size[16];
+	for (size_t pos = 0; pos < body.size(); pos += 8192)
+	{
+		size_t length = std::min<size_t>(8192, body.size() - pos);
+		snprintf(size, sizeof(size), "%zx\r\n", length);
+		response.append(size).append(body, pos, length).append("\r\n");
+	}
+	return response + "0\r\n\r\n";
+}
@@ -0,0 +1,61 @@
+﻿#define ASIO_STANDALONE
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <asio.hpp>
+
+/// <summary>
+/// 本地http服务，代替QQ的图片与离线文件下载地址
+/// <para>/image/任意名称 返回1x1 png；/file/{字节数}/任意名称 返回指定大小的文本</para>
+/// <para>前缀 /delay/{毫秒} 延迟响应，/chunked 以chunked编码返回，/redirect 以302跳转至其后的路径，用于验证下载的超时与重定向</para>
+/// <para>连接按keep-alive复用，请求带Connection: close时处理完即关闭</para>
+/// </summary>
+class HttpStub
+{
+public:
+	HttpStub();
+	/// <summary>
+	/// 停止服务
+	/// </summary>
+	~HttpStub();
+	HttpStub(const HttpStub&) = delete;
+	HttpStub& operator=(const HttpStub&) = delete;
+	/// <summary>
+	/// 开始监听，在独立线程运行
+	/// </summary>
+	/// <param name="port">端口</param>
+	void start(int port);
+	/// <summary>
+	/// 停止服务
+	/// </summary>
+	void stop();
+	/// <summary>
+	/// 已处理的请求数
+	/// </summary>
+	unsigned long long requests() const;
+	/// <summary>
+	/// 已发送的响应体字节数
+	/// </summary>
+	unsigned long long bytesSent() const;
+private:
+	struct Session;
+	void accept();
+	/// <summary>
+	/// 依次读取并响应同一连接上的请求
+	/// </summary>
+	void serve(std::shared_ptr<Session> session);
+	/// <summary>
+	/// 根据请求路径生成响应
+	/// </summary>
+	/// <param name="delayMs">响应前的延迟</param>
+	/// <param name="keepAlive">响应后是否保持连接</param>
+	static std::string respond(const std::string& request, long& delayMs, bool& keepAlive);
+
+	asio::io_context io;
+	asio::ip::tcp::acceptor acceptor;
+	std::thread worker;
+	std::atomic<unsigned long long> requestCount;
+	std::atomic<unsigned long long> bodyBytes;
+};
@@ -0,0 +1,205 @@
+﻿#include "LoadGenerator.h"
+#include <algorithm>
+#include <iomanip>
+#include <regex>
+
+LoadGenerator::LoadGenerator(OneBotServer& bot, LoadConfig config) :
+	bot(bot), config(config), finished(0), extraReplies(0), pushFailures(0)
+{}
+
+LoadGenerator::~LoadGenerator()
+{
+	bot.setReplyFunc(nullptr);
+	work.reset();
+	io.stop();
+	if (worker.joinable()) worker.join();
+}
+
+void LoadGenerator::run()
+{
+	work = std::make_unique<asio::executor_work_guard<asio::io_context::executor_type>>(io.get_executor());
+	worker = std::thread([this] { io.run(); });
+	bot.setReplyFunc([this](long long userId, const std::string& message) { onReply(userId, message); });
+
+	std::unique_lock<std::mutex> lock(mtx);
+	startTime = std::chrono::steady_clock::now();
+	for (int i = 0; i < config.students; i++)
+	{
+		Student& student = students[config.qqBase + i];
+		student.qq = config.qqBase + i;
+		student.assignmentId = config.assignmentId;
+		student.timer = std::make_unique<asio::steady_timer>(io);
+		schedule(student, config.students > 1 ? config.rampMs * i / (config.students - 1) : 0);
+	}
+	cv.wait(lock, [this] { return finished == config.students; });
+	endTime = std::chrono::steady_clock::now();
+}
+
+void LoadGenerator::report(std::ostream& out)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	double elapsed = std::chrono::duration<double>(endTime - startTime).count();
+	unsigned long long total = 0, errors = 0, timeouts = 0;
+	out << std::left << std::setw(12) << "command" << std::right
+		<< std::setw(8) << "count" << std::setw(8) << "errors" << std::setw(10) << "timeouts"
+		<< std::setw(10) << "avg_ms" << std::setw(10) << "p50_ms" << std::setw(10) << "p90_ms" << std::setw(10) << "p99_ms" << std::setw(10) << "max_ms" << std::endl;
+	out << std::fixed << std::setprecision(1);
+	for (auto& iter : stats)
+	{
+		CommandStats& command = iter.second;
+		std::vector<double> sorted = command.latency;
+		std::sort(sorted.begin(), sorted.end());
+		auto percentile = [&sorted](double p) { return sorted.empty() ? 0.0 : sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))]; };
+		double sum = 0;
+		for (double ms : sorted) sum += ms;
+		out << std::left << std::setw(12) << stepName(iter.first) << std::right
+			<< std::setw(8) << command.count << std::setw(8) << command.errors << std::setw(10) << command.timeouts
+			<< std::setw(10) << (sorted.empty() ? 0.0 : sum / sorted.size()) << std::setw(10) << percentile(0.5) << std::setw(10) << percentile(0.9)
+			<< std::setw(10) << percentile(0.99) << std::setw(10) << (sorted.empty() ? 0.0 : sorted.back()) << std::endl;
+		total += command.count;
+		errors += command.errors;
+		timeouts += command.timeouts;
+	}
+	out << std::endl;
+	out << "students        " << config.students << std::endl;
+	out << "elapsed         " << elapsed << " s" << std::endl;
+	out << "commands        " << total << " (" << (elapsed > 0 ? total / elapsed : 0.0) << " /s)" << std::endl;
+	out << "error rate      " << (total > 0 ? 100.0 * (errors + timeouts) / total : 0.0) << " %" << std::endl;
+	out << "extra replies   " << extraReplies << std::endl;
+	out << "push failures   " << pushFailures << std::endl;
+	out << "api calls       " << bot.apiCalls() << " (" << bot.apiFailures() << " failed)" << std::endl;
+}
+
+const char* LoadGenerator::stepName(Step step)
+{
+	switch (step)
+	{
+	case Step::REGISTER: return "register";
+	case Step::INVITE: return "invite";
+	case Step::NAME: return "name";
+	case Step::SCHOOL_NUM: return "school_num";
+	case Step::CONFIRM: return "confirm";
+	case Step::LIST: return "list";
+	case Step::SUBMIT: return "submit";
+	case Step::TEXT: return "text";
+	case Step::IMAGE: return "image";
+	case Step::FILE: return "file";
+	case Step::COMMIT: return "commit";
+	default: return "done";
+	}
+}
+
+bool LoadGenerator::isError(const std::string& reply)
+{
+	for (const char* word : { u8"失败", u8"错误", u8"未知", u8"非法", u8"暂无该作业", u8"不允许" })
+	{
+		if (reply.find(word) != std::string::npos) return true;
+	}
+	return false;
+}
+
+void LoadGenerator::onReply(long long userId, const std::string& message)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto iter = students.find(userId);
+	if (iter == students.end()) return;
+	Student& student = iter->second;
+	if (!student.waiting)
+	{
+		extraReplies++;
+		return;
+	}
+	student.waiting = false;
+	student.timer->cancel();
+	CommandStats& command = stats[student.step];
+	command.latency.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - student.sentAt).count());
+	if (isError(message)) command.errors++;
+	student.step = next(student, message);
+	if (student.step == Step::DONE) finish(student);
+	else schedule(student, config.thinkMs);
+}
+
+void LoadGenerator::issue(Student& student)
+{
+	std::string qq = std::to_string(student.qq);
+	bool pushed = false;
+	student.sentAt = std::chrono::steady_clock::now();
+	switch (student.step)
+	{
+	case Step::REGISTER: pushed = bot.pushPrivateMessage(student.qq, u8"注册"); break;
+	case Step::INVITE: pushed = bot.pushPrivateMessage(student.qq, config.inviteCode); break;
+	case Step::NAME: pushed = bot.pushPrivateMessage(student.qq, u8"学生" + qq.substr(qq.size() > 4 ? qq.size() - 4 : 0)); break;
+	case Step::SCHOOL_NUM: pushed = bot.pushPrivateMessage(student.qq, qq); break;
+	case Step::CONFIRM: pushed = bot.pushPrivateMessage(student.qq, u8"确认"); break;
+	case Step::LIST: pushed = bot.pushPrivateMessage(student.qq, u8"查询作业"); break;
+	case Step::SUBMIT: pushed = bot.pushPrivateMessage(student.qq, u8"提交作业 " + std::to_string(student.assignmentId)); break;
+	case Step::TEXT: pushed = bot.pushPrivateMessage(student.qq, u8"压测文本\n#include <iostream>\nint main() { std::cout << \"" + qq + "\"; }"); break;
+	case Step::IMAGE: pushed = bot.pushPrivateMessage(student.qq, u8"附图[CQ:image,file=" + qq + ".image,url=" + config.httpBase + "/image/" + qq + ".png]"); break;
+	case Step::FILE: pushed = bot.pushOfflineFile(student.qq, qq + ".txt", config.fileSize, config.httpBase + "/file/" + std::to_string(config.fileSize) + "/" + qq + ".txt"); break;
+	case Step::COMMIT: pushed = bot.pushPrivateMessage(student.qq, u8"提交"); break;
+	default: break;
+	}
+	stats[student.step].count++;
+	if (!pushed) pushFailures++;
+
+	student.waiting = true;
+	unsigned long long sequence = ++student.sequence;
+	long long qqId = student.qq;
+	student.timer->expires_after(std::chrono::milliseconds(config.timeoutMs));
+	student.timer->async_wait([this, qqId, sequence](const asio::error_code& ec)
+		{
+			if (ec) return;
+			std::lock_guard<std::mutex> lock(mtx);
+			Student& student = students[qqId];
+			if (!student.waiting || student.sequence != sequence) return;
+			student.waiting = false;
+			stats[student.step].timeouts++;
+			student.step = next(student, "");
+			if (student.step == Step::DONE) finish(student);
+			else schedule(student, 0);
+		});
+}
+
+LoadGenerator::Step LoadGenerator::next(Student& student, const std::string& reply)
+{
+	switch (student.step)
+	{
+	case Step::REGISTER:
+		return reply.find(u8"您已注册") != std::string::npos ? Step::LIST : Step::INVITE;
+	case Step::LIST:
+		if (student.assignmentId == 0)
+		{
+			//取列表中的第一项作业
+			static const std::regex findId(u8"【作业(\\d+)】");
+			std::smatch match;
+			if (!std::regex_search(reply, match, findId)) return Step::DONE;
+			student.assignmentId = std::stoll(match[1]);
+		}
+		return Step::SUBMIT;
+	case Step::SUBMIT:
+		return isError(reply) || reply.empty() ? Step::DONE : Step::TEXT;
+	case Step::COMMIT:
+		return Step::DONE;
+	default:
+		return (Step)((int)student.step + 1);
+	}
+}
+
+void LoadGenerator::schedule(Student& student, long delayMs)
+{
+	long long qqId = student.qq;
+	student.timer->expires_after(std::chrono::milliseconds(delayMs));
+	student.timer->async_wait([this, qqId](const asio::error_code& ec)
+		{
+			if (ec) return;
+			std::lock_guard<std::mutex> lock(mtx);
+			issue(students[qqId]);
+		});
+}
+
+void LoadGenerator::finish(Student& student)
+{
+	student.step = Step::DONE;
+	finished++;
+	cv.notify_all();
+}
@@ -0,0 +1,186 @@
+﻿#define ASIO_STANDALONE
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <asio.hpp>
+
+#include "OneBotServer.h"
+
+/// <summary>
+/// 压测参数
+/// </summary>
+struct LoadConfig
+{
+	/// <summary>
+	/// 模拟学生数
+	/// </summary>
+	int students = 10;
+	/// <summary>
+	/// 第一个学生的qq，其余依次加1，学号与qq相同
+	/// </summary>
+	long long qqBase = 900000000;
+	/// <summary>
+	/// 课程邀请码，已注册的学生跳过注册
+	/// </summary>
+	std::string inviteCode;
+	/// <summary>
+	/// 提交的作业ID，为0时取作业列表中的第一项
+	/// </summary>
+	long long assignmentId = 0;
+	/// <summary>
+	/// 图片与离线文件的下载地址前缀 http://ip:port
+	/// </summary>
+	std::string httpBase;
+	/// <summary>
+	/// 收到回复后到发送下一条命令的间隔（毫秒），默认与QQMessage入口限流每2秒1条相当
+	/// </summary>
+	long thinkMs = 2000;
+	/// <summary>
+	/// 等待回复的超时（毫秒）
+	/// </summary>
+	long timeoutMs = 15000;
+	/// <summary>
+	/// 学生开始的时间在该区间内均匀分布（毫秒）
+	/// </summary>
+	long rampMs = 2000;
+	/// <summary>
+	/// 离线文件大小（字节）
+	/// </summary>
+	long long fileSize = 4096;
+};
+
+/// <summary>
+/// 单个命令的统计
+/// </summary>
+struct CommandStats
+{
+	unsigned long long count = 0;
+	/// <summary>
+	/// 回复内容表示失败
+	/// </summary>
+	unsigned long long errors = 0;
+	unsigned long long timeouts = 0;
+	/// <summary>
+	/// 首条回复的耗时（毫秒）
+	/// </summary>
+	std::vector<double> latency;
+};
+
+/// <summary>
+/// 端到端压测
+/// <para>每个模拟学生依次执行 注册→查询作业→进入提交→文本→图片→离线文件→确认提交，收到首条回复后经过思考时间再发下一条</para>
+/// <para>耗时从推送事件到收到该学生的首条send_private_msg，等待期间以外收到的回复（如分条发送的后续部分）计入额外回复</para>
+/// </summary>
+class LoadGenerator
+{
+public:
+	/// <summary>
+	/// 初始化压测
+	/// </summary>
+	/// <param name="bot">已被QQMessage连接的模拟端</param>
+	/// <param name="config">压测参数</param>
+	LoadGenerator(OneBotServer& bot, LoadConfig config);
+	~LoadGenerator();
+	LoadGenerator(const LoadGenerator&) = delete;
+	LoadGenerator& operator=(const LoadGenerator&) = delete;
+	/// <summary>
+	/// 执行压测，所有学生完成后返回
+	/// </summary>
+	void run();
+	/// <summary>
+	/// 输出各命令的耗时分位数、吞吐与错误率
+	/// </summary>
+	void report(std::ostream& out);
+private:
+	/// <summary>
+	/// 学生流程中的命令
+	/// </summary>
+	enum class Step
+	{
+		REGISTER,
+		INVITE,
+		NAME,
+		SCHOOL_NUM,
+		CONFIRM,
+		LIST,
+		SUBMIT,
+		TEXT,
+		IMAGE,
+		FILE,
+		COMMIT,
+		DONE
+	};
+	/// <summary>
+	/// 模拟学生
+	/// </summary>
+	struct Student
+	{
+		long long qq = 0;
+		Step step = Step::REGISTER;
+		/// <summary>
+		/// 是否在等待当前命令的回复
+		/// </summary>
+		bool waiting = false;
+		/// <summary>
+		/// 当前命令的序号，用于识别过期的超时
+		/// </summary>
+		unsigned long long sequence = 0;
+		long long assignmentId = 0;
+		std::chrono::steady_clock::time_point sentAt;
+		std::unique_ptr<asio::steady_timer> timer;
+	};
+	/// <summary>
+	/// 命令名称
+	/// </summary>
+	static const char* stepName(Step step);
+	/// <summary>
+	/// 回复内容是否表示失败
+	/// </summary>
+	static bool isError(const std::string& reply);
+	/// <summary>
+	/// 收到机器人回复，在模拟端网络线程中执行
+	/// </summary>
+	void onReply(long long userId, const std::string& message);
+	/// <summary>
+	/// 发送当前命令并开始计时，须持有锁
+	/// </summary>
+	void issue(Student& student);
+	/// <summary>
+	/// 根据回复决定下一条命令，须持有锁
+	/// </summary>
+	/// <param name="reply">首条回复，超时时为空</param>
+	Step next(Student& student, const std::string& reply);
+	/// <summary>
+	/// 思考时间后发送下一条命令，须持有锁
+	/// </summary>
+	void schedule(Student& student, long delayMs);
+	/// <summary>
+	/// 学生完成流程，须持有锁
+	/// </summary>
+	void finish(Student& student);
+
+	OneBotServer& bot;
+	LoadConfig config;
+	asio::io_context io;
+	std::unique_ptr<asio::executor_work_guard<asio::io_context::executor_type>> work;
+	std::thread worker;
+	std::mutex mtx;
+	std::condition_variable cv;
+	/// <summary>
+	/// 模拟学生【qq，学生】
+	/// </summary>
+	std::map<long long, Student> students;
+	int finished;
+	std::map<Step, CommandStats> stats;
+	unsigned long long extraReplies;
+	unsigned long long pushFailures;
+	std::chrono::steady_clock::time_point startTime;
+	std::chrono::steady_clock::time_point endTime;
+};
@@ -0,0 +1,215 @@
+﻿#include "OneBotServer.h"
+#include <ctime>
+#include <iostream>
+#include <json.hpp>
+
+OneBotServer::OneBotServer(long long selfId) :
+	selfId(selfId), failureRate(0), random(std::random_device()()), nextMessageId(1), calls(0), failures(0)
+{
+	m_Server.clear_access_channels(websocketpp::log::alevel::all);
+	m_Server.clear_error_channels(websocketpp::log::elevel::all);
+	m_Server.init_asio();
+	m_Server.set_reuse_addr(true);
+	m_Server.set_open_handler([this](websocketpp::connection_hdl hdl) { onOpen(hdl); });
+	m_Server.set_close_handler([this](websocketpp::connection_hdl hdl) { onClose(hdl); });
+	m_Server.set_message_handler([this](websocketpp::connection_hdl hdl, server::message_ptr msg) { onMessage(hdl, msg); });
+}
+
+OneBotServer::~OneBotServer()
+{
+	stop();
+}
+
+void OneBotServer::start(int port)
+{
+	m_Server.listen(port);
+	m_Server.start_accept();
+	m_Heartbeat = std::make_unique<asio::steady_timer>(m_Server.get_io_service());
+	scheduleHeartbeat();
+	m_Thread = std::thread([this] { m_Server.run(); });
+}
+
+void OneBotServer::stop()
+{
+	if (!m_Thread.joinable()) return;
+	asio::post(m_Server.get_io_service(), [this]
+		{
+			m_Heartbeat->cancel();
+			websocketpp::lib::error_code ec;
+			m_Server.stop_listening(ec);
+			std::lock_guard<std::mutex> lock(mtx);
+			for (auto& iter : connections) m_Server.close(iter, websocketpp::close::status::going_away, "simulator stopped", ec);
+		});
+	m_Thread.join();
+}
+
+bool OneBotServer::waitConnected(long timeoutMs)
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	return cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return !connections.empty(); });
+}
+
+void OneBotServer::setReplyFunc(ReplyFunc func)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	replyFunc = func;
+}
+
+void OneBotServer::setFailureRate(double rate)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	failureRate = rate;
+}
+
+bool OneBotServer::pushPrivateMessage(long long userId, const std::string& message)
+{
+	nlohmann::json event = {
+		{ "time", (long long)time(nullptr) },
+		{ "self_id", selfId },
+		{ "post_type", "message" },
+		{ "message_type", "private" },
+		{ "sub_type", "friend" },
+		{ "message_id", nextMessageId++ },
+		{ "user_id", userId },
+		{ "message", message },
+		{ "raw_message", message },
+		{ "font", 0 },
+		{ "sender", { { "user_id", userId }, { "nickname", "student" + std::to_string(userId) } } }
+	};
+	return push(userId, event.dump());
+}
+
+bool OneBotServer::pushOfflineFile(long long userId, const std::string& name, long long size, const std::string& url)
+{
+	nlohmann::json event = {
+		{ "time", (long long)time(nullptr) },
+		{ "self_id", selfId },
+		{ "post_type", "notice" },
+		{ "notice_type", "offline_file" },
+		{ "user_id", userId },
+		{ "file", { { "name", name }, { "size", size }, { "url", url } } }
+	};
+	return push(userId, event.dump());
+}
+
+unsigned long long OneBotServer::apiCalls() const
+{
+	return calls;
+}
+
+unsigned long long OneBotServer::apiFailures() const
+{
+	return failures;
+}
+
+void OneBotServer::onOpen(websocketpp::connection_hdl hdl)
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		connections.push_back(hdl);
+	}
+	cv.notify_all();
+	nlohmann::json lifecycle = {
+		{ "time", (long long)time(nullptr) },
+		{ "self_id", selfId },
+		{ "post_type", "meta_event" },
+		{ "meta_event_type", "lifecycle" },
+		{ "sub_type", "connect" }
+	};
+	websocketpp::lib::error_code ec;
+	m_Server.send(hdl, lifecycle.dump(), websocketpp::frame::opcode::text, ec);
+	std::cerr << "Bot connected." << std::endl;
+}
+
+void OneBotServer::onClose(websocketpp::connection_hdl hdl)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	auto closed = hdl.lock();
+	for (auto iter = connections.begin(); iter != connections.end(); iter++)
+	{
+		if (iter->lock() == closed)
+		{
+			connections.erase(iter);
+			break;
+		}
+	}
+	std::cerr << "Bot disconnected." << std::endl;
+}
+
+void OneBotServer::onMessage(websocketpp::connection_hdl hdl, server::message_ptr msg)
+{
+	nlohmann::json request;
+	try
+	{
+		request = nlohmann::json::parse(msg->get_payload());
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Malformed api call: " << e.what() << std::endl << msg->get_payload() << std::endl;
+		failures++;
+		return;
+	}
+	calls++;
+
+	bool fail;
+	ReplyFunc func;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		fail = failureRate > 0 && std::uniform_real_distribution<double>(0, 1)(random) < failureRate;
+		func = replyFunc;
+	}
+	nlohmann::json response = { { "data", nullptr } };
+	if (request.contains("echo")) response["echo"] = request["echo"];
+	if (fail)
+	{
+		failures++;
+		response["status"] = "failed";
+		response["retcode"] = 100;
+	}
+	else
+	{
+		response["status"] = "ok";
+		response["retcode"] = 0;
+		if (request.value("action", "") == "send_private_msg")
+		{
+			response["data"] = { { "message_id", nextMessageId++ } };
+			auto& params = request.at("params");
+			if (func) func(params.at("user_id").get<long long>(), params.at("message").get<std::string>());
+		}
+	}
+	websocketpp::lib::error_code ec;
+	m_Server.send(hdl, response.dump(), websocketpp::frame::opcode::text, ec);
+}
+
+void OneBotServer::scheduleHeartbeat()
+{
+	m_Heartbeat->expires_after(std::chrono::seconds(5));
+	m_Heartbeat->async_wait([this](const asio::error_code& ec)
+		{
+			if (ec) return;
+			nlohmann::json heartbeat = {
+				{ "time", (long long)time(nullptr) },
+				{ "self_id", selfId },
+				{ "post_type", "meta_event" },
+				{ "meta_event_type", "heartbeat" },
+				{ "interval", 5000 },
+				{ "status", { { "online", true }, { "good", true } } }
+			};
+			std::string frame = heartbeat.dump();
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				websocketpp::lib::error_code sendEc;
+				for (auto& iter : connections) m_Server.send(iter, frame, websocketpp::frame::opcode::text, sendEc);
+			}
+			scheduleHeartbeat();
+		});
+}
+
+bool OneBotServer::push(long long userId, const std::string& event)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	if (connections.empty()) return false;
+	websocketpp::lib::error_code ec;
+	m_Server.send(connections[(unsigned long long)userId % connections.size()], event, websocketpp::frame::opcode::text, ec);
+	return !ec;
+}
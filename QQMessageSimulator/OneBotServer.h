@@ -0,0 +1,120 @@
+﻿#define ASIO_STANDALONE
+#define _WEBSOCKETPP_CPP11_RANDOM_DEVICE_
+#define _WEBSOCKETPP_CPP11_TYPE_TRAITS_
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <websocketpp/server.hpp>
+
+/// <summary>
+/// 机器人通过api发出的私聊消息
+/// </summary>
+typedef std::function<void(long long userId, const std::string& message)> ReplyFunc;
+
+/// <summary>
+/// go-cqhttp模拟端
+/// <para>以正向websocket方式监听，QQMessage作为客户端连接，行为与go-cqhttp的OneBot v11接口一致</para>
+/// <para>推送私聊消息、离线文件与心跳事件；对api调用按echo回执，send_private_msg的内容交给回调</para>
+/// </summary>
+class OneBotServer
+{
+public:
+	/// <summary>
+	/// 初始化模拟端
+	/// </summary>
+	/// <param name="selfId">模拟的机器人qq</param>
+	explicit OneBotServer(long long selfId);
+	/// <summary>
+	/// 停止监听
+	/// </summary>
+	~OneBotServer();
+	OneBotServer(const OneBotServer&) = delete;
+	OneBotServer& operator=(const OneBotServer&) = delete;
+	/// <summary>
+	/// 开始监听，在独立线程运行
+	/// </summary>
+	/// <param name="port">端口</param>
+	void start(int port);
+	/// <summary>
+	/// 断开所有连接并停止监听
+	/// </summary>
+	void stop();
+	/// <summary>
+	/// 等待机器人连接
+	/// </summary>
+	/// <param name="timeoutMs">超时（毫秒）</param>
+	/// <returns>超时前已有连接返回true</returns>
+	bool waitConnected(long timeoutMs);
+	/// <summary>
+	/// 设置收到私聊消息api调用后执行的函数，在网络线程中执行
+	/// </summary>
+	void setReplyFunc(ReplyFunc func);
+	/// <summary>
+	/// 设置api调用的失败比例，用于验证重试
+	/// </summary>
+	/// <param name="rate">0~1</param>
+	void setFailureRate(double rate);
+	/// <summary>
+	/// 推送私聊消息事件
+	/// </summary>
+	/// <param name="userId">发送者qq</param>
+	/// <param name="message">消息内容，可含CQ码</param>
+	/// <returns>无连接时返回false</returns>
+	bool pushPrivateMessage(long long userId, const std::string& message);
+	/// <summary>
+	/// 推送离线文件事件
+	/// </summary>
+	/// <param name="userId">发送者qq</param>
+	/// <param name="name">文件名</param>
+	/// <param name="size">文件大小</param>
+	/// <param name="url">下载地址</param>
+	/// <returns>无连接时返回false</returns>
+	bool pushOfflineFile(long long userId, const std::string& name, long long size, const std::string& url);
+	/// <summary>
+	/// 收到的api调用数
+	/// </summary>
+	unsigned long long apiCalls() const;
+	/// <summary>
+	/// 回执为失败的api调用数
+	/// </summary>
+	unsigned long long apiFailures() const;
+private:
+	typedef websocketpp::server<websocketpp::config::asio> server;
+	void onOpen(websocketpp::connection_hdl hdl);
+	void onClose(websocketpp::connection_hdl hdl);
+	void onMessage(websocketpp::connection_hdl hdl, server::message_ptr msg);
+	/// <summary>
+	/// 每5秒推送心跳
+	/// </summary>
+	void scheduleHeartbeat();
+	/// <summary>
+	/// 按发送者选择连接推送事件，与多账号时同一学生固定由一个账号接收一致
+	/// </summary>
+	bool push(long long userId, const std::string& event);
+
+	long long selfId;
+	server m_Server;
+	std::thread m_Thread;
+	std::unique_ptr<asio::steady_timer> m_Heartbeat;
+	std::mutex mtx;
+	std::condition_variable cv;
+	/// <summary>
+	/// 当前连接，按连接顺序
+	/// </summary>
+	std::vector<websocketpp::connection_hdl> connections;
+	ReplyFunc replyFunc;
+	double failureRate;
+	std::mt19937 random;
+	std::atomic<long long> nextMessageId;
+	std::atomic<unsigned long long> calls;
+	std::atomic<unsigned long long> failures;
+};
@@ -0,0 +1,231 @@
+﻿#include "StorageCheck.h"
+#include <fstream>
+#include <future>
+#include <random>
+#include <string>
+
+#include "ClassArchive.h"
+#include "File.h"
+#include "FileCache.h"
+#include "HttpFetcher.h"
+#include "Sha256.h"
+#include "StorageQuota.h"
+#include "TextCompressor.h"
+
+//File使用的全局对象，与QQMessage.cpp中的对应
+std::string rootPath;
+StorageQuota storageQuota;
+FileCache fileCache(1024 * 1024, 64, 64 * 1024);
+HttpFetcher httpFetcher(1, 1);
+
+namespace
+{
+	/// <summary>
+	/// 多块的代码正文，超过一个压缩块
+	/// </summary>
+	std::string codeText()
+	{
+		std::string text;
+		for (int i = 0; text.size() < TextCompressor::BLOCK_SIZE * 3; i++)
+		{
+			text += "public static int value" + std::to_string(i) + "(int x) { return x * " + std::to_string(i) + "; }\n";
+		}
+		return text;
+	}
+
+	/// <summary>
+	/// 不可压缩的随机数据
+	/// </summary>
+	std::string randomBytes(size_t size)
+	{
+		std::mt19937 random(42);
+		std::string data(size, '\0');
+		for (auto& c : data) c = (char)(random() & 0xFF);
+		return data;
+	}
+
+	std::string readAll(const std::filesystem::path& path)
+	{
+		std::ifstream in(path, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+
+	/// <summary>
+	/// 文件在内容寻址存储中对应的blob，按磁盘上的内容计算
+	/// </summary>
+	std::filesystem::path blobOf(const std::filesystem::path& dir, const std::filesystem::path& file)
+	{
+		std::string hash = Sha256::hash(readAll(file));
+		return dir / ".blobs" / hash.substr(0, 2) / hash;
+	}
+
+	/// <summary>
+	/// 逐块读出的内容，与readFile结果比较
+	/// </summary>
+	bool readChunks(const std::filesystem::path& path, std::string& out, unsigned long long offset = 0, unsigned long long length = ULLONG_MAX)
+	{
+		TextCompressor::Reader reader(path, offset, length);
+		std::string chunk;
+		out.clear();
+		while (reader.read(chunk)) out += chunk;
+		return !reader.failed();
+	}
+}
+
+int runStorageCheck(int httpPort, std::ostream& out)
+{
+	std::filesystem::path dir = std::filesystem::temp_directory_path() / "QQMessageSimulatorStorage";
+	std::filesystem::remove_all(dir);
+	rootPath = dir.string();
+	//服务端默认不压缩，自检覆盖压缩存储的读写
+	File::setTextCompression(true);
+	int failed = 0;
+	auto report = [&out, &failed](const char* name, bool ok)
+	{
+		out << (ok ? "ok    " : "FAIL  ") << name << std::endl;
+		if (!ok) failed++;
+	};
+
+	//正文压缩
+	{
+		std::string code = codeText(), binary = randomBytes(100000), text = u8"第一题 答案如下\n", result;
+		std::string compressed = TextCompressor::compress(code);
+		report("compress code", TextCompressor::isCompressed(compressed) && compressed.size() < code.size() && TextCompressor::decompress(compressed, result) && result == code);
+		compressed = TextCompressor::compress(text);
+		report("compress short", TextCompressor::decompress(compressed, result) && result == text);
+		compressed = TextCompressor::compress("");
+		report("compress empty", TextCompressor::decompress(compressed, result) && result.empty());
+		compressed = TextCompressor::compress(binary);
+		report("compress incompressible", !TextCompressor::isCompressed(compressed) && TextCompressor::decompress(compressed, result) && result == binary);
+		compressed = TextCompressor::compress(code);
+		report("decompress truncated", !TextCompressor::decompress(std::string_view(compressed).substr(0, compressed.size() / 2), result));
+
+		std::filesystem::create_directories(dir / "text");
+		std::filesystem::path path = dir / "text" / "1.txt";
+		std::ofstream(path, std::ios::binary) << code;
+		unsigned long long size = 0;
+		bool ok = TextCompressor::compressFile(path) && TextCompressor::isCompressed(readAll(path).substr(0, 5));
+		ok = ok && TextCompressor::readFile(path, result) && result == code;
+		ok = ok && readChunks(path, result) && result == code;
+		ok = ok && TextCompressor::contentSize(path, size) && size == code.size();
+		report("compress file", ok && !TextCompressor::compressFile(path));
+	}
+
+	//提交清单
+	std::string code = codeText(), answer = u8"第一题 答案如下\n补充说明";
+	std::string textName, codeName, picName, picture, list;
+	unsigned long long total = 0;
+	{
+		File file(1, 100, 1);
+		textName = file.storeText(u8"第一题 答案如下");
+		codeName = file.storeText(code);
+		file.appendText(textName, u8"补充说明");
+		picName = file.storePic("http://127.0.0.1:" + std::to_string(httpPort) + "/image/a.png");
+		picture = readAll(file.getFilePath(picName));
+		std::string deleted = file.storeText("to be deleted");
+		std::filesystem::path deletedBlob = blobOf(dir, file.getFilePath(deleted));
+		bool stored = std::filesystem::exists(deletedBlob);
+		file.delFile(deleted);
+		list = file.getFileList();
+		total = file.getSize();
+		File other(1, 101, 1);
+		std::string copyName = other.storeText(code);
+		//两份相同的提交与blob共用一个inode
+		std::filesystem::path blob = blobOf(dir, file.getFilePath(codeName));
+		std::error_code ec;
+		bool ok = std::filesystem::hard_link_count(blob, ec) == 3 && !ec;
+		ok = ok && std::filesystem::equivalent(blob, file.getFilePath(codeName), ec) && std::filesystem::equivalent(blob, other.getFilePath(copyName), ec);
+		report("blob dedup", ok);
+		report("blob release", stored && !std::filesystem::exists(deletedBlob));
+	}
+	{
+		//复制到另一班级，从磁盘上的.info重新载入
+		std::error_code ec;
+		std::filesystem::create_directories(dir / "2" / "100", ec);
+		std::filesystem::copy(dir / "1" / "100" / "1", dir / "2" / "100" / "1", ec);
+		File file(2, 100, 1);
+		bool ok = !ec && !picture.empty() && file.getFileList() == list && file.getSize() == total;
+		ok = ok && file.getFile(textName) == answer && file.getFile(codeName) == code;
+		ok = ok && readAll(file.getFilePath(picName)) == picture;
+		report("manifest reload", ok);
+
+		//没有.info的旧提交扫描目录补全清单
+		std::filesystem::create_directories(dir / "3" / "100" / "1", ec);
+		std::filesystem::copy(dir / "1" / "100" / "1" / codeName, dir / "3" / "100" / "1" / codeName, ec);
+		File legacy(3, 100, 1);
+		report("manifest legacy", !ec && legacy.getContentFile() == codeName && legacy.getFile(codeName) == code && std::filesystem::exists(dir / "3" / "100" / "1" / ".info"));
+	}
+
+	//班级归档
+	{
+		ClassArchive::Writer writer(dir / ".archives" / "9", nullptr);
+		std::filesystem::path source = dir / "text" / "1.txt";
+		bool ok = writer.addData("a", "first") && writer.addData("empty", "") && writer.add("b", source, "hash") && writer.add("c", source, "hash") && writer.finish();
+		auto archive = ClassArchive::open(9);
+		ClassArchive::Entry b, c, empty;
+		std::string result;
+		ok = ok && archive && archive->find("a", b) && archive->read(b, result) && result == "first";
+		ok = ok && archive->find("b", b) && archive->find("c", c) && b.offset == c.offset && archive->find("empty", empty) && empty.length == 0;
+		ok = ok && archive->list("").size() == 4 && !archive->find("d", c);
+		ok = ok && TextCompressor::readFile(archive->getPath(), result, b.offset, b.length) && result == code;
+		report("archive write", ok);
+		ok = archive && archive->extract(b, dir / "text" / "b.txt") && readAll(dir / "text" / "b.txt") == readAll(source);
+		ok = ok && archive->extract(empty, dir / "text" / "empty") && std::filesystem::file_size(dir / "text" / "empty") == 0;
+		report("archive extract", ok);
+		std::ofstream(dir / ".archives" / "8", std::ios::binary) << "not an archive";
+		report("archive corrupt", !ClassArchive::open(8));
+	}
+	{
+		File::archiveClass(1, nullptr);
+		auto archive = ClassArchive::open(1);
+		ClassArchive::Entry info;
+		bool ok = archive && archive->find("100/1/.info", info) && archive->list("100/1/").size() == 4 && !std::filesystem::exists(dir / "1" / "100");
+		File file(1, 100, 1);
+		FileLocation location = file.locate(codeName);
+		std::string result;
+		ok = ok && location.path == archive->getPath() && location.length != ULLONG_MAX && readChunks(location.path, result, location.offset, location.length) && result == code;
+		ok = ok && file.getFileList() == list && file.getFile(textName) == answer;
+		report("archive locate", ok);
+
+		//修改前解出到工作目录
+		std::string name = file.storeText("after archive");
+		ok = std::filesystem::exists(file.getFilePath(codeName)) && readAll(file.getFilePath(picName)) == picture;
+		ok = ok && file.getFile(codeName) == code && file.getFile(name) == "after archive";
+		File other(1, 101, 1);
+		ok = ok && !std::filesystem::exists(dir / "1" / "101") && other.getFile(other.getContentFile()) == code;
+		report("archive unpack", ok);
+		std::filesystem::path blob = blobOf(dir, file.getFilePath(name));
+		ok = std::filesystem::exists(blob);
+		File::archiveClass(1, nullptr);
+		//归档后删除散文件，最后一个引用释放时blob一并删除
+		report("archive blob release", ok && !std::filesystem::exists(blob));
+		archive = ClassArchive::open(1);
+		report("archive merge", archive && archive->list("100/1/").size() == 5 && archive->list("101/1/").size() == 2 && !std::filesystem::exists(dir / "1" / "100"));
+	}
+
+	//下载按实际大小预留配额，并发下载合计不超出
+	{
+		std::string base = "http://127.0.0.1:" + std::to_string(httpPort);
+		unsigned long long studentLimit = storageQuota.getStudentLimit(), classLimit = storageQuota.getClassLimit();
+		storageQuota.setLimits(250000, 0);
+		File file(4, 100, 1);
+		std::vector<std::future<std::string>> names;
+		for (int i = 0; i < 3; i++)
+		{
+			auto promise = std::make_shared<std::promise<std::string>>();
+			names.push_back(promise->get_future());
+			file.downFileAsync(base + "/delay/50/file/100000/" + std::to_string(i) + ".zip", std::to_string(i) + ".zip", [promise](std::string name) { promise->set_value(name); }, 100000);
+		}
+		int received = 0;
+		for (auto& name : names) received += name.get().empty() ? 0 : 1;
+		bool ok = received == 2 && storageQuota.getStudentUsage(4, 100) == 200000 && storageQuota.remaining(4, 100) == 50000;
+		report("quota declared size", ok);
+		//未知大小时按接收的字节数预留，超出时截断
+		ok = file.downFile(base + "/chunked/file/100000/big.zip", "big.zip").empty() && !std::filesystem::exists(file.getFilePath("big.zip"));
+		ok = ok && file.downFile(base + "/chunked/file/40000/small.zip", "small.zip") == "small.zip";
+		report("quota streaming", ok && storageQuota.getStudentUsage(4, 100) == 240000 && storageQuota.remaining(4, 100) == 10000);
+		storageQuota.setLimits(studentLimit, classLimit);
+	}
+	std::filesystem::remove_all(dir);
+	return failed;
+}
@@ -0,0 +1,10 @@
+﻿#pragma once
+#include <ostream>
+
+/// <summary>
+/// 在临时目录中验证QQMessage的存储格式往返：提交清单写入与读取、正文压缩与解压、班级归档写入与定位及解出、下载的配额预留
+/// </summary>
+/// <param name="httpPort">HttpStub已监听的端口，图片经File下载存储</param>
+/// <param name="out">逐项输出结果</param>
+/// <returns>失败项数</returns>
+int runStorageCheck(int httpPort, std::ostream& out);
@@ -0,0 +1,137 @@
+﻿#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "FetchCheck.h"
+#include "HttpStub.h"
+#include "LoadGenerator.h"
+#include "OneBotServer.h"
+#include "StorageCheck.h"
+
+namespace
+{
+	void usage()
+	{
+		std::cerr <<
+			"QQMessageSimulator --invite CODE [options]\n"
+			"  Start this first, then run HomeworkCheckerServer 127.0.0.1:<ws-port>.\n"
+			"  --ws-port N            go-cqhttp websocket port (6700)\n"
+			"  --http-port N          image and offline file stand-in port (6780)\n"
+			"  --students N           simulated students (10)\n"
+			"  --qq-base N            qq of the first student (900000000)\n"
+			"  --invite CODE          class invite code for registration\n"
+			"  --assignment N         assignment to submit, 0 = first in list (0)\n"
+			"  --think-ms N           pause between reply and next command (2000)\n"
+			"  --timeout-ms N         reply timeout (15000)\n"
+			"  --ramp-ms N            spread student start over this window (2000)\n"
+			"  --file-size N          offline file size in bytes (4096)\n"
+			"  --fail-rate X          fraction of api calls answered as failed (0)\n"
+			"  --connect-timeout-ms N wait for the bot to connect (60000)\n"
+			"QQMessageSimulator --fetch-check [--http-port N]\n"
+			"  Check the attachment downloader against the local http stand-in and exit.\n"
+			"QQMessageSimulator --storage-check [--http-port N]\n"
+			"  Round-trip submission manifests, compressed text and class archives in a temp directory and exit.\n";
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int wsPort = 6700;
+	int httpPort = 6780;
+	double failRate = 0;
+	long connectTimeoutMs = 60000;
+	bool fetchCheck = false;
+	bool storageCheck = false;
+	LoadConfig config;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		if (option == "--help" || option == "-h")
+		{
+			usage();
+			return 0;
+		}
+		if (option == "--fetch-check")
+		{
+			fetchCheck = true;
+			continue;
+		}
+		if (option == "--storage-check")
+		{
+			storageCheck = true;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			usage();
+			return 1;
+		}
+		const char* value = argv[++i];
+		if (option == "--ws-port") wsPort = atoi(value);
+		else if (option == "--http-port") httpPort = atoi(value);
+		else if (option == "--students") config.students = atoi(value);
+		else if (option == "--qq-base") config.qqBase = atoll(value);
+		else if (option == "--invite") config.inviteCode = value;
+		else if (option == "--assignment") config.assignmentId = atoll(value);
+		else if (option == "--think-ms") config.thinkMs = atol(value);
+		else if (option == "--timeout-ms") config.timeoutMs = atol(value);
+		else if (option == "--ramp-ms") config.rampMs = atol(value);
+		else if (option == "--file-size") config.fileSize = atoll(value);
+		else if (option == "--fail-rate") failRate = atof(value);
+		else if (option == "--connect-timeout-ms") connectTimeoutMs = atol(value);
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+	if (fetchCheck || storageCheck)
+	{
+		try
+		{
+			HttpStub http;
+			http.start(httpPort);
+			int failed = fetchCheck ? runFetchCheck(httpPort, std::cout) : 0;
+			if (storageCheck) failed += runStorageCheck(httpPort, std::cout);
+			return failed == 0 ? 0 : 1;
+		}
+		catch (std::exception& e)
+		{
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
+	}
+	if (config.inviteCode.empty())
+	{
+		usage();
+		return 1;
+	}
+	config.httpBase = "http://127.0.0.1:" + std::to_string(httpPort);
+
+	try
+	{
+		HttpStub http;
+		http.start(httpPort);
+		OneBotServer bot(10000);
+		bot.setFailureRate(failRate);
+		bot.start(wsPort);
+		std::cerr << "Waiting for HomeworkCheckerServer on ws://127.0.0.1:" << wsPort << " ..." << std::endl;
+		if (!bot.waitConnected(connectTimeoutMs))
+		{
+			std::cerr << "Bot did not connect." << std::endl;
+			return 1;
+		}
+
+		LoadGenerator generator(bot, config);
+		generator.run();
+		generator.report(std::cout);
+		std::cout << "http requests   " << http.requests() << " (" << http.bytesSent() << " bytes)" << std::endl;
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}